@@ -0,0 +1,348 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// mimetools-bench-compare: throughput of every conversion, against another build of it
+//
+//	mimetools-bench-compare --baseline-exe old/mimetools-bench-compare   exit 1 on regression
+//
+// Both builds are measured in the same invocation, interleaved: each case runs in rounds,
+// a round starting one process of each build (which one goes first alternates), and each
+// process measures a few runs after a warm-up. The CPU clock, the other load of the
+// machine and the thermal state of the moment hit both builds alike; no throughput is
+// kept from one invocation to the next.
+// The throughput of a case is the median of its runs, with a 95% confidence interval taken
+// from the order statistics (no assumption on the distribution of the times). A case
+// regresses when even the top of the interval of the new build is below fraction * the
+// median of the baseline one, and again when it is measured a second time.
+// The cases run with MIMETOOLS_THREADS=1, but the parallel one, which only follows the
+// thread pool and the cores left free by the rest of the machine: it is shown, not gated.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "codec.h"
+#include "tinf.h"
+#include "tdef.h"
+#include "benchInputs.h"
+#include "benchRunner.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+constexpr double DEFAULT_FRACTION = 0.8;
+
+struct CompareCase
+{
+	const char *name;
+	CodecId id;
+	InputKind input;
+	bool rawInflate;        // tinflate alone, on the deflated input (id unused)
+	bool parallel;          // on the whole thread pool, not gated
+};
+
+// One case per conversion, on the input it is used for
+static const CompareCase cases[] = {
+	{ "base64-encode/binary",               CodecId::base64Encode,            InputKind::binary, false, false },
+	{ "base64-encode-pad/binary",           CodecId::base64EncodePad,         InputKind::binary, false, false },
+	{ "base64-encode-wrap/binary",          CodecId::base64EncodeWrap,        InputKind::binary, false, false },
+	{ "base64-encode-by-line/ascii",        CodecId::base64EncodeByLine,      InputKind::ascii,  false, false },
+	{ "base64-decode/binary",               CodecId::base64Decode,            InputKind::binary, false, false },
+	{ "base64-decode-strict/binary",        CodecId::base64DecodeStrict,      InputKind::binary, false, false },
+	{ "base64-decode-by-line/ascii",        CodecId::base64DecodeByLine,      InputKind::ascii,  false, false },
+	{ "qp-encode/utf8",                     CodecId::qpEncode,                InputKind::utf8,   false, false },
+	{ "qp-decode/utf8",                     CodecId::qpDecode,                InputKind::utf8,   false, false },
+	{ "url-encode-rfc1738/utf8",            CodecId::urlEncodeRFC1738,        InputKind::utf8,   false, false },
+	{ "url-encode-rfc1738-by-line/utf8",    CodecId::urlEncodeRFC1738ByLine,  InputKind::utf8,   false, false },
+	{ "url-encode-extended/utf8",           CodecId::urlEncodeExtended,       InputKind::utf8,   false, false },
+	{ "url-encode-extended-by-line/utf8",   CodecId::urlEncodeExtendedByLine, InputKind::utf8,   false, false },
+	{ "url-encode-full/utf8",               CodecId::urlEncodeFull,           InputKind::utf8,   false, false },
+	{ "url-encode-full-by-line/utf8",       CodecId::urlEncodeFullByLine,     InputKind::utf8,   false, false },
+	{ "url-decode/escape",                  CodecId::urlDecode,               InputKind::escape, false, false },
+	{ "saml-decode/saml",                   CodecId::samlDecode,              InputKind::saml,   false, false },
+	{ "saml-encode/saml",                   CodecId::samlEncode,              InputKind::saml,   false, false },
+	{ "tinflate/saml",                      CodecId::samlDecode,              InputKind::saml,   true,  false },
+	{ "base64-encode/binary/all-threads",   CodecId::base64Encode,            InputKind::binary, false, true }
+};
+
+struct CaseResult
+{
+	bool ok = false;
+	double mbPerSecond = 0;     // median
+	double ciLow = 0;           // 95% confidence interval of the median
+	double ciHigh = 0;
+};
+
+struct CompareOptions
+{
+	std::string baselineExe;
+	std::string candidateExe;   // this program
+	std::string measure;        // the case to measure, in a process started by the comparison
+	double fraction = DEFAULT_FRACTION;
+	unsigned rounds = 7;
+	unsigned runs = 3;          // per process
+	unsigned warmupRuns = 2;
+	size_t size = 1 << 20;
+};
+
+static void usage(FILE *out)
+{
+	fprintf(out,
+		"usage: mimetools-bench-compare --baseline-exe file [--fraction f] [--rounds n] [--runs n] [--size n]\n"
+		"\n"
+		"  --baseline-exe  mimetools-bench-compare of the build to compare with\n"
+		"  --fraction      fail below this fraction of the baseline (default 0.8)\n"
+		"  --rounds        processes started for each build and case (default 7)\n"
+		"  --runs          runs measured by each process, after 2 warm-up runs (default 3)\n"
+		"  --size          size of the generated inputs (default 1M)\n");
+}
+
+// Median and 95% confidence interval of the median of throughput samples.
+// The interval is [x(k), x(n-1-k)] of the sorted samples, k the rank the binomial
+// distribution of the number of samples below the median gives at 2.5%.
+static void summarize(std::vector<double> samples, CaseResult& result)
+{
+	result.ok = !samples.empty();
+	if (!result.ok)
+		return;
+
+	std::sort(samples.begin(), samples.end());
+	size_t n = samples.size();
+	result.mbPerSecond = median(samples);
+
+	double k = floor((double(n) - 1.96 * sqrt(double(n))) / 2);
+	size_t low = k > 0 ? size_t(k) : 0;
+	if (low >= n)
+		low = n - 1;
+	result.ciLow = samples[low];
+	result.ciHigh = samples[n - 1 - low];
+}
+
+// Throughput of each run of c, in MB/s; empty on failure
+static std::vector<double> measureCase(const CompareCase& c, const CompareOptions& options)
+{
+	std::vector<double> samples;
+	std::string input;
+	if (!makeCodecInput(c.rawInflate ? CodecId::samlEncode : c.id, c.input, options.size, input))
+		return samples;
+
+	std::function<bool(size_t&)> run;
+	std::string deflated;
+	std::vector<unsigned char> inflated;
+	if (c.rawInflate)
+	{
+		static const bool tinfInitialized = (tinf_init(), true);
+		(void)tinfInitialized;
+
+		unsigned int deflatedLength = tdef_bound(unsigned(input.length()));
+		deflated.resize(deflatedLength);
+		if (tdef_compress(&deflated[0], &deflatedLength, input.data(), unsigned(input.length()), TDEF_LEVEL_DEFAULT) != TDEF_OK)
+			return samples;
+		deflated.resize(deflatedLength);
+		inflated.resize(input.length());
+
+		run = [&](size_t& outputLength)
+		{
+			unsigned int length = unsigned(inflated.size());
+			bool ok = tinf_uncompress(inflated.data(), &length, deflated.data(), unsigned(deflated.length())) == TINF_OK;
+			outputLength = length;
+			return ok;
+		};
+	}
+	else
+	{
+		run = [&](size_t& outputLength)
+		{
+			std::string output;
+			bool ok = convertText(c.id, input.data(), input.length(), output);
+			outputLength = output.length();
+			return ok;
+		};
+	}
+
+	// the raw inflate is counted on the XML it restores
+	measureFunction(run, input.length(), 0, options.warmupRuns, options.warmupRuns);
+	BenchMeasure measure = measureFunction(run, input.length(), 0, options.runs, options.runs);
+	if (measure.ok)
+	{
+		for (double seconds : measure.seconds)
+			samples.push_back(seconds > 0 ? double(input.length()) / (1 << 20) / seconds : 0);
+	}
+	return samples;
+}
+
+static void setThreads(const char *threads)
+{
+#ifdef _WIN32
+	_putenv_s("MIMETOOLS_THREADS", threads);
+#else
+	setenv("MIMETOOLS_THREADS", threads, 1);
+#endif
+}
+
+// Measure c in a process of exe (--measure), adding the throughputs it prints to samples
+static bool runMeasure(const std::string& exe, const CompareCase& c, const CompareOptions& options, std::vector<double>& samples)
+{
+	// 0: a thread per core
+	setThreads(c.parallel ? "0" : "1");
+	std::string command = "\"" + exe + "\" --measure " + c.name + " --runs " + std::to_string(options.runs) + " --size " + std::to_string(options.size);
+#ifdef _WIN32
+	// cmd.exe removes the first and the last quote of the line
+	command = "\"" + command + "\"";
+#endif
+
+	FILE *pipe = popen(command.c_str(), "r");
+	if (!pipe)
+		return false;
+	size_t count = 0;
+	double value;
+	while (fscanf(pipe, "%lf", &value) == 1)
+	{
+		samples.push_back(value);
+		++count;
+	}
+	return pclose(pipe) == 0 && count == options.runs;
+}
+
+// Both builds, interleaved round by round; false if a process failed
+static bool compareCase(const CompareCase& c, const CompareOptions& options, CaseResult& baseline, CaseResult& candidate)
+{
+	std::vector<double> baselineSamples, candidateSamples;
+	for (unsigned round = 0; round < options.rounds; ++round)
+	{
+		bool baselineFirst = round % 2 == 0;
+		for (int k = 0; k < 2; ++k)
+		{
+			bool isBaseline = (k == 0) == baselineFirst;
+			if (!runMeasure(isBaseline ? options.baselineExe : options.candidateExe, c, options, isBaseline ? baselineSamples : candidateSamples))
+				return false;
+		}
+	}
+	summarize(baselineSamples, baseline);
+	summarize(candidateSamples, candidate);
+	return true;
+}
+
+static bool isRegression(const CaseResult& baseline, const CaseResult& candidate, double fraction)
+{
+	return candidate.ciHigh < fraction * baseline.mbPerSecond;
+}
+
+static bool parseOptions(int argc, char *argv[], CompareOptions& options)
+{
+	options.candidateExe = argv[0];
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+			return false;
+
+		if (strcmp(arg, "--baseline-exe") == 0)
+			options.baselineExe = value;
+		else if (strcmp(arg, "--measure") == 0)
+			options.measure = value;
+		else if (strcmp(arg, "--fraction") == 0)
+			options.fraction = atof(value);
+		else if (strcmp(arg, "--rounds") == 0)
+			options.rounds = unsigned(atoi(value));
+		else if (strcmp(arg, "--runs") == 0)
+			options.runs = unsigned(atoi(value));
+		else if (strcmp(arg, "--size") == 0)
+			options.size = parseSize(value);
+		else
+			return false;
+		++i;
+	}
+	return (!options.baselineExe.empty() || !options.measure.empty()) && options.rounds > 0 && options.runs > 0 && options.size > 0;
+}
+
+int main(int argc, char *argv[])
+{
+	CompareOptions options;
+	if (!parseOptions(argc, argv, options))
+	{
+		usage(stderr);
+		return 2;
+	}
+
+	// In a process started by the comparison: the throughput of each run, one per line
+	if (!options.measure.empty())
+	{
+		for (const CompareCase& c : cases)
+		{
+			if (options.measure != c.name)
+				continue;
+			std::vector<double> samples = measureCase(c, options);
+			for (double sample : samples)
+				printf("%.3f\n", sample);
+			return samples.empty() ? 2 : 0;
+		}
+		fprintf(stderr, "mimetools-bench-compare: no case %s\n", options.measure.c_str());
+		return 2;
+	}
+
+	printf("%-36s %10s %10s %21s %8s\n", "case", "baseline", "MB/s", "95% interval", "ratio");
+	int regressions = 0;
+	for (const CompareCase& c : cases)
+	{
+		CaseResult baseline, candidate;
+		if (!compareCase(c, options, baseline, candidate))
+		{
+			fprintf(stderr, "mimetools-bench-compare: %s failed (a baseline without --measure is too old to compare with)\n", c.name);
+			return 2;
+		}
+
+		// a regression is only reported if a second measure shows it too
+		const char *verdict = "";
+		if (isRegression(baseline, candidate, options.fraction))
+		{
+			CaseResult baselineAgain, candidateAgain;
+			if (!compareCase(c, options, baselineAgain, candidateAgain))
+			{
+				fprintf(stderr, "mimetools-bench-compare: %s failed\n", c.name);
+				return 2;
+			}
+			if (!isRegression(baselineAgain, candidateAgain, options.fraction))
+				verdict = "  not repeated";
+			else if (c.parallel)
+				verdict = "  slower (not gated)";
+			else
+			{
+				verdict = "  REGRESSION";
+				++regressions;
+			}
+			baseline = baselineAgain;
+			candidate = candidateAgain;
+		}
+
+		char interval[32];
+		snprintf(interval, sizeof(interval), "[%.1f, %.1f]", candidate.ciLow, candidate.ciHigh);
+		printf("%-36s %10.1f %10.1f %21s %8.2f%s\n", c.name, baseline.mbPerSecond, candidate.mbPerSecond, interval,
+			baseline.mbPerSecond > 0 ? candidate.mbPerSecond / baseline.mbPerSecond : 0, verdict);
+		fflush(stdout);
+	}
+
+	if (regressions)
+		printf("\n%d case(s) below %.0f%% of the baseline build, twice\n", regressions, options.fraction * 100);
+	return regressions ? 1 : 0;
+}
@@ -0,0 +1,356 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchInputs.h"
+
+const InputInfo inputInfos[] = {
+	{ InputKind::ascii,  "ascii" },
+	{ InputKind::binary, "binary" },
+	{ InputKind::utf8,   "utf8" },
+	{ InputKind::escape, "escape" },
+	{ InputKind::saml,   "saml" },
+	{ InputKind::log,    "log" }
+};
+
+const size_t inputCount = sizeof(inputInfos) / sizeof(inputInfos[0]);
+
+static const char *const words[] = {
+	"the", "of", "and", "to", "in", "is", "you", "that", "it", "he", "was", "for", "on", "are",
+	"as", "with", "his", "they", "at", "be", "this", "have", "from", "or", "one", "had", "by",
+	"word", "but", "not", "what", "all", "were", "we", "when", "your", "can", "said", "there",
+	"use", "an", "each", "which", "she", "do", "how", "their", "if", "will", "up", "other",
+	"about", "out", "many", "then", "them", "these", "so", "some", "her", "would", "make"
+};
+
+static void generateAscii(BenchRandom& random, size_t size, std::string& out)
+{
+	size_t lineLength = 0;
+	while (out.length() < size)
+	{
+		const char *word = words[random.below(sizeof(words) / sizeof(words[0]))];
+		out += word;
+		lineLength += strlen(word);
+		if (lineLength > 60 + random.below(20))
+		{
+			out += random.below(8) == 0 ? ".\r\n" : "\r\n";
+			lineLength = 0;
+		}
+		else
+		{
+			out += ' ';
+			++lineLength;
+		}
+	}
+}
+
+static void generateBinary(BenchRandom& random, size_t size, std::string& out)
+{
+	while (out.length() < size)
+	{
+		uint64_t bits = random.next();
+		for (int i = 0; i < 8; ++i, bits >>= 8)
+			out += char(bits % 255 + 1);
+	}
+}
+
+static void appendUtf8(uint32_t codePoint, std::string& out)
+{
+	if (codePoint < 0x80)
+		out += char(codePoint);
+	else if (codePoint < 0x800)
+	{
+		out += char(0xC0 | (codePoint >> 6));
+		out += char(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000)
+	{
+		out += char(0xE0 | (codePoint >> 12));
+		out += char(0x80 | ((codePoint >> 6) & 0x3F));
+		out += char(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		out += char(0xF0 | (codePoint >> 18));
+		out += char(0x80 | ((codePoint >> 12) & 0x3F));
+		out += char(0x80 | ((codePoint >> 6) & 0x3F));
+		out += char(0x80 | (codePoint & 0x3F));
+	}
+}
+
+static void generateUtf8(BenchRandom& random, size_t size, std::string& out)
+{
+	while (out.length() < size)
+	{
+		switch (random.below(8))
+		{
+			case 0:
+				appendUtf8(0xE0 + random.below(0x60), out);          // Latin-1 letters
+				break;
+			case 1:
+				appendUtf8(0x3B1 + random.below(25), out);           // Greek
+				break;
+			case 2:
+				appendUtf8(0x4E00 + random.below(0x5000), out);      // CJK
+				break;
+			case 3:
+				appendUtf8(0x1F600 + random.below(0x50), out);       // emoji
+				break;
+			case 4:
+				out += random.below(10) == 0 ? "\r\n" : " ";
+				break;
+			default:
+				out += char('a' + random.below(26));
+				break;
+		}
+	}
+}
+
+// Characters escaped by every URL encoding and by quoted-printable
+static void generateEscape(BenchRandom& random, size_t size, std::string& out)
+{
+	static const char escaped[] = "%=<>\"#{}|\\^~[]`";
+	while (out.length() < size)
+	{
+		if (random.below(2) == 0)
+			out += escaped[random.below(sizeof(escaped) - 1)];
+		else
+			out += char(0x80 + random.below(0x80));
+	}
+}
+
+static void generateSaml(BenchRandom& random, size_t size, std::string& out)
+{
+	out = "<samlp:Response xmlns:samlp=\"urn:oasis:names:tc:SAML:2.0:protocol\" ID=\"_bench\" Version=\"2.0\">"
+		"<saml:Issuer>https://idp.example.com/metadata</saml:Issuer>"
+		"<saml:Assertion><saml:Subject><saml:NameID>user@example.com</saml:NameID></saml:Subject>"
+		"<saml:AttributeStatement>";
+	static const char closing[] = "</saml:AttributeStatement></saml:Assertion></samlp:Response>";
+
+	std::string value;
+	for (size_t index = 0; out.length() + sizeof(closing) < size; ++index)
+	{
+		value.clear();
+		generateAscii(random, 16 + random.below(48), value);
+		for (char& c : value)
+		{
+			if (c == '\r' || c == '\n')
+				c = ' ';
+		}
+		out += "<saml:Attribute Name=\"attribute";
+		out += std::to_string(index);
+		out += "\"><saml:AttributeValue>";
+		out += value;
+		out += "</saml:AttributeValue></saml:Attribute>";
+	}
+	out += closing;
+}
+
+static void generateLog(BenchRandom& random, size_t size, std::string& out)
+{
+	std::string payload;
+	std::string encoded;
+	for (unsigned long index = 0; out.length() < size; ++index)
+	{
+		char prefix[64];
+		snprintf(prefix, sizeof(prefix), "2024-03-%02u 12:%02u:%02u.%03u INFO worker-%u request %lu",
+			1 + random.below(28), random.below(60), random.below(60), random.below(1000), random.below(16), index);
+		out += prefix;
+
+		if (random.below(4) != 0)
+		{
+			payload.clear();
+			generateAscii(random, 24 + random.below(200), payload);
+			convertText(CodecId::base64EncodePad, payload.data(), payload.length(), encoded);
+			out += " payload=";
+			out += encoded;
+		}
+		out += random.below(8) == 0 ? " status=retry\r\n" : " status=ok\r\n";
+	}
+}
+
+std::string generateInput(InputKind kind, size_t size, uint64_t seed)
+{
+	BenchRandom random(seed);
+	std::string out;
+	out.reserve(size + 64);
+
+	switch (kind)
+	{
+		case InputKind::ascii:
+			generateAscii(random, size, out);
+			break;
+		case InputKind::binary:
+			generateBinary(random, size, out);
+			break;
+		case InputKind::utf8:
+			generateUtf8(random, size, out);
+			break;
+		case InputKind::escape:
+			generateEscape(random, size, out);
+			break;
+		case InputKind::saml:
+			generateSaml(random, size, out);
+			return out;
+		case InputKind::log:
+			generateLog(random, size, out);
+			break;
+	}
+	out.resize(size);
+	return out;
+}
+
+// The encoder whose output a decoder is benchmarked on
+static bool matchingEncoder(CodecId decoder, CodecId& encoder)
+{
+	switch (decoder)
+	{
+		case CodecId::base64Decode:
+		case CodecId::base64DecodeStrict:
+		case CodecId::smartDecode:
+			encoder = CodecId::base64EncodePad;
+			return true;
+		case CodecId::base64DecodeByLine:
+			encoder = CodecId::base64EncodeByLine;
+			return true;
+		case CodecId::qpDecode:
+			encoder = CodecId::qpEncode;
+			return true;
+		case CodecId::urlDecode:
+			encoder = CodecId::urlEncodeFull;
+			return true;
+		case CodecId::samlDecode:
+			encoder = CodecId::samlEncode;
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool makeCodecInput(CodecId id, InputKind kind, size_t size, std::string& input, uint64_t seed)
+{
+	// a pipeline has no input of its own: its stages are measured one by one
+	if (id == CodecId::pipeline)
+		return false;
+
+	// SAML conversions are only meaningful on SAML messages
+	bool isSaml = id == CodecId::samlDecode || id == CodecId::samlEncode;
+	if (isSaml != (kind == InputKind::saml) || kind == InputKind::log)
+		return false;
+
+	input = generateInput(kind, size, seed);
+
+	CodecId encoder;
+	if (matchingEncoder(id, encoder))
+	{
+		std::string encoded;
+		if (!convertText(encoder, input.data(), input.length(), encoded))
+			return false;
+		input.swap(encoded);
+
+		// the QP decoder only takes CRLF line breaks: binary lines encoded with bare LF are not decodable
+		std::string decoded;
+		if (!convertText(id, input.data(), input.length(), decoded))
+			return false;
+	}
+	return true;
+}
+
+std::string fixedHuffmanDeflate(const std::string& input, size_t blockLength)
+{
+	std::string out;
+	uint64_t bitBuffer = 0;
+	int bitCount = 0;
+	auto putBits = [&](uint32_t value, int n)
+	{
+		bitBuffer |= uint64_t(value) << bitCount;
+		for (bitCount += n; bitCount >= 8; bitCount -= 8)
+		{
+			out += char(bitBuffer & 0xff);
+			bitBuffer >>= 8;
+		}
+	};
+	// Huffman codes go most significant bit first
+	auto putCode = [&](uint32_t code, int n)
+	{
+		uint32_t reversed = 0;
+		for (int i = 0; i < n; ++i)
+			reversed |= ((code >> i) & 1) << (n - 1 - i);
+		putBits(reversed, n);
+	};
+
+	size_t start = 0;
+	do
+	{
+		size_t end = input.length() - start < blockLength ? input.length() : start + blockLength;
+		putBits(end == input.length() ? 1 : 0, 1);
+		putBits(1, 2);
+		for (size_t i = start; i < end; ++i)
+		{
+			uint8_t c = uint8_t(input[i]);
+			if (c < 144)
+				putCode(0x30 + c, 8);
+			else
+				putCode(0x190 + c - 144, 9);
+		}
+		putCode(0, 7);
+		start = end;
+	} while (start < input.length());
+
+	if (bitCount)
+		out += char(bitBuffer & 0xff);
+	return out;
+}
+
+size_t parseSize(const char *text)
+{
+	char *end = nullptr;
+	unsigned long long value = strtoull(text, &end, 10);
+	if (end == text)
+		return 0;
+
+	switch (*end)
+	{
+		case 'k': case 'K':
+			value <<= 10;
+			++end;
+			break;
+		case 'm': case 'M':
+			value <<= 20;
+			++end;
+			break;
+		case 'g': case 'G':
+			value <<= 30;
+			++end;
+			break;
+	}
+	return *end ? 0 : size_t(value);
+}
+
+std::string formatSize(size_t size)
+{
+	if (size >= (1 << 30) && size % (1 << 30) == 0)
+		return std::to_string(size >> 30) + "G";
+	if (size >= (1 << 20) && size % (1 << 20) == 0)
+		return std::to_string(size >> 20) + "M";
+	if (size >= (1 << 10) && size % (1 << 10) == 0)
+		return std::to_string(size >> 10) + "K";
+	return std::to_string(size);
+}
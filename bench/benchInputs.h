@@ -0,0 +1,80 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "codec.h"
+
+// Deterministic inputs for the benchmarks: the same name, size and seed always give
+// the same bytes, on every platform.
+
+enum class InputKind {
+	ascii,      // lines of English-like words
+	binary,     // random bytes (never 0: the one-shot QP and URL conversions stop at a null)
+	utf8,       // lines mixing 1 to 4 bytes UTF-8 sequences
+	escape,     // worst case for the escaping encoders: only characters that need escaping
+	saml,       // a SAML response whose attribute values fill the requested size
+	log         // log lines, most with a base64 payload (for the base64 run scan, not the conversions)
+};
+
+struct InputInfo
+{
+	InputKind kind;
+	const char *name;
+};
+
+extern const InputInfo inputInfos[];
+extern const size_t inputCount;
+
+// xorshift64*, seeded so that a run is reproducible
+class BenchRandom {
+public:
+	explicit BenchRandom(uint64_t seed = 0x9E3779B97F4A7C15ULL) : _state(seed ? seed : 1) {};
+
+	uint64_t next()
+	{
+		_state ^= _state >> 12;
+		_state ^= _state << 25;
+		_state ^= _state >> 27;
+		return _state * 0x2545F4914F6CDD1DULL;
+	};
+
+	uint32_t below(uint32_t bound) { return uint32_t(next() >> 32) % bound; };
+
+private:
+	uint64_t _state;
+};
+
+// size bytes of the given kind
+std::string generateInput(InputKind kind, size_t size, uint64_t seed = 1);
+
+// What the benchmark of a conversion is fed with: the generated text itself for the
+// encoders, the matching encoder output for the decoders (so that it is valid).
+// Return false if the pair makes no sense (SAML conversions of non SAML text) or if the
+// decoder does not take what the encoder wrote.
+bool makeCodecInput(CodecId id, InputKind kind, size_t size, std::string& input, uint64_t seed = 1);
+
+// A raw deflate stream of input made of fixed Huffman blocks of literals only, which
+// tdeflate never writes (a dynamic block always costs less on 16K symbols)
+std::string fixedHuffmanDeflate(const std::string& input, size_t blockLength = 16384);
+
+// "64K" -> 65536, "1G" -> 1 << 30; 0 when not a size
+size_t parseSize(const char *text);
+std::string formatSize(size_t size);
@@ -0,0 +1,167 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BENCH_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_RDTSC
+#endif
+
+#include "benchRunner.h"
+
+// Every allocation of the benchmark goes through these, the codecs' included
+// (the C inflate/deflate code uses malloc and is not counted)
+static std::atomic<uint64_t> g_allocations(0);
+static std::atomic<uint64_t> g_allocatedBytes(0);
+
+void *operator new(size_t size)
+{
+	++g_allocations;
+	g_allocatedBytes += size;
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+
+uint64_t allocationCount()
+{
+	return g_allocations;
+}
+
+uint64_t allocatedByteCount()
+{
+	return g_allocatedBytes;
+}
+
+static uint64_t readCycles()
+{
+#ifdef BENCH_HAS_RDTSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+bool hasCycleCounter()
+{
+#ifdef BENCH_HAS_RDTSC
+	return true;
+#else
+	return false;
+#endif
+}
+
+double median(std::vector<double> values)
+{
+	if (values.empty())
+		return 0;
+	std::sort(values.begin(), values.end());
+	size_t middle = values.size() / 2;
+	return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+BenchMeasure measureFunction(const std::function<bool(size_t& outputLength)>& run, size_t inputLength, double minSeconds, unsigned minRuns, unsigned maxRuns)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	BenchMeasure measure;
+	std::vector<double> cycles;
+	double total = 0;
+	uint64_t allocations = 0;
+	uint64_t allocatedBytes = 0;
+
+	while (measure.runs < maxRuns && (measure.runs < minRuns || total < minSeconds))
+	{
+		size_t outputLength = 0;
+		uint64_t allocationsBefore = g_allocations;
+		uint64_t bytesBefore = g_allocatedBytes;
+		uint64_t cyclesBefore = readCycles();
+		Clock::time_point start = Clock::now();
+
+		measure.ok = run(outputLength);
+
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		cycles.push_back(double(readCycles() - cyclesBefore));
+		allocations += g_allocations - allocationsBefore;
+		allocatedBytes += g_allocatedBytes - bytesBefore;
+
+		if (!measure.ok)
+			return measure;
+
+		measure.outputLength = outputLength;
+		measure.seconds.push_back(seconds);
+		total += seconds;
+		++measure.runs;
+	}
+
+	if (measure.runs == 0)
+		return measure;
+
+	measure.medianSeconds = median(measure.seconds);
+	if (measure.medianSeconds > 0)
+		measure.mbPerSecond = double(inputLength) / (1 << 20) / measure.medianSeconds;
+	if (hasCycleCounter() && inputLength > 0)
+		measure.cyclesPerByte = median(cycles) / double(inputLength);
+	measure.allocations = allocations / measure.runs;
+	measure.allocatedBytes = allocatedBytes / measure.runs;
+	return measure;
+}
+
+BenchMeasure measureConversion(CodecId id, const std::string& input, double minSeconds, unsigned minRuns, unsigned maxRuns)
+{
+	return measureFunction([&](size_t& outputLength)
+	{
+		std::string output;
+		bool ok = convertText(id, input.data(), input.length(), output);
+		outputLength = output.length();
+		return ok;
+	}, input.length(), minSeconds, minRuns, maxRuns);
+}
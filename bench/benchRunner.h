@@ -0,0 +1,54 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "codec.h"
+
+// Measurement of one conversion of one input, repeated
+struct BenchMeasure
+{
+	bool ok = false;
+	unsigned runs = 0;
+	std::vector<double> seconds;   // of each run
+	double medianSeconds = 0;
+	double mbPerSecond = 0;        // input bytes per median run
+	double cyclesPerByte = -1;     // time stamp counter cycles, -1 where there is none
+	uint64_t allocations = 0;      // operator new calls per run
+	uint64_t allocatedBytes = 0;   // bytes asked to operator new per run
+	size_t outputLength = 0;
+};
+
+// Call run until minSeconds elapsed and at least minRuns runs were done, at most maxRuns.
+// run returns false on failure and sets the output length; throughput is counted on inputLength.
+BenchMeasure measureFunction(const std::function<bool(size_t& outputLength)>& run, size_t inputLength, double minSeconds, unsigned minRuns = 1, unsigned maxRuns = 1000);
+
+// The same for a conversion, run as a menu command does: convertText() over the whole input
+BenchMeasure measureConversion(CodecId id, const std::string& input, double minSeconds, unsigned minRuns = 1, unsigned maxRuns = 1000);
+
+// operator new calls and bytes since the start of the program (counted on every thread)
+uint64_t allocationCount();
+uint64_t allocatedByteCount();
+
+bool hasCycleCounter();
+
+double median(std::vector<double> values);
@@ -0,0 +1,52 @@
+# Build mimetools-bench-compare from a git revision of the sources, for benchmark-compare
+# (see CMakeLists.txt):
+#	cmake -DSOURCE_DIR=. -DREVISION=HEAD -DBINARY_DIR=build/bench-baseline -DOUTPUT=exe
+#	      -DEXECUTABLE=mimetools-bench-compare -DGENERATOR=Ninja -DBUILD_TYPE=Release -DTRACE=ON -DSANITIZE= -P bench/buildBaseline.cmake
+# The build is kept, and only done again when the revision names another commit.
+
+find_package(Git REQUIRED)
+
+function(run)
+	execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+	if(result)
+		message(FATAL_ERROR "baseline build of ${REVISION}: ${ARGN} failed")
+	endif()
+endfunction()
+
+execute_process(COMMAND ${GIT_EXECUTABLE} -C ${SOURCE_DIR} rev-parse --verify "${REVISION}^{commit}"
+	OUTPUT_VARIABLE commit OUTPUT_STRIP_TRAILING_WHITESPACE RESULT_VARIABLE result)
+if(result)
+	message(FATAL_ERROR "baseline build: ${REVISION} is not a commit of ${SOURCE_DIR}")
+endif()
+
+set(stamp ${BINARY_DIR}/commit.txt)
+if(EXISTS ${stamp} AND EXISTS ${OUTPUT})
+	file(READ ${stamp} builtCommit)
+	if(builtCommit STREQUAL commit)
+		message(STATUS "Baseline ${REVISION} (${commit}) already built")
+		return()
+	endif()
+endif()
+
+message(STATUS "Building the baseline ${REVISION} (${commit})")
+file(REMOVE_RECURSE ${BINARY_DIR})
+file(MAKE_DIRECTORY ${BINARY_DIR}/source ${BINARY_DIR}/build)
+run(${GIT_EXECUTABLE} -C ${SOURCE_DIR} archive --format=tar -o ${BINARY_DIR}/source.tar ${commit})
+execute_process(COMMAND ${CMAKE_COMMAND} -E tar xf ${BINARY_DIR}/source.tar WORKING_DIRECTORY ${BINARY_DIR}/source)
+
+execute_process(COMMAND ${CMAKE_COMMAND} -G ${GENERATOR} -DCMAKE_BUILD_TYPE=${BUILD_TYPE}
+		-DMIMETOOLS_TRACE=${TRACE} -DMIMETOOLS_SANITIZE=${SANITIZE} ${BINARY_DIR}/source
+	WORKING_DIRECTORY ${BINARY_DIR}/build RESULT_VARIABLE result)
+if(result)
+	message(FATAL_ERROR "baseline build: cannot configure ${REVISION}")
+endif()
+run(${CMAKE_COMMAND} --build ${BINARY_DIR}/build --config ${BUILD_TYPE} --target mimetools-bench-compare)
+
+# multi-configuration generators put it in a directory of the configuration
+file(GLOB_RECURSE built ${BINARY_DIR}/build/${EXECUTABLE})
+if(NOT built)
+	message(FATAL_ERROR "baseline build: no ${EXECUTABLE} in ${BINARY_DIR}/build")
+endif()
+list(GET built 0 built)
+run(${CMAKE_COMMAND} -E copy ${built} ${OUTPUT})
+file(WRITE ${stamp} ${commit})
@@ -0,0 +1,212 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// mimetools-complexity: every conversion on its pathological inputs, at two sizes.
+//
+// A conversion is linear when the time per input byte does not grow with the size:
+// each case is measured on n and growth * n bytes, and fails when the time per byte
+// of the large input is more than tolerance times the one of the small input.
+// A quadratic path gives a ratio of growth (8 by default), a linear one stays near 1.
+// Exit status 1 if any case fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "codec.h"
+#include "benchInputs.h"
+#include "benchRunner.h"
+
+// Input of the given size, built to stress one conversion
+typedef std::string (*Pathology)(size_t size);
+
+struct ComplexityCase
+{
+	CodecId id;
+	const char *pathology;
+	Pathology generate;
+};
+
+static std::string repeat(const char *pattern, size_t size)
+{
+	std::string out;
+	size_t length = strlen(pattern);
+	out.reserve(size + length);
+	while (out.length() < size)
+		out += pattern;
+	out.resize(size);
+	return out;
+}
+
+// text which cuts a pattern in the middle would not be valid for the decoders
+static std::string repeatWhole(const char *pattern, size_t size)
+{
+	size_t length = strlen(pattern);
+	return repeat(pattern, size / length * length);
+}
+
+static std::string allEol(size_t size)                { return repeat("\r\n", size); }
+static std::string allLf(size_t size)                 { return repeat("\n", size); }
+static std::string allSame(size_t size)               { return repeat("a", size); }
+static std::string allBinary(size_t size)             { return generateInput(InputKind::binary, size); }
+static std::string allHigh(size_t size)               { return generateInput(InputKind::escape, size); }
+static std::string allPad(size_t size)                { return repeatWhole("====", size); }
+static std::string allIgnored(size_t size)            { return repeat(" \t", size); }
+static std::string shortBase64Lines(size_t size)      { return repeatWhole("QQ==\n", size); }
+static std::string base64Text(size_t size)            { return repeatWhole("QUJD", size); }
+static std::string shortQpLines(size_t size)          { return repeatWhole("a\r\n", size); }
+static std::string emptyQpLines(size_t size)          { return repeatWhole("\r\n", size); }
+static std::string allQpEscapes(size_t size)          { return repeatWhole("=C3=A9", size); }
+static std::string allSoftBreaks(size_t size)         { return repeatWhole("=\r\n", size); }
+static std::string allPercentEscapes(size_t size)     { return repeatWhole("%C3%A9", size); }
+static std::string allPercents(size_t size)           { return repeatWhole("%25", size); }
+
+// The SAML decoders are fed messages whose compression ratio does not depend on their size,
+// otherwise the time per (compressed) input byte would grow with the size for a linear decoder
+static std::string encodedSaml(const std::string& xml)
+{
+	std::string encoded;
+	convertText(CodecId::samlEncode, xml.data(), xml.length(), encoded);
+	return encoded;
+}
+
+static std::string manySamlElements(size_t size)
+{
+	BenchRandom random;
+	std::string xml = "<samlp:Response>";
+	while (xml.length() < size)
+		xml += "<a" + std::to_string(random.below(1 << 30)) + "/>";
+	xml += "</samlp:Response>";
+	return encodedSaml(xml);
+}
+
+static std::string samlAttributes(size_t size)        { return encodedSaml(generateInput(InputKind::saml, size)); }
+static std::string samlXml(size_t size)               { return generateInput(InputKind::saml, size); }
+static std::string samlSameText(size_t size)          { return "<samlp:Response>" + repeat("a", size) + "</samlp:Response>"; }
+
+static const ComplexityCase cases[] = {
+	{ CodecId::base64Encode,            "binary",              allBinary },
+	{ CodecId::base64EncodeWrap,        "binary",              allBinary },
+	{ CodecId::base64EncodeByLine,      "all CRLF",            allEol },
+	{ CodecId::base64EncodeByLine,      "all LF",              allLf },
+	{ CodecId::base64Decode,            "base64",              base64Text },
+	{ CodecId::base64Decode,            "all padding",         allPad },
+	{ CodecId::base64Decode,            "all ignored",         allIgnored },
+	{ CodecId::base64DecodeStrict,      "base64",              base64Text },
+	{ CodecId::base64DecodeByLine,      "short lines",         shortBase64Lines },
+	{ CodecId::qpEncode,                "all escaped",         allHigh },
+	{ CodecId::qpEncode,                "all LF",              allLf },
+	{ CodecId::qpEncode,                "no escape",           allSame },
+	{ CodecId::qpDecode,                "short lines",         shortQpLines },
+	{ CodecId::qpDecode,                "empty lines",         emptyQpLines },
+	{ CodecId::qpDecode,                "all escapes",         allQpEscapes },
+	{ CodecId::qpDecode,                "all soft breaks",     allSoftBreaks },
+	{ CodecId::urlEncodeRFC1738,        "all escaped",         allHigh },
+	{ CodecId::urlEncodeRFC1738ByLine,  "all CRLF",            allEol },
+	{ CodecId::urlEncodeExtended,       "all escaped",         allHigh },
+	{ CodecId::urlEncodeExtendedByLine, "all CRLF",            allEol },
+	{ CodecId::urlEncodeFull,           "binary",              allBinary },
+	{ CodecId::urlEncodeFullByLine,     "all CRLF",            allEol },
+	{ CodecId::urlDecode,               "all escapes",         allPercentEscapes },
+	{ CodecId::urlDecode,               "all %25",             allPercents },
+	{ CodecId::samlDecode,              "many elements",       manySamlElements },
+	{ CodecId::samlDecode,              "attributes",          samlAttributes },
+	{ CodecId::samlEncode,              "attributes",          samlXml },
+	{ CodecId::samlEncode,              "one long text",       samlSameText },
+	{ CodecId::smartDecode,             "base64",              base64Text },
+	{ CodecId::smartDecode,             "all escapes",         allPercentEscapes }
+};
+
+static void usage(FILE *out)
+{
+	fprintf(out,
+		"usage: mimetools-complexity [--size n] [--growth g] [--tolerance t] [--min-time seconds]\n"
+		"\n"
+		"  --size       small input size (default 64K)\n"
+		"  --growth     the large input is growth times the small one (default 8)\n"
+		"  --tolerance  largest accepted ratio of the times per byte (default 3)\n"
+		"  --min-time   time spent on each measure, at least 3 runs (default 0.1)\n");
+}
+
+int main(int argc, char *argv[])
+{
+	size_t size = 64 << 10;
+	size_t growth = 8;
+	double tolerance = 3;
+	double minSeconds = 0.1;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+		{
+			usage(stderr);
+			return 2;
+		}
+		if (strcmp(argv[i], "--size") == 0)
+			size = parseSize(value);
+		else if (strcmp(argv[i], "--growth") == 0)
+			growth = size_t(atoi(value));
+		else if (strcmp(argv[i], "--tolerance") == 0)
+			tolerance = atof(value);
+		else if (strcmp(argv[i], "--min-time") == 0)
+			minSeconds = atof(value);
+		else
+		{
+			usage(stderr);
+			return 2;
+		}
+		++i;
+	}
+	if (size == 0 || growth < 2 || tolerance <= 0)
+	{
+		usage(stderr);
+		return 2;
+	}
+
+	printf("%-28s %-16s %12s %12s %8s\n", "conversion", "input", "ns/B small", "ns/B large", "ratio");
+
+	int failures = 0;
+	for (const ComplexityCase& c : cases)
+	{
+		const CodecInfo *info = codecInfo(c.id);
+		std::string small = c.generate(size);
+		std::string large = c.generate(size * growth);
+
+		BenchMeasure smallMeasure = measureConversion(c.id, small, minSeconds, 3);
+		BenchMeasure largeMeasure = measureConversion(c.id, large, minSeconds, 3);
+		if (!smallMeasure.ok || !largeMeasure.ok)
+		{
+			printf("%-28s %-16s conversion failed\n", info->name, c.pathology);
+			++failures;
+			continue;
+		}
+
+		double smallPerByte = smallMeasure.medianSeconds * 1e9 / double(small.length());
+		double largePerByte = largeMeasure.medianSeconds * 1e9 / double(large.length());
+		double ratio = smallPerByte > 0 ? largePerByte / smallPerByte : 0;
+		bool linear = ratio <= tolerance;
+
+		printf("%-28s %-16s %12.3f %12.3f %8.2f%s\n", info->name, c.pathology, smallPerByte, largePerByte, ratio, linear ? "" : "  NOT LINEAR");
+		fflush(stdout);
+		if (!linear)
+			++failures;
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,424 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// mimetools-bench: throughput of every conversion of the plugin on generated inputs
+//
+//	mimetools-bench                               every conversion, every input, 1K to 16M
+//	mimetools-bench --sizes 1K,1M,1G --mode base64-decode --input binary
+//	mimetools-bench --sizes 1G --mode base64-runs --input log
+//	mimetools-bench --mode base64-search --input ascii
+//	mimetools-bench --mode deflate-levels --input saml --sizes 1M
+//	MIMETOOLS_THREADS=4 mimetools-bench --mode parallel-inflate --input binary --sizes 16M
+//	mimetools-bench --mode token-preview --input saml --sizes 64K,16M
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "codec.h"
+#include "base64Runs.h"
+#include "base64Search.h"
+#include "parallel.h"
+#include "parallelInflate.h"
+#include "tdef.h"
+#include "tokenPreview.h"
+#include "benchInputs.h"
+#include "benchRunner.h"
+
+struct BenchOptions
+{
+	std::vector<size_t> sizes;
+	std::vector<CodecId> codecs;
+	std::vector<InputKind> inputs;
+	bool base64Runs = false;       // measure base64DecodeRuns() on the log inputs
+	bool base64Search = false;     // measure Base64Search on the base64 of the ascii inputs
+	bool deflateLevels = false;    // measure tdef_compress() at every level
+	bool parallelInflate = false;  // measure parallelInflate() cut in 1 to 16 chunks
+	bool tokenPreview = false;     // measure the latency of previewToken() on SAML Encode tokens
+	double minSeconds = 0.2;
+};
+
+// Not conversions: finding and decoding every base64 run of a text, searching
+// base64 text for a plain text it does not hold (a whole scan), and the raw deflate
+// of SAML Encode at each of its levels, the parallel inflate of stored, fixed and
+// dynamic Huffman streams, and the caret preview of a token
+static const char base64RunsMode[] = "base64-runs";
+static const char base64SearchMode[] = "base64-search";
+static const char deflateLevelsMode[] = "deflate-levels";
+static const char parallelInflateMode[] = "parallel-inflate";
+static const char tokenPreviewMode[] = "token-preview";
+static const char base64SearchText[] = "password=hunter2";
+
+static void usage(FILE *out)
+{
+	fprintf(out,
+		"usage: mimetools-bench [--sizes 1K,64K,1M,16M] [--mode conversion]... [--input kind]... [--min-time seconds]\n"
+		"\n"
+		"  --sizes     sizes of the generated texts (K, M and G suffixes), up to 1G\n"
+		"  --mode      conversion to run (default all, see mimetools-cli --list),\n"
+		"              base64-runs to find and decode the base64 runs of the log input,\n"
+		"              base64-search to search the base64 of the ascii input,\n"
+		"              deflate-levels for the speed and ratio of each deflate level,\n"
+		"              parallel-inflate for the inflate speed by number of chunks,\n"
+		"              or token-preview for the latency of the caret preview\n"
+		"  --input     ascii, binary, utf8, escape, saml or log (default all)\n"
+		"  --min-time  time spent on each measure, at least one run (default 0.2)\n");
+}
+
+static bool parseSizes(const char *list, std::vector<size_t>& sizes)
+{
+	std::string text(list);
+	size_t start = 0;
+	while (start <= text.length())
+	{
+		size_t comma = text.find(',', start);
+		if (comma == std::string::npos)
+			comma = text.length();
+		size_t size = parseSize(text.substr(start, comma - start).c_str());
+		if (size == 0)
+			return false;
+		sizes.push_back(size);
+		start = comma + 1;
+	}
+	return true;
+}
+
+static bool parseOptions(int argc, char *argv[], BenchOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (strcmp(arg, "--sizes") == 0 && value)
+		{
+			if (!parseSizes(value, options.sizes))
+				return false;
+		}
+		else if (strcmp(arg, "--mode") == 0 && value && strcmp(value, base64RunsMode) == 0)
+			options.base64Runs = true;
+		else if (strcmp(arg, "--mode") == 0 && value && strcmp(value, base64SearchMode) == 0)
+			options.base64Search = true;
+		else if (strcmp(arg, "--mode") == 0 && value && strcmp(value, deflateLevelsMode) == 0)
+			options.deflateLevels = true;
+		else if (strcmp(arg, "--mode") == 0 && value && strcmp(value, parallelInflateMode) == 0)
+			options.parallelInflate = true;
+		else if (strcmp(arg, "--mode") == 0 && value && strcmp(value, tokenPreviewMode) == 0)
+			options.tokenPreview = true;
+		else if (strcmp(arg, "--mode") == 0 && value)
+		{
+			const CodecInfo *info = findCodec(value);
+			if (!info)
+				return false;
+			options.codecs.push_back(info->id);
+		}
+		else if (strcmp(arg, "--input") == 0 && value)
+		{
+			size_t k = 0;
+			while (k < inputCount && strcmp(inputInfos[k].name, value) != 0)
+				++k;
+			if (k == inputCount)
+				return false;
+			options.inputs.push_back(inputInfos[k].kind);
+		}
+		else if (strcmp(arg, "--min-time") == 0 && value)
+			options.minSeconds = atof(value);
+		else
+			return false;
+		++i;
+	}
+
+	if (options.sizes.empty())
+		options.sizes = { 1 << 10, 64 << 10, 1 << 20, 16 << 20 };
+	if (options.codecs.empty() && !options.base64Runs && !options.base64Search && !options.deflateLevels && !options.parallelInflate
+		&& !options.tokenPreview)
+	{
+		for (size_t i = 0; i < codecCount(); ++i)
+			options.codecs.push_back(static_cast<CodecId>(i));
+		options.base64Runs = true;
+		options.base64Search = true;
+		options.deflateLevels = true;
+		options.parallelInflate = true;
+		options.tokenPreview = true;
+	}
+	if (options.inputs.empty())
+	{
+		for (size_t k = 0; k < inputCount; ++k)
+			options.inputs.push_back(inputInfos[k].kind);
+	}
+	return true;
+}
+
+static const char *inputName(InputKind kind)
+{
+	for (size_t k = 0; k < inputCount; ++k)
+	{
+		if (inputInfos[k].kind == kind)
+			return inputInfos[k].name;
+	}
+	return "";
+}
+
+// One line of the results table; false if the measured run failed
+static bool printMeasure(const char *name, InputKind kind, size_t size, const std::string& input, const BenchMeasure& measure)
+{
+	if (!measure.ok)
+	{
+		printf("%-28s %-7s %6s conversion failed\n", name, inputName(kind), formatSize(size).c_str());
+		return false;
+	}
+
+	char cycles[16] = "-";
+	if (measure.cyclesPerByte >= 0)
+		snprintf(cycles, sizeof(cycles), "%.2f", measure.cyclesPerByte);
+
+	printf("%-28s %-7s %6s %11zu %10u %10.1f %8s %12llu %12llu\n",
+		name, inputName(kind), formatSize(size).c_str(), input.length(), measure.runs,
+		measure.mbPerSecond, cycles,
+		(unsigned long long)measure.allocations, (unsigned long long)measure.allocatedBytes);
+	fflush(stdout);
+	return true;
+}
+
+// Compression speed and ratio (deflated / input bytes) of every level, in a table of its own
+static int benchDeflateLevels(const BenchOptions& options)
+{
+	printf("\n%-28s %-7s %6s %11s %11s %7s %10s\n", "deflate level", "input", "size", "input bytes", "deflated", "ratio", "MB/s");
+
+	int failures = 0;
+	for (InputKind kind : options.inputs)
+	{
+		if (kind == InputKind::log)
+			continue;
+		for (size_t size : options.sizes)
+		{
+			std::string input = generateInput(kind, size);
+			std::string deflated(tdef_bound(unsigned(input.length())), '\0');
+			for (int level = TDEF_LEVEL_STORE; level <= TDEF_LEVEL_BEST; ++level)
+			{
+				BenchMeasure measure = measureFunction([&](size_t& outputLength)
+				{
+					unsigned int deflatedLength = unsigned(deflated.length());
+					bool ok = tdef_compress(&deflated[0], &deflatedLength, input.data(), unsigned(input.length()), level) == TDEF_OK;
+					outputLength = deflatedLength;
+					return ok;
+				}, input.length(), options.minSeconds);
+
+				std::string name = "level " + std::to_string(level);
+				if (!measure.ok)
+				{
+					printf("%-28s %-7s %6s compression failed\n", name.c_str(), inputName(kind), formatSize(size).c_str());
+					++failures;
+					continue;
+				}
+				double ratio = input.empty() ? 0 : double(measure.outputLength) / double(input.length());
+				printf("%-28s %-7s %6s %11zu %11zu %7.3f %10.1f\n",
+					name.c_str(), inputName(kind), formatSize(size).c_str(), input.length(), measure.outputLength, ratio, measure.mbPerSecond);
+				fflush(stdout);
+			}
+		}
+	}
+	return failures;
+}
+
+// Inflate speed (of the inflated bytes) of each stream cut in 1 to 16 chunks, in a table of
+// its own. The threads come from MIMETOOLS_THREADS, fixed for the process: run the mode
+// once per value to sweep them. The binary input is deflated to stored blocks and to fixed
+// Huffman blocks, the others to dynamic ones.
+static int benchParallelInflate(const BenchOptions& options)
+{
+	static const unsigned int chunkCounts[] = { 1, 2, 4, 8, 16 };
+	printf("\n%-28s %-7s %6s %8s %7s %11s %10s\n", "parallel inflate", "input", "size", "threads", "chunks", "deflated", "MB/s");
+
+	int failures = 0;
+	for (InputKind kind : options.inputs)
+	{
+		if (kind == InputKind::log)
+			continue;
+		for (size_t size : options.sizes)
+		{
+			std::string input = generateInput(kind, size);
+			std::string deflated(tdef_bound(unsigned(input.length())), '\0');
+			unsigned int deflatedLength = unsigned(deflated.length());
+			if (tdef_compress(&deflated[0], &deflatedLength, input.data(), unsigned(input.length()), TDEF_LEVEL_DEFAULT) != TDEF_OK)
+				continue;
+			deflated.resize(deflatedLength);
+
+			std::vector<std::pair<const char *, std::string>> streams;
+			streams.emplace_back(kind == InputKind::binary ? "stored" : "dynamic", std::move(deflated));
+			if (kind == InputKind::binary)
+				streams.emplace_back("fixed", fixedHuffmanDeflate(input));
+
+			for (const auto& stream : streams)
+			{
+				for (unsigned int chunks : chunkCounts)
+				{
+					std::string inflated;
+					BenchMeasure measure = measureFunction([&](size_t& outputLength)
+					{
+						bool ok = parallelInflate(inflated, stream.second.data(), stream.second.length(), input.length(), chunks) == TINF_OK;
+						outputLength = inflated.length();
+						return ok && inflated == input;
+					}, input.length(), options.minSeconds);
+
+					std::string name = std::string("inflate ") + stream.first;
+					if (!measure.ok)
+					{
+						printf("%-28s %-7s %6s inflate failed\n", name.c_str(), inputName(kind), formatSize(size).c_str());
+						++failures;
+						continue;
+					}
+					printf("%-28s %-7s %6s %8zu %7u %11zu %10.1f\n",
+						name.c_str(), inputName(kind), formatSize(size).c_str(), parallelThreadCount(), chunks, stream.second.length(), measure.mbPerSecond);
+					fflush(stdout);
+				}
+			}
+		}
+	}
+	return failures;
+}
+
+// Time of one previewToken() call (the caret preview, on the UI thread, without its cache)
+// on the SAML Encode token of each input, in a table of its own. The "repeated" token is
+// the first kilobyte of the input over and over: it deflates about a thousand times, so
+// that its first TOKEN_DECODE_MAX bytes would inflate to megabytes without the cap of
+// TOKEN_DECODE_OUTPUT_MAX.
+static int benchTokenPreview(const BenchOptions& options)
+{
+	printf("\n%-28s %-7s %6s %11s %8s %10s\n", "token preview", "input", "size", "token bytes", "preview", "us/call");
+
+	int failures = 0;
+	for (InputKind kind : options.inputs)
+	{
+		if (kind == InputKind::log)
+			continue;
+		for (size_t size : options.sizes)
+		{
+			std::string input = generateInput(kind, size);
+			std::string repeated;
+			while (repeated.length() < size)
+				repeated.append(input, 0, std::min(input.length(), size_t(1024)));
+			repeated.resize(size);
+
+			std::pair<const char *, const std::string *> texts[] = { { "preview", &input }, { "preview repeated", &repeated } };
+			for (const auto& text : texts)
+			{
+				std::string token;
+				if (!convertText(CodecId::samlEncode, text.second->data(), text.second->length(), token))
+					continue;
+
+				BenchMeasure measure = measureFunction([&](size_t& outputLength)
+				{
+					outputLength = previewToken(token.data(), token.length()).length();
+					return true;
+				}, token.length(), options.minSeconds);
+
+				if (!measure.ok)
+				{
+					printf("%-28s %-7s %6s preview failed\n", text.first, inputName(kind), formatSize(size).c_str());
+					++failures;
+					continue;
+				}
+				printf("%-28s %-7s %6s %11zu %8zu %10.1f\n",
+					text.first, inputName(kind), formatSize(size).c_str(), token.length(), measure.outputLength, measure.medianSeconds * 1e6);
+				fflush(stdout);
+			}
+		}
+	}
+	return failures;
+}
+
+int main(int argc, char *argv[])
+{
+	BenchOptions options;
+	if (!parseOptions(argc, argv, options))
+	{
+		usage(stderr);
+		return 2;
+	}
+
+	if (!options.codecs.empty() || options.base64Runs || options.base64Search)
+		printf("%-28s %-7s %6s %11s %10s %10s %8s %12s %12s\n",
+			"conversion", "input", "size", "input bytes", "runs", "MB/s", "cyc/B", "allocs/run", "bytes/run");
+
+	int failures = 0;
+	for (CodecId id : options.codecs)
+	{
+		const CodecInfo *info = codecInfo(id);
+		for (InputKind kind : options.inputs)
+		{
+			for (size_t size : options.sizes)
+			{
+				std::string input;
+				if (!makeCodecInput(id, kind, size, input))
+					continue;
+
+				BenchMeasure measure = measureConversion(id, input, options.minSeconds);
+				failures += !printMeasure(info->name, kind, size, input, measure);
+			}
+		}
+	}
+
+	for (InputKind kind : options.inputs)
+	{
+		if (!options.base64Runs || kind != InputKind::log)
+			continue;
+		for (size_t size : options.sizes)
+		{
+			std::string input = generateInput(kind, size);
+			BenchMeasure measure = measureFunction([&](size_t& outputLength)
+			{
+				std::vector<Base64Run> runs = base64DecodeRuns(input.data(), input.length());
+				outputLength = 0;
+				for (const Base64Run& run : runs)
+					outputLength += run.decoded.length();
+				return !runs.empty();
+			}, input.length(), options.minSeconds);
+			failures += !printMeasure(base64RunsMode, kind, size, input, measure);
+		}
+	}
+
+	for (InputKind kind : options.inputs)
+	{
+		if (!options.base64Search || kind != InputKind::ascii)
+			continue;
+		for (size_t size : options.sizes)
+		{
+			std::string text = generateInput(kind, size);
+			std::string input;
+			convertText(CodecId::base64EncodeWrap, text.data(), text.length(), input);
+			BenchMeasure measure = measureFunction([&](size_t& outputLength)
+			{
+				Base64Search search(base64SearchText);
+				outputLength = search.findAll(input.data(), input.length()).size();
+				return true;
+			}, input.length(), options.minSeconds);
+			failures += !printMeasure(base64SearchMode, kind, size, input, measure);
+		}
+	}
+
+	if (options.deflateLevels)
+		failures += benchDeflateLevels(options);
+	if (options.parallelInflate)
+		failures += benchParallelInflate(options);
+	if (options.tokenPreview)
+		failures += benchTokenPreview(options);
+	return failures ? 1 : 0;
+}
@@ -17,12 +17,7 @@
 // Enhance Base64 features, and rewrite Base64 encode/decode implementation
 // Copyright 2019 by Paul Nankervis <paulnank@hotmail.com>
 
-#include "PluginInterface.h"
-#include "mimeTools.h"
 #include "b64.h"
-#include "qp.h"
-#include "url.h"
-#include "saml.h"
 
 // Base64 encoding decoding - where 8 bit ascii is re-represented using just 64 ascii characters (plus optional padding '=').
 //
@@ -83,7 +78,7 @@ int base64Encode(char *resultString, const char *asciiString, size_t asciiString
 		bitField = 0;
 		for (bitOffset = 16; bitOffset >= 0 && index < asciiStringLength; bitOffset -= 8)
 		{
-			charValue = (UCHAR)asciiString[index];
+			charValue = (unsigned char)asciiString[index];
 			if (byLineFlag && (charValue == '\n' || charValue == '\r'))
 			{
 				break;
@@ -157,7 +152,7 @@ int base64Decode(char *resultString, const char *encodedString, size_t encodedSt
 		bitField = 0;
 		for (bitOffset = 18; bitOffset >= 0 && index < encodedStringLength; )
 		{
-			charValue = (UCHAR)encodedString[index++];
+			charValue = (unsigned char)encodedString[index++];
 			charIndex = base64CharMap[charValue & 0x7f];
 			if (charIndex >= 0)
 			{
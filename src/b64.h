@@ -17,7 +17,9 @@
 
 #pragma once
 
-#include <windows.h>
+#include <stddef.h>
 
 int base64Encode(char *resultString, const char *asciiString, size_t asciiStringLength, size_t wrapLength, bool padFlag, bool byLineFlag);
 int base64Decode(char *resultString, const char *encodedString, size_t encodedStringLength, bool strictFlag, bool whitespaceReset);
+
+extern int base64CharMap[];  // base64 value of each 7 bit char, or -1 illegal, -2 ignored, -3 pad
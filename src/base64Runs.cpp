@@ -0,0 +1,220 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "base64Runs.h"
+#include "b64.h"
+#include "parallel.h"
+#include "trace.h"
+
+// Runs are decoded in batches of this many: most runs take less than a microsecond
+constexpr size_t BASE64_RUNS_BATCH = 256;
+
+namespace {
+
+// 1 for the base64 characters, 0 otherwise. base64CharMap only looks at the low
+// 7 bits of a byte: the bytes above 0x7f (UTF-8 text) are not base64 here.
+struct AlphabetTable
+{
+	unsigned char isBase64[256];
+
+	AlphabetTable()
+	{
+		for (int c = 0; c < 256; ++c)
+			isBase64[c] = c < 0x80 && base64CharMap[c] >= 0;
+	}
+};
+
+const AlphabetTable alphabet;
+
+// Index of the lowest set bit of mask, which is not 0
+inline unsigned lowestBit(uint64_t mask)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, uint32_t(mask)))
+		return index;
+	_BitScanForward(&index, uint32_t(mask >> 32));
+	return index + 32;
+#else
+	return unsigned(__builtin_ctzll(mask));
+#endif
+}
+
+// Bit i set when block[i] is a base64 character. The loop has no branch and a constant
+// trip count for whole blocks, so that the compiler unrolls (and vectorizes) it.
+inline uint64_t alphabetMask(const unsigned char *block, size_t count)
+{
+	uint64_t mask = 0;
+	if (count == 64)
+	{
+		for (unsigned i = 0; i < 64; ++i)
+			mask |= uint64_t(alphabet.isBase64[block[i]]) << i;
+	}
+	else
+	{
+		for (unsigned i = 0; i < count; ++i)
+			mask |= uint64_t(alphabet.isBase64[block[i]]) << i;
+	}
+	return mask;
+}
+
+bool isHexOnly(const char *text, size_t length)
+{
+	for (size_t i = 0; i < length; ++i)
+	{
+		char c = text[i];
+		if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')))
+			return false;
+	}
+	return true;
+}
+
+bool isText(const std::string& data)
+{
+	for (char c : data)
+	{
+		unsigned char u = static_cast<unsigned char>(c);
+		if ((u < 0x20 && c != '\t' && c != '\r' && c != '\n') || u == 0x7f)
+			return false;
+	}
+	return true;
+}
+
+// Strict decoding of a run; false if it is not base64 after all
+bool decodeRun(const char *text, Base64Run& run)
+{
+	const char *encoded = text + run.offset;
+	size_t characters = run.length;
+	while (characters > 0 && encoded[characters - 1] == '=')
+		--characters;
+	if (isHexOnly(encoded, characters))
+		return false;
+
+	run.decoded.resize(run.length);
+	int decodedLength = base64Decode(&run.decoded[0], encoded, run.length, true, false);
+	if (decodedLength <= 0)
+	{
+		run.decoded.clear();
+		return false;
+	}
+	run.decoded.resize(decodedLength);
+	run.isText = isText(run.decoded);
+	return true;
+}
+
+}
+
+std::vector<Base64Run> base64FindRuns(const char *text, size_t textLength, size_t minLength)
+{
+	TRACE_SPAN_BYTES("base64 find runs", textLength);
+
+	std::vector<Base64Run> runs;
+	if (minLength == 0)
+		minLength = 1;
+
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *>(text);
+	const char *lineCounted = text;
+	size_t line = 0;
+
+	auto endRun = [&](size_t start, size_t end)
+	{
+		if (end - start < minLength)
+			return;
+
+		size_t padEnd = end;
+		while (padEnd < textLength && padEnd - end < 2 && text[padEnd] == '=')
+			++padEnd;
+
+		// count lines incrementally, so the whole scan stays linear
+		for (const char *nl; (nl = static_cast<const char *>(memchr(lineCounted, '\n', text + start - lineCounted))) != nullptr; lineCounted = nl + 1)
+			++line;
+		lineCounted = text + start;
+
+		Base64Run run;
+		run.offset = start;
+		run.length = padEnd - start;
+		run.line = line;
+		runs.push_back(std::move(run));
+	};
+
+	size_t runStart = 0;
+	bool inRun = false;
+	for (size_t block = 0; block < textLength; block += 64)
+	{
+		size_t count = std::min<size_t>(64, textLength - block);
+		uint64_t mask = alphabetMask(bytes + block, count);
+
+		// jump from transition to transition: a run start is the next set bit,
+		// its end the next clear one
+		for (size_t pos = 0; pos < count; )
+		{
+			uint64_t rest = (inRun ? ~mask : mask) >> pos;
+			if (rest == 0)
+				break;
+			pos += lowestBit(rest);
+			if (pos >= count)
+				break;
+
+			if (inRun)
+				endRun(runStart, block + pos);
+			else
+				runStart = block + pos;
+			inRun = !inRun;
+		}
+	}
+	if (inRun)
+		endRun(runStart, textLength);
+
+	return runs;
+}
+
+std::vector<Base64Run> base64DecodeRuns(const char *text, size_t textLength, size_t minLength)
+{
+	std::vector<Base64Run> runs = base64FindRuns(text, textLength, minLength);
+
+	TRACE_SPAN("base64 decode runs");
+	std::vector<unsigned char> valid(runs.size());
+	parallelForRanges(runs.size(), BASE64_RUNS_BATCH, [&](size_t /*batch*/, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+			valid[i] = decodeRun(text, runs[i]);
+	});
+
+	size_t kept = 0;
+	for (size_t i = 0; i < runs.size(); ++i)
+	{
+		if (!valid[i])
+			continue;
+		if (kept != i)
+			runs[kept] = std::move(runs[i]);
+		++kept;
+	}
+	runs.resize(kept);
+	return runs;
+}
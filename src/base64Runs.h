@@ -0,0 +1,46 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Shorter runs of base64 characters are taken for words, not encoded data
+constexpr size_t BASE64_RUN_LENGTH_MIN = 32;
+
+// A maximal run of base64 characters (the base64CharMap alphabet) found in a text,
+// followed by its padding if any. Whitespace ends a run: a wrapped payload gives one
+// run per line.
+struct Base64Run
+{
+	size_t offset = 0;       // offset of the first base64 character
+	size_t length = 0;       // base64 characters and padding
+	size_t line = 0;         // 0 based line of the run
+	std::string decoded;     // filled by base64DecodeRuns()
+	bool isText = false;     // decoded holds no control character but tab, CR and LF
+};
+
+// Runs of at least minLength base64 characters, in text order.
+// Single pass: the alphabet bytes of each 64 bytes block are gathered in a bit mask,
+// then the run boundaries are the bit transitions of the mask.
+std::vector<Base64Run> base64FindRuns(const char *text, size_t textLength, size_t minLength = BASE64_RUN_LENGTH_MIN);
+
+// Find the runs, then decode them on all the cores. Only the runs that decode in strict
+// mode are kept, except those made of hexadecimal digits only (hashes, identifiers).
+std::vector<Base64Run> base64DecodeRuns(const char *text, size_t textLength, size_t minLength = BASE64_RUN_LENGTH_MIN);
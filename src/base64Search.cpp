@@ -0,0 +1,292 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <string.h>
+#include <algorithm>
+
+#include "base64Search.h"
+#include "b64.h"
+#include "trace.h"
+
+namespace {
+
+constexpr size_t NOT_FOUND = size_t(-1);
+
+// The anchor of a pattern is its rarest symbol in this many bytes of the searched text
+constexpr size_t ANCHOR_SAMPLE_SIZE = 16 << 10;
+
+// base64CharMap of a byte: the bytes above 0x7f are illegal, not their low 7 bits
+inline int charValue(char c)
+{
+	unsigned char u = static_cast<unsigned char>(c);
+	return u < 0x80 ? base64CharMap[u] : -1;
+}
+
+inline bool isSymbol(char c) { return charValue(c) >= 0; }
+inline bool isSkipped(char c) { return charValue(c) == -2; }
+
+// Position just past count symbols from text[at], whitespace skipped; the end of the text
+// or the character that breaks the grid if there are fewer
+size_t skipSymbols(const char *text, size_t length, size_t at, size_t count)
+{
+	size_t p = at;
+	while (p < length && count > 0)
+	{
+		if (isSymbol(text[p]))
+			--count;
+		else if (!isSkipped(text[p]))
+			break;
+		++p;
+	}
+	return p;
+}
+
+}
+
+Base64Search::Base64Search(const std::string& needle) : _needle(needle)
+{
+	if (!isValid())
+		return;
+
+	std::string aligned;
+	std::string encoded;
+	for (unsigned alignment = 0; alignment < 3; ++alignment)
+	{
+		aligned.assign(alignment, '\0');
+		aligned += needle;
+		encoded.resize((aligned.length() + 2) / 3 * 4);
+		encoded.resize(base64Encode(&encoded[0], aligned.data(), aligned.length(), 0, false, false));
+
+		// the symbols holding only needle bits: from bit 8 * alignment to bit 8 * aligned.length()
+		size_t first = (8 * alignment + 5) / 6;
+		size_t last = 8 * aligned.length() / 6;
+
+		Pattern& pattern = _patterns[alignment];
+		pattern.symbols = encoded.substr(first, last - first);
+		pattern.alignment = alignment;
+		pattern.phase = unsigned(first % 4);
+	}
+}
+
+// Base64 of text has very uneven symbol frequencies: memchr looks for the symbol of each
+// pattern that is the least frequent in a sample of the text
+void Base64Search::chooseAnchors(const char *text, size_t length, size_t from)
+{
+	if (_anchorsText == text)
+		return;
+	_anchorsText = text;
+
+	size_t counts[256] = {};
+	size_t sampleStart = std::min(from, length);
+	size_t sampleEnd = std::min(length, sampleStart + ANCHOR_SAMPLE_SIZE);
+	for (size_t i = sampleStart; i < sampleEnd; ++i)
+		++counts[static_cast<unsigned char>(text[i])];
+
+	for (Pattern& pattern : _patterns)
+	{
+		pattern.anchor = 0;
+		for (size_t i = 1; i < pattern.symbols.length(); ++i)
+		{
+			if (counts[static_cast<unsigned char>(pattern.symbols[i])] < counts[static_cast<unsigned char>(pattern.symbols[pattern.anchor])])
+				pattern.anchor = i;
+		}
+	}
+}
+
+// Position of the next anchor symbol of pattern at or after from
+size_t Base64Search::nextCandidate(const Pattern& pattern, const char *text, size_t length, size_t from) const
+{
+	if (from >= length)
+		return NOT_FOUND;
+	const char *hit = static_cast<const char *>(memchr(text + from, pattern.symbols[pattern.anchor], length - from));
+	return hit ? hit - text : NOT_FOUND;
+}
+
+// Is the anchor of the pattern at text[anchorAt] within the whole pattern, skipping whitespace?
+// at receives where the pattern starts.
+bool Base64Search::matchesAt(const Pattern& pattern, const char *text, size_t length, size_t anchorAt, size_t& at) const
+{
+	size_t p = anchorAt;
+	for (size_t i = pattern.anchor; i-- > 0; )
+	{
+		do
+		{
+			if (p == 0)
+				return false;
+			--p;
+		} while (isSkipped(text[p]));
+		if (text[p] != pattern.symbols[i])
+			return false;
+	}
+	at = p;
+
+	p = anchorAt + 1;
+	for (size_t i = pattern.anchor + 1; i < pattern.symbols.length(); ++i)
+	{
+		while (p < length && isSkipped(text[p]))
+			++p;
+		if (p == length || text[p] != pattern.symbols[i])
+			return false;
+		++p;
+	}
+	return true;
+}
+
+// Place of text[at] in its quad: the number of symbols since the grid last restarted, modulo 4.
+// The grid restarts after a character that is neither base64 nor whitespace, and after a
+// blank line: the end of a "Subject: x" header is not part of the base64 body that follows.
+unsigned Base64Search::phaseOf(const char *text, size_t at)
+{
+	unsigned count = 0;
+	bool lineCrossed = false;
+	bool symbolOnLine = false;
+	size_t p = at;
+	while (p > 0)
+	{
+		if (_phaseText == text && p == _phaseOffset)
+		{
+			count += _phase;
+			break;
+		}
+		char c = text[p - 1];
+		if (isSymbol(c))
+		{
+			++count;
+			symbolOnLine = true;
+		}
+		else if (c == '\n')
+		{
+			if (lineCrossed && !symbolOnLine)
+				break;
+			lineCrossed = true;
+			symbolOnLine = false;
+		}
+		else if (!isSkipped(c))
+			break;
+		--p;
+	}
+
+	_phaseText = text;
+	_phaseOffset = at;
+	_phase = count % 4;
+	return _phase;
+}
+
+// Check the candidate at text[at] is on the grid, then decode the quads holding the needle
+bool Base64Search::confirm(const Pattern& pattern, const char *text, size_t length, size_t at, Base64Match& match)
+{
+	if (phaseOf(text, at) != pattern.phase)
+		return false;
+
+	size_t quadStart = at;
+	for (unsigned back = 0; back < pattern.phase; )
+	{
+		--quadStart;
+		if (isSymbol(text[quadStart]))
+			++back;
+	}
+
+	size_t neededLength = pattern.alignment + _needle.length();
+	size_t symbolCount = (neededLength + 2) / 3 * 4;
+	std::vector<size_t> positions;
+	std::string symbols;
+	positions.reserve(symbolCount);
+	symbols.reserve(symbolCount);
+	for (size_t p = quadStart; p < length && symbols.length() < symbolCount; ++p)
+	{
+		if (isSymbol(text[p]))
+		{
+			positions.push_back(p);
+			symbols += text[p];
+		}
+		else if (!isSkipped(text[p]))
+			break;
+	}
+
+	std::string decoded(symbols.length(), '\0');
+	int decodedLength = base64Decode(&decoded[0], symbols.data(), symbols.length(), false, false);
+	if (decodedLength < 0 || size_t(decodedLength) < neededLength
+		|| memcmp(decoded.data() + pattern.alignment, _needle.data(), _needle.length()) != 0)
+		return false;
+
+	match.start = positions[8 * pattern.alignment / 6];
+	match.end = positions[(8 * neededLength - 1) / 6] + 1;
+	return true;
+}
+
+bool Base64Search::findNext(const char *text, size_t length, size_t from, Base64Match& match)
+{
+	if (!isValid())
+		return false;
+
+	if (from >= length)
+		return false;
+
+	TRACE_SPAN_BYTES("base64 search", length - from);
+	chooseAnchors(text, length, from);
+
+	// The three patterns are followed together, anchor after anchor in text order. Since the
+	// anchors are not the same symbol of each pattern, a match found from a later anchor may
+	// start before the one found first: the anchors up to maxAnchor symbols past its start
+	// are still checked.
+	size_t next[3];
+	size_t maxAnchor = 0;
+	for (unsigned k = 0; k < 3; ++k)
+	{
+		next[k] = nextCandidate(_patterns[k], text, length, from);
+		maxAnchor = std::max(maxAnchor, _patterns[k].anchor);
+	}
+
+	bool found = false;
+	size_t horizon = NOT_FOUND;
+	for (;;)
+	{
+		unsigned k = 0;
+		for (unsigned i = 1; i < 3; ++i)
+		{
+			if (next[i] < next[k])
+				k = i;
+		}
+		size_t anchorAt = next[k];
+		if (anchorAt == NOT_FOUND || anchorAt >= horizon)
+			return found;
+
+		const Pattern& pattern = _patterns[k];
+		size_t at;
+		Base64Match candidate;
+		if (matchesAt(pattern, text, length, anchorAt, at) && at >= from && confirm(pattern, text, length, at, candidate)
+			&& candidate.start >= from && (!found || candidate.start < match.start))
+		{
+			match = candidate;
+			if (!found)
+			{
+				found = true;
+				horizon = skipSymbols(text, length, at, maxAnchor + 1);
+			}
+		}
+		next[k] = nextCandidate(pattern, text, length, anchorAt + 1);
+	}
+}
+
+std::vector<Base64Match> Base64Search::findAll(const char *text, size_t length)
+{
+	std::vector<Base64Match> matches;
+	Base64Match match;
+	for (size_t from = 0; findNext(text, length, from, match); from = match.start + 1)
+		matches.push_back(match);
+	return matches;
+}
@@ -0,0 +1,80 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// A single byte has no base64 character of its own at every alignment
+constexpr size_t BASE64_SEARCH_LENGTH_MIN = 2;
+
+// Where the searched text was found in the base64 text
+struct Base64Match
+{
+	size_t start = 0;    // offset of the first base64 character holding bits of the text
+	size_t end = 0;      // just past the last one
+};
+
+// Search a plain text inside base64 encoded text, without decoding it.
+//
+// In the decoded data, the text can start on any of the 3 bytes of a quad. Encoded at
+// each of these alignments, it gives 3 patterns of base64 characters, from which the first
+// and last characters are left out when they also hold bits of the unknown neighbouring
+// bytes. The patterns are searched in the encoded text directly, with memchr on their
+// rarest character in a sample of the text, whitespace being skipped as base64Decode does.
+// Any other character, padding included, restarts the quad grid, and so does a blank line.
+// A candidate is then confirmed by its place on the grid and by decoding the few quads that
+// hold the text.
+//
+// The text searched must not change between calls on the same object.
+class Base64Search {
+public:
+	explicit Base64Search(const std::string& needle);
+
+	bool isValid() const { return _needle.length() >= BASE64_SEARCH_LENGTH_MIN; };
+
+	// First occurrence whose match.start is at or after from
+	bool findNext(const char *text, size_t length, size_t from, Base64Match& match);
+
+	std::vector<Base64Match> findAll(const char *text, size_t length);
+
+private:
+	struct Pattern
+	{
+		std::string symbols;
+		unsigned alignment = 0;  // byte of the quad the needle starts on
+		unsigned phase = 0;      // place of symbols[0] in its quad
+		size_t anchor = 0;       // index of the symbol memchr looks for
+	};
+
+	void chooseAnchors(const char *text, size_t length, size_t from);
+	size_t nextCandidate(const Pattern& pattern, const char *text, size_t length, size_t from) const;
+	bool matchesAt(const Pattern& pattern, const char *text, size_t length, size_t anchorAt, size_t& at) const;
+	unsigned phaseOf(const char *text, size_t at);
+	bool confirm(const Pattern& pattern, const char *text, size_t length, size_t at, Base64Match& match);
+
+	std::string _needle;
+	Pattern _patterns[3];
+	const char *_anchorsText = nullptr;
+
+	// quad grid phase of a position already walked back from
+	const char *_phaseText = nullptr;
+	size_t _phaseOffset = 0;
+	unsigned _phase = 0;
+};
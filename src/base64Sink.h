@@ -0,0 +1,156 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+
+#include "b64.h"
+#include "bufferPool.h"
+#include "parallel.h"
+#include "sink.h"
+
+// From this size on, the encoding into a string is spread over the cores,
+// in pieces of BASE64_PARALLEL_PIECE bytes
+constexpr size_t BASE64_PARALLEL_MIN = 1 << 20;
+constexpr size_t BASE64_PARALLEL_PIECE = 256 << 10;
+
+// Length of the longest prefix of text made of whole quads: it ends after a fourth base64
+// character, or after a character that makes base64Decode() start a new quad (illegal
+// character, whitespace when it resets). Decoding the prefix and the rest separately gives
+// the output of decoding the whole text.
+inline size_t base64QuadBoundary(const char *text, size_t length, bool whitespaceReset)
+{
+	size_t cut = 0;
+	int nbSymbols = 0;
+	for (size_t i = 0; i < length; ++i)
+	{
+		int charIndex = base64CharMap[(unsigned char)text[i] & 0x7f];
+		if (charIndex >= 0)
+			nbSymbols = (nbSymbols + 1) & 3;
+		else if (charIndex == -1 || (charIndex == -2 && whitespaceReset))
+			nbSymbols = 0;
+
+		if (nbSymbols == 0)
+			cut = i + 1;
+	}
+	return cut;
+}
+
+// base64Encode() of text into sink, in blocks whose output fits in Sink::RESERVE_MAX: a block
+// is whole groups of 3 bytes, whole lines of output when wrapping, which are then separated
+// by a line break. continued is set
+// when sink already received a part of the same encoded text.
+// Not by line: the output of an input line is not bounded.
+template <typename Sink>
+void base64EncodeTo(Sink& sink, const char *text, size_t length, size_t wrapLength, bool padFlag, bool continued = false)
+{
+	// the output of n bytes, line breaks included, is less than 3 * n
+	size_t unit = wrapLength ? 3 * wrapLength : 3;
+	size_t blockLength = Sink::RESERVE_MAX / 3 / unit * unit;
+	for (size_t pos = 0; pos < length; pos += blockLength)
+	{
+		size_t n = length - pos < blockLength ? length - pos : blockLength;
+		if (wrapLength && (continued || pos > 0))
+		{
+			*sink.reserve(1) = '\n';
+			sink.commit(1);
+		}
+		bool last = pos + n == length;
+		size_t encodedLength = (n + 2) / 3 * 4;
+		char *out = sink.reserve(encodedLength + (wrapLength ? encodedLength / wrapLength : 0));
+		sink.commit(base64Encode(out, text + pos, n, wrapLength, last && padFlag, false));
+	}
+}
+
+// Into a string, a large text is encoded piece by piece on all the cores, straight into the
+// string sized once: the pieces are whole lines, so that each lands at an offset known from
+// its index, after the line break that separates it from the previous one.
+inline void base64EncodeTo(StringSink& sink, const char *text, size_t length, size_t wrapLength, bool padFlag, bool continued = false)
+{
+	if (length < BASE64_PARALLEL_MIN)
+	{
+		base64EncodeTo<StringSink>(sink, text, length, wrapLength, padFlag, continued);
+		return;
+	}
+
+	std::string& out = sink.string();
+	size_t unit = wrapLength ? 3 * wrapLength : 3;
+	size_t pieceLength = BASE64_PARALLEL_PIECE / unit * unit;
+	size_t pieceEncoded = pieceLength / 3 * 4;
+	size_t stride = pieceEncoded + (wrapLength ? pieceEncoded / wrapLength : 0);
+	size_t nbPieces = (length + pieceLength - 1) / pieceLength;
+
+	size_t lastLength = length - (nbPieces - 1) * pieceLength;
+	size_t lastEncoded = (lastLength + 2) / 3 * 4;
+	size_t start = out.length() + (wrapLength && continued ? 1 : 0);
+	out.resize(start + (nbPieces - 1) * stride + lastEncoded + (wrapLength ? lastEncoded / wrapLength : 0));
+
+	size_t lastWritten = 0;
+	parallelForRanges(length, pieceLength, [&](size_t piece, size_t begin, size_t end)
+	{
+		char *dest = &out[start + piece * stride];
+		if (wrapLength && (continued || piece > 0))
+			dest[-1] = '\n';
+		int written = base64Encode(dest, text + begin, end - begin, wrapLength, end == length && padFlag, false);
+		if (end == length)
+			lastWritten = written;
+	});
+	out.resize(start + (nbPieces - 1) * stride + lastWritten);
+}
+
+// base64Decode() of text into sink, in blocks of at most Sink::RESERVE_MAX bytes, each block
+// ending on a quad boundary; false on a strict decoding error
+template <typename Sink>
+bool base64DecodeTo(Sink& sink, const char *text, size_t length, bool strictFlag, bool whitespaceReset)
+{
+	size_t pos = 0;
+	while (pos < length)
+	{
+		// the output of a block is not longer than the block
+		size_t n = length - pos;
+		if (n > Sink::RESERVE_MAX)
+		{
+			n = base64QuadBoundary(text + pos, Sink::RESERVE_MAX, whitespaceReset);
+
+			// no boundary in the block: it ends at the next one, decoded aside
+			if (n == 0)
+			{
+				n = base64QuadBoundary(text + pos, length - pos, whitespaceReset);
+				if (n == 0)
+					n = length - pos;
+				PooledString block(n);
+				block->resize(n);
+				int len = base64Decode(&(*block)[0], text + pos, n, strictFlag, whitespaceReset);
+				if (len < 0)
+					return false;
+				sink.append(block->data(), len);
+				pos += n;
+				continue;
+			}
+		}
+		int len = base64Decode(sink.reserve(n), text + pos, n, strictFlag, whitespaceReset);
+		if (len < 0)
+		{
+			sink.commit(0);
+			return false;
+		}
+		sink.commit(len);
+		pos += n;
+	}
+	return true;
+}
@@ -0,0 +1,192 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include "bufferPool.h"
+
+namespace {
+
+constexpr unsigned CLASS_COUNT = 15;    // BUFFER_POOL_CLASS_MIN << 14 == BUFFER_POOL_CLASS_MAX
+static_assert((BUFFER_POOL_CLASS_MIN << (CLASS_COUNT - 1)) == BUFFER_POOL_CLASS_MAX, "size classes");
+
+std::atomic<uint64_t> g_acquired(0);
+std::atomic<uint64_t> g_allocated(0);
+std::atomic<uint64_t> g_allocatedBytes(0);
+std::atomic<uint64_t> g_keptBytes(0);
+
+uint64_t nowNs()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Smallest class whose buffers hold size bytes
+unsigned classFor(size_t size)
+{
+	unsigned index = 0;
+	while ((BUFFER_POOL_CLASS_MIN << index) < size)
+		++index;
+	return index;
+}
+
+// Largest class whose size fits in capacity, which is within the classes
+unsigned classOf(size_t capacity)
+{
+	unsigned index = 0;
+	while (index + 1 < CLASS_COUNT && (BUFFER_POOL_CLASS_MIN << (index + 1)) <= capacity)
+		++index;
+	return index;
+}
+
+// The free buffers of one thread. A class holds the buffers of at least its size, most
+// recently released last: buffers are taken from the end and trimmed from the start.
+class BufferPool {
+public:
+	~BufferPool()
+	{
+		trim(0);
+		t_destroyed = true;
+	};
+
+	std::string acquire(size_t capacity)
+	{
+		g_acquired.fetch_add(1, std::memory_order_relaxed);
+		std::string buffer;
+		if (capacity <= BUFFER_POOL_CLASS_MAX)
+		{
+			// a buffer of the next class is better than a new one
+			unsigned index = classFor(capacity);
+			for (unsigned i = index; i < CLASS_COUNT && i <= index + 1; ++i)
+			{
+				if (!_free[i].empty())
+				{
+					buffer.swap(_free[i].back().buffer);
+					_free[i].pop_back();
+					_keptBytes -= buffer.capacity();
+					g_keptBytes.fetch_sub(buffer.capacity(), std::memory_order_relaxed);
+					return buffer;
+				}
+			}
+			capacity = BUFFER_POOL_CLASS_MIN << index;
+		}
+
+		buffer.reserve(capacity);
+		g_allocated.fetch_add(1, std::memory_order_relaxed);
+		g_allocatedBytes.fetch_add(buffer.capacity(), std::memory_order_relaxed);
+		return buffer;
+	};
+
+	void release(std::string& buffer)
+	{
+		size_t capacity = buffer.capacity();
+		if (capacity < BUFFER_POOL_CLASS_MIN || capacity > 2 * BUFFER_POOL_CLASS_MAX)
+			return;
+
+		uint64_t now = nowNs();
+		if (now - _lastTrimNs >= BUFFER_POOL_IDLE_NS)
+		{
+			trim(BUFFER_POOL_IDLE_NS);
+			_lastTrimNs = now;
+		}
+
+		std::vector<FreeBuffer>& free = _free[classOf(capacity)];
+		if (free.size() >= BUFFER_POOL_CLASS_KEPT || _keptBytes + capacity > BUFFER_POOL_KEPT_MAX)
+			return;
+
+		buffer.clear();
+		free.emplace_back();
+		free.back().buffer.swap(buffer);
+		free.back().releasedNs = now;
+		_keptBytes += capacity;
+		g_keptBytes.fetch_add(capacity, std::memory_order_relaxed);
+	};
+
+	void trim(uint64_t idleNs)
+	{
+		uint64_t now = nowNs();
+		for (std::vector<FreeBuffer>& free : _free)
+		{
+			size_t idle = 0;
+			while (idle < free.size() && now - free[idle].releasedNs >= idleNs)
+			{
+				_keptBytes -= free[idle].buffer.capacity();
+				g_keptBytes.fetch_sub(free[idle].buffer.capacity(), std::memory_order_relaxed);
+				++idle;
+			}
+			free.erase(free.begin(), free.begin() + idle);
+		}
+	};
+
+	// Set once the pool of the thread is destroyed: the strings destroyed after it
+	// (static objects at exit) free their buffer
+	static thread_local bool t_destroyed;
+
+private:
+	struct FreeBuffer
+	{
+		std::string buffer;
+		uint64_t releasedNs = 0;
+	};
+
+	std::vector<FreeBuffer> _free[CLASS_COUNT];
+	size_t _keptBytes = 0;
+	uint64_t _lastTrimNs = 0;
+};
+
+thread_local bool BufferPool::t_destroyed = false;
+thread_local BufferPool t_pool;
+
+}
+
+BufferPoolCounters bufferPoolCounters()
+{
+	BufferPoolCounters counters;
+	counters.acquired = g_acquired.load(std::memory_order_relaxed);
+	counters.allocated = g_allocated.load(std::memory_order_relaxed);
+	counters.allocatedBytes = g_allocatedBytes.load(std::memory_order_relaxed);
+	counters.keptBytes = g_keptBytes.load(std::memory_order_relaxed);
+	return counters;
+}
+
+void trimBufferPool(uint64_t idleNs)
+{
+	if (!BufferPool::t_destroyed)
+		t_pool.trim(idleNs);
+}
+
+PooledString::~PooledString()
+{
+	if (!BufferPool::t_destroyed)
+		t_pool.release(_string);
+}
+
+void PooledString::reserve(size_t capacity)
+{
+	if (capacity <= _string.capacity() || BufferPool::t_destroyed)
+	{
+		_string.reserve(capacity);
+		return;
+	}
+
+	std::string buffer = t_pool.acquire(capacity);
+	buffer.append(_string);
+	_string.swap(buffer);
+	t_pool.release(buffer);
+}
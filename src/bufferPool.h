@@ -0,0 +1,74 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Pooled buffers are sized by powers of two from BUFFER_POOL_CLASS_MIN to
+// BUFFER_POOL_CLASS_MAX; smaller and larger ones are left to the allocator
+constexpr size_t BUFFER_POOL_CLASS_MIN = 4 << 10;
+constexpr size_t BUFFER_POOL_CLASS_MAX = 64 << 20;
+
+// A thread keeps at most this many free buffers of each size, and this many bytes in all
+constexpr size_t BUFFER_POOL_CLASS_KEPT = 8;
+constexpr size_t BUFFER_POOL_KEPT_MAX = 128 << 20;
+
+// Free buffers unused for this long are given back to the system
+constexpr uint64_t BUFFER_POOL_IDLE_NS = 10000000000ULL;
+
+// Totals over all the threads since the program started
+struct BufferPoolCounters
+{
+	uint64_t acquired = 0;        // buffers asked for
+	uint64_t allocated = 0;       // of which the pool had to allocate
+	uint64_t allocatedBytes = 0;
+	uint64_t keptBytes = 0;       // free buffers held by the pools now
+};
+
+BufferPoolCounters bufferPoolCounters();
+
+// Free the buffers of the calling thread's pool unused for idleNs or more
+void trimBufferPool(uint64_t idleNs = BUFFER_POOL_IDLE_NS);
+
+// A std::string whose buffer comes from the pool of the calling thread, and goes back to the
+// pool of the thread that destroys it, keeping its capacity. The conversion commands take
+// their input copies, intermediate and output buffers from the pool, so that running the
+// same command again and again (macros, column edits) allocates nothing.
+class PooledString {
+public:
+	explicit PooledString(size_t capacity = 0) { reserve(capacity); };
+	~PooledString();
+
+	PooledString(PooledString&&) = default;
+	PooledString& operator=(PooledString&&) = default;
+	PooledString(const PooledString&) = delete;
+	PooledString& operator=(const PooledString&) = delete;
+
+	// Make room for capacity bytes, with a pooled buffer if needed; the content is kept
+	void reserve(size_t capacity);
+
+	std::string& operator*() { return _string; };
+	const std::string& operator*() const { return _string; };
+	std::string *operator->() { return &_string; };
+	const std::string *operator->() const { return &_string; };
+
+private:
+	std::string _string;
+};
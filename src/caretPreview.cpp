@@ -0,0 +1,83 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <string>
+
+#include "caretPreview.h"
+#include "tokenPreview.h"
+#include "Scintilla.h"
+#include "trace.h"
+
+// Shared by both views, as the decoded lines of viewportDecode.cpp
+static TokenPreviewCache g_tokenPreviewCache;
+
+// Where the calltip shown was put and what it says: moving the caret inside the same
+// token does not show it again
+static HWND g_previewScintilla = nullptr;
+static size_t g_previewPosition = 0;
+static std::string g_preview;
+
+static void cancelPreview(HWND hScintilla)
+{
+	if (hScintilla == g_previewScintilla)
+	{
+		::SendMessage(hScintilla, SCI_CALLTIPCANCEL, 0, 0);
+		g_previewScintilla = nullptr;
+		g_preview.clear();
+	}
+}
+
+void previewTokenAtCaret(HWND hScintilla)
+{
+	TRACE_SPAN("preview token at caret");
+
+	size_t caret = ::SendMessage(hScintilla, SCI_GETCURRENTPOS, 0, 0);
+	size_t length = ::SendMessage(hScintilla, SCI_GETLENGTH, 0, 0);
+	size_t start = caret > TOKEN_SCAN_MAX ? caret - TOKEN_SCAN_MAX : 0;
+	size_t end = caret + TOKEN_SCAN_MAX + 2 < length ? caret + TOKEN_SCAN_MAX + 2 : length;
+	const char *text = (const char *)::SendMessage(hScintilla, SCI_GETRANGEPOINTER, start, end - start);
+
+	TokenSpan span;
+	const std::string *preview = nullptr;
+	if (text && findTokenAround(text, end - start, caret - start, span))
+	{
+		preview = &g_tokenPreviewCache.preview(text + span.start, span.end - span.start);
+		if (preview->empty())
+			preview = nullptr;
+	}
+
+	if (!preview)
+	{
+		cancelPreview(hScintilla);
+		return;
+	}
+
+	size_t position = start + span.start;
+	if (hScintilla == g_previewScintilla && position == g_previewPosition && *preview == g_preview
+		&& ::SendMessage(hScintilla, SCI_CALLTIPACTIVE, 0, 0))
+		return;
+	::SendMessage(hScintilla, SCI_CALLTIPSHOW, position, (LPARAM)preview->c_str());
+	g_previewScintilla = hScintilla;
+	g_previewPosition = position;
+	g_preview = *preview;
+}
+
+void clearTokenPreview(HWND hScintilla)
+{
+	cancelPreview(hScintilla);
+	g_tokenPreviewCache.clear();
+}
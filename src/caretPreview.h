@@ -0,0 +1,29 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <windows.h>
+
+// Show what the encoded token at the caret of hScintilla decodes to, in a calltip below it
+// (see tokenPreview.h); cancel the calltip when the caret is on no such token. Called
+// whenever the selection changes: the buffer is never modified, and the tokens already
+// seen come from a cache.
+void previewTokenAtCaret(HWND hScintilla);
+
+// Remove the calltip of hScintilla and forget the decoded tokens
+void clearTokenPreview(HWND hScintilla);
@@ -0,0 +1,498 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <string.h>
+
+#include "codec.h"
+#include "b64.h"
+#include "bufferPool.h"
+#include "pipeline.h"
+#include "qp.h"
+#include "url.h"
+#include "saml.h"
+#include "smartDecode.h"
+#include "xmlFormat.h"
+#include "trace.h"
+
+static const CodecInfo codecInfos[] = {
+	{ CodecId::base64Encode,            "base64-encode",              "Base64" },
+	{ CodecId::base64EncodePad,         "base64-encode-pad",          "Base64" },
+	{ CodecId::base64EncodeWrap,        "base64-encode-wrap",         "Base64" },
+	{ CodecId::base64EncodeByLine,      "base64-encode-by-line",      "Base64" },
+	{ CodecId::base64Decode,            "base64-decode",              "Base64" },
+	{ CodecId::base64DecodeStrict,      "base64-decode-strict",       "Base64" },
+	{ CodecId::base64DecodeByLine,      "base64-decode-by-line",      "Base64" },
+	{ CodecId::qpEncode,                "qp-encode",                  "Quoted-printable encoding" },
+	{ CodecId::qpDecode,                "qp-decode",                  "Quoted-printable decode error" },
+	{ CodecId::urlEncodeRFC1738,        "url-encode-rfc1738",         "URL Encode" },
+	{ CodecId::urlEncodeRFC1738ByLine,  "url-encode-rfc1738-by-line", "URL Encode" },
+	{ CodecId::urlEncodeExtended,       "url-encode-extended",        "URL Encode" },
+	{ CodecId::urlEncodeExtendedByLine, "url-encode-extended-by-line", "URL Encode" },
+	{ CodecId::urlEncodeFull,           "url-encode-full",            "URL Encode" },
+	{ CodecId::urlEncodeFullByLine,     "url-encode-full-by-line",    "URL Encode" },
+	{ CodecId::urlDecode,               "url-decode",                 "URL Decode" },
+	{ CodecId::samlDecode,              "saml-decode",                "SAML Decode" },
+	{ CodecId::samlEncode,              "saml-encode",                "SAML Encode" },
+	{ CodecId::smartDecode,             "smart-decode",               "Smart Decode" },
+	{ CodecId::pipeline,                "pipeline",                   "Pipeline" }
+};
+
+const CodecInfo *codecInfo(CodecId id)
+{
+	return &codecInfos[static_cast<int>(id)];
+}
+
+size_t codecCount()
+{
+	return sizeof(codecInfos) / sizeof(codecInfos[0]);
+}
+
+const CodecInfo *findCodec(const char *name)
+{
+	for (const CodecInfo& info : codecInfos)
+	{
+		if (strcmp(info.name, name) == 0)
+			return &info;
+	}
+	return nullptr;
+}
+
+namespace {
+
+// Converts with the one-shot function the longest prefix whose conversion does not
+// depend on what follows, and keeps the rest for the next call.
+class SplitCodec : public Codec {
+public:
+	bool process(const char *text, size_t length, std::string& out) override
+	{
+		if (_stopped)
+			return true;
+
+		// the one-shot conversions of null terminated strings end at the first null
+		if (_stopAtNul)
+		{
+			const char *nul = static_cast<const char *>(memchr(text, '\0', length));
+			if (nul)
+			{
+				length = nul - text;
+				_stopped = true;
+			}
+		}
+
+		const char *data = text;
+		size_t dataLength = length;
+		if (!_pending.empty())
+		{
+			_pending.append(text, length);
+			data = _pending.data();
+			dataLength = _pending.length();
+		}
+
+		size_t cut = splitPoint(data, dataLength);
+		if (cut > 0 && !convert(data, cut, false, out))
+			return false;
+
+		if (data == _pending.data())
+			_pending.erase(0, cut);
+		else
+			_pending.assign(text + cut, length - cut);
+		return true;
+	};
+
+	bool finish(std::string& out) override
+	{
+		bool ok = convert(_pending.data(), _pending.length(), true, out);
+		_pending.clear();
+		_stopped = false;
+		return ok;
+	};
+
+protected:
+	explicit SplitCodec(bool stopAtNul) : _stopAtNul(stopAtNul) {};
+
+	// Length of the prefix of text that can be converted on its own
+	virtual size_t splitPoint(const char *text, size_t length) = 0;
+
+	// One-shot conversion of a piece, last is set for the end of the text
+	virtual bool convert(const char *text, size_t length, bool last, std::string& out) = 0;
+
+private:
+	std::string _pending;
+	bool _stopAtNul;
+	bool _stopped = false;
+};
+
+// Returns the length up to the last '\n' or '\r' included, 0 if there is none
+size_t lengthToLastEol(const char *text, size_t length)
+{
+	for (size_t i = length; i > 0; --i)
+	{
+		if (text[i - 1] == '\n' || text[i - 1] == '\r')
+			return i;
+	}
+	return 0;
+}
+
+// Pieces are whole groups of 3 bytes: whole lines of output when wrapping (then
+// separated by a line break), whole lines of input when encoding by line
+class Base64EncodeCodec : public SplitCodec {
+public:
+	Base64EncodeCodec(size_t wrapLength, bool padFlag, bool byLineFlag) : SplitCodec(false), _wrapLength(wrapLength), _padFlag(padFlag), _byLineFlag(byLineFlag) {};
+
+protected:
+	size_t splitPoint(const char *text, size_t length) override
+	{
+		if (_byLineFlag)
+			return lengthToLastEol(text, length);
+
+		size_t unit = _wrapLength ? 3 * _wrapLength : 3;
+		return length - length % unit;
+	};
+
+	bool convert(const char *text, size_t length, bool last, std::string& out) override
+	{
+		if (length == 0)
+			return true;
+
+		if (_byLineFlag)
+		{
+			size_t outLength = out.length();
+			out.resize(outLength + 2 * length + 4);
+			int len = base64Encode(&out[outLength], text, length, 0, false, true);
+			out.resize(outLength + len);
+			return true;
+		}
+
+		StringSink sink(out);
+		base64EncodeTo(sink, text, length, _wrapLength, last && _padFlag, _written);
+		_written = true;
+		return true;
+	};
+
+private:
+	size_t _wrapLength;
+	bool _padFlag;
+	bool _byLineFlag;
+	bool _written = false;
+};
+
+// Pieces end on a quad boundary: after a fourth base64 character, or after a character
+// that makes the decoder start a new quad (illegal character, whitespace when it resets)
+class Base64DecodeCodec : public SplitCodec {
+public:
+	Base64DecodeCodec(bool strictFlag, bool whitespaceReset) : SplitCodec(false), _strictFlag(strictFlag), _whitespaceReset(whitespaceReset) {};
+
+protected:
+	size_t splitPoint(const char *text, size_t length) override
+	{
+		return base64QuadBoundary(text, length, _whitespaceReset);
+	};
+
+	bool convert(const char *text, size_t length, bool /*last*/, std::string& out) override
+	{
+		size_t outLength = out.length();
+		StringSink sink(out);
+		if (!base64DecodeTo(sink, text, length, _strictFlag, _whitespaceReset))
+		{
+			out.resize(outLength);
+			_errorMessage = "Problem!";
+			return false;
+		}
+		return true;
+	};
+
+private:
+	bool _strictFlag;
+	bool _whitespaceReset;
+};
+
+// A line feed resets the length of the encoded line: pieces end just before one
+class QpEncodeCodec : public SplitCodec {
+public:
+	QpEncodeCodec() : SplitCodec(true) {};
+
+protected:
+	size_t splitPoint(const char *text, size_t length) override
+	{
+		for (size_t i = length; i > 0; --i)
+		{
+			if (text[i - 1] == '\n')
+				return i - 1;
+		}
+		return 0;
+	};
+
+	bool convert(const char *text, size_t length, bool /*last*/, std::string& out) override
+	{
+		PooledString piece(length + 1);
+		piece->assign(text, length);
+		QuotedPrintable qp;
+		const char *encoded = qp.encode(piece->c_str());
+		if (!encoded)
+		{
+			_errorMessage = "Problem!";
+			return false;
+		}
+		out += encoded;
+		return true;
+	};
+};
+
+// Quoted-printable is decoded line by line
+class QpDecodeCodec : public SplitCodec {
+public:
+	QpDecodeCodec() : SplitCodec(true) {};
+
+protected:
+	size_t splitPoint(const char *text, size_t length) override
+	{
+		for (size_t i = length; i > 0; --i)
+		{
+			if (text[i - 1] == '\n')
+				return i;
+		}
+		return 0;
+	};
+
+	bool convert(const char *text, size_t length, bool /*last*/, std::string& out) override
+	{
+		if (length == 0)
+			return true;
+
+		PooledString piece(length + 1);
+		piece->assign(text, length);
+		QuotedPrintable qp;
+		const char *decoded = qp.decode(piece->c_str());
+		if (!decoded)
+		{
+			_errorMessage = "It's not a valid Quoted-printable text";
+			return false;
+		}
+		out += decoded;
+		return true;
+	};
+};
+
+// Every character is encoded on its own
+class UrlEncodeCodec : public SplitCodec {
+public:
+	UrlEncodeCodec(UrlEncodeMethod method, bool isByLine) : SplitCodec(true), _method(method), _isByLine(isByLine) {};
+
+protected:
+	size_t splitPoint(const char * /*text*/, size_t length) override
+	{
+		return length;
+	};
+
+	bool convert(const char *text, size_t length, bool /*last*/, std::string& out) override
+	{
+		if (length == 0)
+			return true;
+
+		PooledString piece(length + 1);
+		piece->assign(text, length);
+		size_t outLength = out.length();
+		size_t destSize = length * 3 + 1;
+		out.resize(outLength + destSize);
+		int len = AsciiToUrl(&out[outLength], piece->c_str(), int(destSize), _method, _isByLine);
+		out.resize(outLength + len);
+		return true;
+	};
+
+private:
+	UrlEncodeMethod _method;
+	bool _isByLine;
+};
+
+// Pieces never end inside a %XX triplet
+class UrlDecodeCodec : public SplitCodec {
+public:
+	UrlDecodeCodec() : SplitCodec(true) {};
+
+protected:
+	size_t splitPoint(const char *text, size_t length) override
+	{
+		if (length >= 1 && text[length - 1] == '%')
+			return length - 1;
+		if (length >= 2 && text[length - 2] == '%')
+			return length - 2;
+		return length;
+	};
+
+	bool convert(const char *text, size_t length, bool /*last*/, std::string& out) override
+	{
+		if (length == 0)
+			return true;
+
+		PooledString piece(length + 1);
+		piece->assign(text, length);
+		size_t outLength = out.length();
+		size_t destSize = length + 1;
+		out.resize(outLength + destSize);
+		int len = UrlToAscii(&out[outLength], piece->c_str(), int(destSize));
+		if (len < 0)
+		{
+			out.resize(outLength);
+			_errorMessage = "Encoding Invalid!";
+			return false;
+		}
+		out.resize(outLength + len);
+		return true;
+	};
+};
+
+// A SAML message is inflated or deflated as a whole: everything is kept until the end
+class SamlDecodeCodec : public SplitCodec {
+public:
+	explicit SamlDecodeCodec(const CodecOptions& options) : SplitCodec(true), _options(options) {};
+
+protected:
+	size_t splitPoint(const char * /*text*/, size_t /*length*/) override
+	{
+		return 0;
+	};
+
+	bool convert(const char *text, size_t length, bool /*last*/, std::string& out) override
+	{
+		// room for the first inflate attempt of samlDecode()
+		PooledString xml(length * 6 + 4096);
+		int result = samlDecode(*xml, text, length);
+		if (result <= 0)
+		{
+			_errorMessage = samlDecodeErrorMessage(result);
+			return false;
+		}
+		if (_options.formatXml)
+			out += XmlFormatter::formatString(xml->c_str(), xml->length(), _options.eol);
+		else
+			out += *xml;
+		return true;
+	};
+
+private:
+	CodecOptions _options;
+};
+
+class SamlEncodeCodec : public SplitCodec {
+public:
+	SamlEncodeCodec() : SplitCodec(true) {};
+
+protected:
+	size_t splitPoint(const char * /*text*/, size_t /*length*/) override
+	{
+		return 0;
+	};
+
+	bool convert(const char *text, size_t length, bool /*last*/, std::string& out) override
+	{
+		if (length > SAML_ENCODE_LENGTH_MAX)
+		{
+			_errorMessage = "The text is too large to SAML encode.";
+			return false;
+		}
+
+		size_t outLength = out.length();
+		out.resize(outLength + samlEncodeBufferLength(length));
+		int len = samlEncode(&out[outLength], text, length);
+		if (len < 0)
+		{
+			out.resize(outLength);
+			_errorMessage = "Could not deflate text.";
+			return false;
+		}
+		out.resize(outLength + len);
+		return true;
+	};
+};
+
+// The encoding is guessed from the whole text
+class SmartDecodeCodec : public SplitCodec {
+public:
+	explicit SmartDecodeCodec(const CodecOptions& options) : SplitCodec(false), _options(options) {};
+
+protected:
+	size_t splitPoint(const char * /*text*/, size_t /*length*/) override
+	{
+		return 0;
+	};
+
+	bool convert(const char *text, size_t length, bool /*last*/, std::string& out) override
+	{
+		if (length == 0)
+			return true;
+		return smartDecode(text, length, out, _options, nullptr, &_errorMessage);
+	};
+
+private:
+	CodecOptions _options;
+};
+
+} // namespace
+
+std::unique_ptr<Codec> createCodec(CodecId id, const CodecOptions& options)
+{
+	switch (id)
+	{
+		case CodecId::base64Encode:
+			return std::unique_ptr<Codec>(new Base64EncodeCodec(0, false, false));
+		case CodecId::base64EncodePad:
+			return std::unique_ptr<Codec>(new Base64EncodeCodec(0, true, false));
+		case CodecId::base64EncodeWrap:
+			return std::unique_ptr<Codec>(new Base64EncodeCodec(64, true, false));
+		case CodecId::base64EncodeByLine:
+			return std::unique_ptr<Codec>(new Base64EncodeCodec(0, false, true));
+		case CodecId::base64Decode:
+			return std::unique_ptr<Codec>(new Base64DecodeCodec(false, false));
+		case CodecId::base64DecodeStrict:
+			return std::unique_ptr<Codec>(new Base64DecodeCodec(true, false));
+		case CodecId::base64DecodeByLine:
+			return std::unique_ptr<Codec>(new Base64DecodeCodec(false, true));
+		case CodecId::qpEncode:
+			return std::unique_ptr<Codec>(new QpEncodeCodec());
+		case CodecId::qpDecode:
+			return std::unique_ptr<Codec>(new QpDecodeCodec());
+		case CodecId::urlEncodeRFC1738:
+			return std::unique_ptr<Codec>(new UrlEncodeCodec(UrlEncodeMethod::RFC1738, false));
+		case CodecId::urlEncodeRFC1738ByLine:
+			return std::unique_ptr<Codec>(new UrlEncodeCodec(UrlEncodeMethod::RFC1738, true));
+		case CodecId::urlEncodeExtended:
+			return std::unique_ptr<Codec>(new UrlEncodeCodec(UrlEncodeMethod::extended, false));
+		case CodecId::urlEncodeExtendedByLine:
+			return std::unique_ptr<Codec>(new UrlEncodeCodec(UrlEncodeMethod::extended, true));
+		case CodecId::urlEncodeFull:
+			return std::unique_ptr<Codec>(new UrlEncodeCodec(UrlEncodeMethod::full, false));
+		case CodecId::urlEncodeFullByLine:
+			return std::unique_ptr<Codec>(new UrlEncodeCodec(UrlEncodeMethod::full, true));
+		case CodecId::urlDecode:
+			return std::unique_ptr<Codec>(new UrlDecodeCodec());
+		case CodecId::samlDecode:
+			return std::unique_ptr<Codec>(new SamlDecodeCodec(options));
+		case CodecId::samlEncode:
+			return std::unique_ptr<Codec>(new SamlEncodeCodec());
+		case CodecId::smartDecode:
+			return std::unique_ptr<Codec>(new SmartDecodeCodec(options));
+		case CodecId::pipeline:
+			return createPipeline(options.pipeline, options);
+	}
+	return nullptr;
+}
+
+bool convertText(CodecId id, const char *text, size_t length, std::string& out, const CodecOptions& options, const char **errorMessage)
+{
+	StringSink sink(out);
+	return convertTo(id, text, length, sink, options, errorMessage);
+}
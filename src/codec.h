@@ -0,0 +1,190 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "base64Sink.h"
+#include "bufferPool.h"
+#include "sink.h"
+#include "trace.h"
+
+// convertTo() hands a text that is not converted straight into the sink to the codec in
+// pieces of this size, which bounds the output held aside
+constexpr size_t CONVERT_PIECE_SIZE = 1 << 20;
+
+// Every text conversion offered by the plugin
+enum class CodecId {
+	base64Encode,
+	base64EncodePad,
+	base64EncodeWrap,        // padded, wrapped at 64 characters with Unix EOL
+	base64EncodeByLine,
+	base64Decode,
+	base64DecodeStrict,
+	base64DecodeByLine,      // whitespace resets decoding
+	qpEncode,
+	qpDecode,
+	urlEncodeRFC1738,
+	urlEncodeRFC1738ByLine,
+	urlEncodeExtended,
+	urlEncodeExtendedByLine,
+	urlEncodeFull,
+	urlEncodeFullByLine,
+	urlDecode,
+	samlDecode,
+	samlEncode,
+	smartDecode,             // detects the encoding, see smartDecode.h
+	pipeline                 // chain of the stages of CodecOptions::pipeline, see pipeline.h
+};
+
+struct CodecInfo
+{
+	CodecId id;
+	const char *name;    // "base64-encode-pad"
+	const char *title;   // "Base64", used as title of the error messages
+};
+
+const CodecInfo *codecInfo(CodecId id);
+
+// Codecs are numbered from 0 to codecCount() - 1, in the order of CodecId
+size_t codecCount();
+
+// nullptr if no codec has that name
+const CodecInfo *findCodec(const char *name);
+
+struct CodecOptions
+{
+	const char *eol = "\n";    // end of line of the formatted SAML XML
+	bool formatXml = false;    // pretty-print the decoded SAML XML
+	std::string pipeline;      // stages of CodecId::pipeline: "base64url-decode | gunzip"
+	size_t maxOutput = 0;      // Smart Decode keeps the first maxOutput bytes and inflates no further, 0 = all
+};
+
+// Streaming conversion.
+//
+// Feeding a text to process() in pieces of any size, then calling finish(), gives
+// exactly the output of the one-shot conversion of the whole text. Each codec only
+// holds back the few bytes whose conversion depends on what follows (an incomplete
+// base64 quad, a line when the conversion is line based...), except the SAML ones
+// and Smart Decode which need the whole message.
+class Codec {
+public:
+	virtual ~Codec() {};
+
+	// Append to out what can already be converted; false on error (see errorMessage())
+	virtual bool process(const char *text, size_t length, std::string& out) = 0;
+	virtual bool finish(std::string& out) = 0;
+
+	const char *errorMessage() const { return _errorMessage; };
+
+protected:
+	const char *_errorMessage = "";
+};
+
+std::unique_ptr<Codec> createCodec(CodecId id, const CodecOptions& options = CodecOptions());
+
+// One shot helper; on error, errorMessage (if given) receives the codec error message
+bool convertText(CodecId id, const char *text, size_t length, std::string& out, const CodecOptions& options = CodecOptions(), const char **errorMessage = nullptr);
+
+// Output of a streaming codec given to a sink (see sink.h): appended in place for a StringSink,
+// through a pooled piece for the others
+inline bool processTo(Codec& codec, const char *text, size_t length, StringSink& sink)
+{
+	return codec.process(text, length, sink.string());
+}
+
+inline bool finishTo(Codec& codec, StringSink& sink)
+{
+	return codec.finish(sink.string());
+}
+
+template <typename Sink>
+bool processTo(Codec& codec, const char *text, size_t length, Sink& sink)
+{
+	PooledString piece;
+	if (!codec.process(text, length, *piece))
+		return false;
+	sink.append(piece->data(), piece->length());
+	return true;
+}
+
+template <typename Sink>
+bool finishTo(Codec& codec, Sink& sink)
+{
+	PooledString piece;
+	if (!codec.finish(*piece))
+		return false;
+	sink.append(piece->data(), piece->length());
+	return true;
+}
+
+// One shot conversion into sink, flushed at the end. The base64 conversions write straight
+// into the sink; the others are streamed in pieces of CONVERT_PIECE_SIZE, or at once into
+// a StringSink.
+// On error, errorMessage (if given) receives the codec error message, or says that the
+// sink could not be written.
+template <typename Sink>
+bool convertTo(CodecId id, const char *text, size_t length, Sink& sink, const CodecOptions& options = CodecOptions(), const char **errorMessage = nullptr)
+{
+	TRACE_SPAN_BYTES(codecInfo(id)->name, length);
+	bool ok = true;
+	const char *message = "Problem!";
+	switch (id)
+	{
+		case CodecId::base64Encode:
+			base64EncodeTo(sink, text, length, 0, false);
+			break;
+		case CodecId::base64EncodePad:
+			base64EncodeTo(sink, text, length, 0, true);
+			break;
+		case CodecId::base64EncodeWrap:
+			base64EncodeTo(sink, text, length, 64, true);
+			break;
+		case CodecId::base64Decode:
+			ok = base64DecodeTo(sink, text, length, false, false);
+			break;
+		case CodecId::base64DecodeStrict:
+			ok = base64DecodeTo(sink, text, length, true, false);
+			break;
+		case CodecId::base64DecodeByLine:
+			ok = base64DecodeTo(sink, text, length, false, true);
+			break;
+		default:
+		{
+			std::unique_ptr<Codec> codec = createCodec(id, options);
+			size_t pieceSize = std::is_same<Sink, StringSink>::value ? length : CONVERT_PIECE_SIZE;
+			for (size_t pos = 0; ok && pos < length; pos += pieceSize)
+				ok = processTo(*codec, text + pos, length - pos < pieceSize ? length - pos : pieceSize, sink);
+			ok = ok && finishTo(*codec, sink);
+			if (!ok)
+				message = codec->errorMessage();
+			break;
+		}
+	}
+
+	if (ok && !sink.flush())
+	{
+		ok = false;
+		message = "Cannot write the output.";
+	}
+	if (!ok && errorMessage)
+		*errorMessage = message;
+	return ok;
+}
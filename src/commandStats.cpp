@@ -0,0 +1,205 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "commandStats.h"
+
+static CommandRing g_commands;
+
+const char *commandRouteName(CommandRoute route)
+{
+	switch (route)
+	{
+		case CommandRoute::selection:   return "selection";
+		case CommandRoute::background:  return "background";
+		case CommandRoute::selections:  return "selections";
+		case CommandRoute::document:    return "document";
+		case CommandRoute::newTab:      return "new tab";
+		case CommandRoute::file:        return "file";
+		case CommandRoute::samlAll:     return "all parameters";
+		case CommandRoute::samlSummary: return "summary";
+		case CommandRoute::base64Runs:  return "all runs";
+	}
+	return "";
+}
+
+void CommandRing::push(const CommandSample& sample)
+{
+	uint64_t ticket = _nextTicket.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = _slots[ticket % CAPACITY];
+
+	slot.sequence.store(2 * ticket + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	uint64_t header = uint64_t(sample.id) | uint64_t(sample.route) << 16 | uint64_t(sample.ok) << 32;
+	slot.words[0].store(header, std::memory_order_relaxed);
+	slot.words[1].store(sample.inputBytes, std::memory_order_relaxed);
+	slot.words[2].store(sample.outputBytes, std::memory_order_relaxed);
+	slot.words[3].store(sample.fetchNs, std::memory_order_relaxed);
+	slot.words[4].store(sample.codecNs, std::memory_order_relaxed);
+	slot.words[5].store(sample.replaceNs, std::memory_order_relaxed);
+	slot.words[6].store(sample.outputCapacity, std::memory_order_relaxed);
+	slot.words[7].store(sample.bufferAllocations, std::memory_order_relaxed);
+	slot.words[8].store(sample.bufferReuses, std::memory_order_relaxed);
+
+	slot.sequence.store(2 * ticket + 2, std::memory_order_release);
+}
+
+std::vector<CommandSample> CommandRing::snapshot() const
+{
+	std::vector<std::pair<uint64_t, CommandSample>> found;
+	for (const Slot& slot : _slots)
+	{
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence == 0 || sequence % 2 != 0)
+			continue;
+
+		uint64_t words[WORDS];
+		for (size_t i = 0; i < WORDS; ++i)
+			words[i] = slot.words[i].load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+			continue;
+
+		CommandSample sample;
+		sample.id = CodecId(words[0] & 0xFFFF);
+		sample.route = CommandRoute((words[0] >> 16) & 0xFF);
+		sample.ok = (words[0] >> 32) != 0;
+		sample.inputBytes = words[1];
+		sample.outputBytes = words[2];
+		sample.fetchNs = words[3];
+		sample.codecNs = words[4];
+		sample.replaceNs = words[5];
+		sample.outputCapacity = words[6];
+		sample.bufferAllocations = words[7];
+		sample.bufferReuses = words[8];
+		found.emplace_back(sequence, sample);
+	}
+
+	std::sort(found.begin(), found.end(), [](const std::pair<uint64_t, CommandSample>& a, const std::pair<uint64_t, CommandSample>& b) { return a.first < b.first; });
+
+	std::vector<CommandSample> samples;
+	samples.reserve(found.size());
+	for (const auto& item : found)
+		samples.push_back(item.second);
+	return samples;
+}
+
+void recordCommand(const CommandSample& sample)
+{
+	g_commands.push(sample);
+}
+
+std::vector<CommandSample> recordedCommands()
+{
+	return g_commands.snapshot();
+}
+
+double percentile(std::vector<double> values, double rank)
+{
+	if (values.empty())
+		return 0;
+	std::sort(values.begin(), values.end());
+	size_t index = size_t(ceil(rank / 100 * double(values.size())));
+	return values[index > 0 ? index - 1 : 0];
+}
+
+static double toMs(uint64_t ns)
+{
+	return double(ns) / 1e6;
+}
+
+std::vector<CommandSummary> summarizeCommands(const std::vector<CommandSample>& samples)
+{
+	std::map<std::pair<int, int>, std::vector<const CommandSample *>> groups;
+	for (const CommandSample& sample : samples)
+		groups[std::make_pair(int(sample.id), int(sample.route))].push_back(&sample);
+
+	std::vector<CommandSummary> summaries;
+	for (const auto& group : groups)
+	{
+		CommandSummary summary;
+		summary.id = CodecId(group.first.first);
+		summary.route = CommandRoute(group.first.second);
+		summary.count = group.second.size();
+
+		std::vector<double> total, fetch, codec, replace, throughput, allocations;
+		for (const CommandSample *sample : group.second)
+		{
+			if (!sample->ok)
+				++summary.failures;
+			total.push_back(toMs(sample->totalNs()));
+			fetch.push_back(toMs(sample->fetchNs));
+			codec.push_back(toMs(sample->codecNs));
+			replace.push_back(toMs(sample->replaceNs));
+			if (sample->totalNs() > 0)
+				throughput.push_back(double(sample->inputBytes) / (1 << 20) / (double(sample->totalNs()) / 1e9));
+			summary.outputCapacity = std::max(summary.outputCapacity, sample->outputCapacity);
+			allocations.push_back(double(sample->bufferAllocations));
+		}
+
+		summary.totalMs[0] = percentile(total, 50);
+		summary.totalMs[1] = percentile(total, 90);
+		summary.totalMs[2] = percentile(total, 99);
+		summary.fetchMs = percentile(fetch, 50);
+		summary.codecMs = percentile(codec, 50);
+		summary.replaceMs = percentile(replace, 50);
+		summary.mbPerSecond = percentile(throughput, 50);
+		summary.bufferAllocations = percentile(allocations, 50);
+		summaries.push_back(summary);
+	}
+	return summaries;
+}
+
+std::string commandSamplesCsv(const std::vector<CommandSample>& samples)
+{
+	std::string csv = "command,route,ok,input_bytes,output_bytes,fetch_us,codec_us,replace_us,total_us,output_capacity,buffer_allocations,buffer_reuses\n";
+	char line[256];
+	for (const CommandSample& sample : samples)
+	{
+		snprintf(line, sizeof(line), "%s,%s,%d,%llu,%llu,%.1f,%.1f,%.1f,%.1f,%llu,%llu,%llu\n",
+			codecInfo(sample.id)->name, commandRouteName(sample.route), sample.ok ? 1 : 0,
+			(unsigned long long)sample.inputBytes, (unsigned long long)sample.outputBytes,
+			double(sample.fetchNs) / 1e3, double(sample.codecNs) / 1e3, double(sample.replaceNs) / 1e3, double(sample.totalNs()) / 1e3,
+			(unsigned long long)sample.outputCapacity, (unsigned long long)sample.bufferAllocations, (unsigned long long)sample.bufferReuses);
+		csv += line;
+	}
+	return csv;
+}
+
+std::string commandSummaryText(const std::vector<CommandSummary>& summaries)
+{
+	std::string text = "Command\tRuns\tp50 ms\tp90 ms\tp99 ms\tfetch/codec/replace ms\tMB/s\toutput capacity KB\tallocs\n";
+	char line[512];
+	for (const CommandSummary& summary : summaries)
+	{
+		snprintf(line, sizeof(line), "%s (%s)\t%zu%s\t%.2f\t%.2f\t%.2f\t%.2f / %.2f / %.2f\t%.1f\t%llu\t%.0f\n",
+			codecInfo(summary.id)->name, commandRouteName(summary.route),
+			summary.count, summary.failures ? (" (" + std::to_string(summary.failures) + " failed)").c_str() : "",
+			summary.totalMs[0], summary.totalMs[1], summary.totalMs[2],
+			summary.fetchMs, summary.codecMs, summary.replaceMs,
+			summary.mbPerSecond, (unsigned long long)(summary.outputCapacity >> 10), summary.bufferAllocations);
+		text += line;
+	}
+	return text;
+}
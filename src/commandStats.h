@@ -0,0 +1,164 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "bufferPool.h"
+#include "codec.h"
+#include "trace.h"
+
+// How a conversion command ran
+enum class CommandRoute : uint8_t {
+	selection,        // one selection, converted on the spot
+	background,       // one large selection, converted by a worker thread
+	selections,       // multiple or rectangular selection
+	document,         // no selection: the whole document, in place
+	newTab,           // into a new document
+	file,             // a file into another one
+	samlAll,          // SAML Decode all parameters into new tab
+	samlSummary,      // SAML Decode and summarize into new tab
+	base64Runs        // Base64 Decode every run of the document
+};
+
+const char *commandRouteName(CommandRoute route);
+
+// Timing and sizes of one run of a conversion command
+struct CommandSample
+{
+	CodecId id = CodecId::base64Encode;
+	CommandRoute route = CommandRoute::selection;
+	bool ok = false;
+	uint64_t inputBytes = 0;
+	uint64_t outputBytes = 0;
+	uint64_t fetchNs = 0;      // getting the text out of Scintilla (or opening the files)
+	uint64_t codecNs = 0;      // converting
+	uint64_t replaceNs = 0;    // putting the result back into Scintilla
+	uint64_t outputCapacity = 0;      // bytes reserved for the output (or its staging buffer), 0 if not known;
+	                                  // not a peak: input copies and the codecs' own buffers are not counted
+	uint64_t bufferAllocations = 0;   // buffers the pools had to allocate (see bufferPool.h)
+	uint64_t bufferReuses = 0;        // buffers the pools gave back from a previous command
+
+	uint64_t totalNs() const { return fetchNs + codecNs + replaceNs; };
+};
+
+// Times the phases of a command; a named lap is also a trace span (see trace.h)
+class StopWatch {
+public:
+	StopWatch() : _startNs(traceNowNs()) {};
+
+	// Time since the construction or the previous lap
+	uint64_t lapNs(const char *traceName = nullptr, uint64_t bytes = 0)
+	{
+		uint64_t now = traceNowNs();
+		uint64_t elapsed = now - _startNs;
+#if MIMETOOLS_TRACE
+		if (traceName && traceEnabled())
+			traceComplete(traceName, _startNs, now, bytes);
+#else
+		(void)traceName;
+		(void)bytes;
+#endif
+		_startNs = now;
+		return elapsed;
+	};
+
+private:
+	uint64_t _startNs;
+};
+
+// Counts the buffers taken from the pools between the construction and addTo(). The
+// counters are shared by all the threads: a command overlapping a background conversion
+// is also charged with the buffers of the latter.
+class BufferUsage {
+public:
+	BufferUsage() : _start(bufferPoolCounters()) {};
+
+	void addTo(CommandSample& sample) const
+	{
+		BufferPoolCounters now = bufferPoolCounters();
+		sample.bufferAllocations = now.allocated - _start.allocated;
+		sample.bufferReuses = now.acquired - _start.acquired - sample.bufferAllocations;
+	};
+
+private:
+	BufferPoolCounters _start;
+};
+
+// Fixed size ring of the last samples, written and read without locks.
+//
+// A writer takes a ticket, then fills slot ticket % capacity under a sequence number
+// (odd while it writes, even once done); a reader keeps a slot only if its sequence
+// number was even and unchanged across the read, so it never sees a torn sample.
+// The oldest samples are overwritten.
+class CommandRing {
+public:
+	static constexpr size_t CAPACITY = 1024;
+
+	void push(const CommandSample& sample);
+
+	// The samples present, oldest first
+	std::vector<CommandSample> snapshot() const;
+
+private:
+	static constexpr size_t WORDS = 9;
+
+	struct Slot
+	{
+		std::atomic<uint64_t> sequence{0};
+		std::atomic<uint64_t> words[WORDS];
+	};
+
+	Slot _slots[CAPACITY];
+	std::atomic<uint64_t> _nextTicket{0};
+};
+
+// The ring of the commands run since the plugin was loaded
+void recordCommand(const CommandSample& sample);
+std::vector<CommandSample> recordedCommands();
+
+// Statistics of the samples of one codec run one way
+struct CommandSummary
+{
+	CodecId id;
+	CommandRoute route;
+	size_t count = 0;
+	size_t failures = 0;
+	double totalMs[3] = {};     // 50th, 90th and 99th percentiles
+	double fetchMs = 0;         // medians of the phases
+	double codecMs = 0;
+	double replaceMs = 0;
+	double mbPerSecond = 0;     // median of input bytes / total time
+	uint64_t outputCapacity = 0; // largest seen
+	double bufferAllocations = 0;    // median per run
+};
+
+// One summary per (codec, route) present, in CodecId then CommandRoute order
+std::vector<CommandSummary> summarizeCommands(const std::vector<CommandSample>& samples);
+
+// Nearest-rank percentile (0 to 100) of values, 0 if there is none
+double percentile(std::vector<double> values, double rank);
+
+// One line per sample, with a header line
+std::string commandSamplesCsv(const std::vector<CommandSample>& samples);
+
+// Tab separated table of the summaries, for a message box
+std::string commandSummaryText(const std::vector<CommandSummary>& summaries);
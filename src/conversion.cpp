@@ -0,0 +1,672 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <commctrl.h>
+#include <commdlg.h>
+
+#include "PluginInterface.h"
+#include "menuCmdID.h"
+#include "mimeTools.h"
+#include "commandStats.h"
+#include "bufferPool.h"
+#include "conversion.h"
+#include "conversionJob.h"
+#include "fileConversion.h"
+#include "scintillaSink.h"
+#include "trace.h"
+#include "parallel.h"
+
+extern NppData nppData;
+extern HINSTANCE g_hInst;
+
+constexpr UINT WM_CONVERSION_DONE = WM_APP + 1;
+constexpr UINT_PTR PROGRESS_TIMER_ID = 1;
+constexpr UINT PROGRESS_TIMER_PERIOD = 100;
+constexpr int PROGRESS_RANGE = 1000;
+
+// The conversion running on a worker thread, with its progress dialog
+struct BackgroundConversion
+{
+	std::unique_ptr<ConversionJob> job;
+	const CodecInfo *info = nullptr;
+	CommandSample sample;
+	BufferUsage buffers;
+	HWND hDialog = nullptr;
+};
+
+static std::unique_ptr<BackgroundConversion> g_job;
+
+static ScintillaCall scintillaCall(HWND hScintilla)
+{
+	return [hScintilla](unsigned int message, uptr_t wParam, sptr_t lParam) { return ::SendMessage(hScintilla, message, wParam, lParam); };
+}
+
+void replaceRange(HWND hScintilla, size_t start, size_t end, const std::string& text)
+{
+	::SendMessage(hScintilla, SCI_SETTARGETRANGE, start, end);
+	::SendMessage(hScintilla, SCI_REPLACETARGET, text.length(), (LPARAM)text.data());
+	::SendMessage(hScintilla, SCI_SETSEL, start, start + text.length());
+}
+
+// Destroy the dialog, then the job, which releases the document
+static void closeJob(std::unique_ptr<BackgroundConversion> background)
+{
+	::KillTimer(background->hDialog, PROGRESS_TIMER_ID);
+	::SendMessage(nppData._nppHandle, NPPM_MODELESSDIALOG, MODELESSDIALOGREMOVE, (LPARAM)background->hDialog);
+	::DestroyWindow(background->hDialog);
+}
+
+static void endConversion()
+{
+	std::unique_ptr<BackgroundConversion> background = std::move(g_job);
+	ConversionJob& job = *background->job;
+	job.join();
+
+	if (!job.isCancelled())
+	{
+		CommandSample& sample = background->sample;
+		sample.codecNs = job.codecNs();
+		if (!job.ok())
+			::MessageBoxA(nppData._nppHandle, job.errorMessage(), background->info->title, MB_OK);
+		else
+		{
+			StopWatch watch;
+			sample.ok = job.apply();
+			sample.replaceNs = watch.lapNs("replace");
+			if (!sample.ok)
+				::MessageBoxA(nppData._nppHandle, "The text was modified during the conversion: the result is discarded.", background->info->title, MB_OK);
+		}
+
+		sample.outputBytes = job.output().length();
+		sample.outputCapacity = job.output().capacity();
+		background->buffers.addTo(sample);
+		recordCommand(sample);
+	}
+	closeJob(std::move(background));
+}
+
+static INT_PTR CALLBACK progressDlgProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM /*lParam*/)
+{
+	switch (message)
+	{
+		case WM_INITDIALOG:
+		{
+			::SendDlgItemMessage(hwnd, IDC_PROGRESS_BAR, PBM_SETRANGE32, 0, PROGRESS_RANGE);
+			::SetTimer(hwnd, PROGRESS_TIMER_ID, PROGRESS_TIMER_PERIOD, NULL);
+			return TRUE;
+		}
+
+		case WM_TIMER:
+		{
+			if (g_job)
+				::SendDlgItemMessage(hwnd, IDC_PROGRESS_BAR, PBM_SETPOS, WPARAM(g_job->job->progress() * PROGRESS_RANGE), 0);
+			return TRUE;
+		}
+
+		case WM_COMMAND:
+		{
+			if (LOWORD(wParam) == IDCANCEL && g_job)
+			{
+				g_job->job->cancel();
+				::SetDlgItemText(hwnd, IDC_PROGRESS_TEXT, TEXT("Cancelling..."));
+				::EnableWindow(::GetDlgItem(hwnd, IDCANCEL), FALSE);
+				return TRUE;
+			}
+			return FALSE;
+		}
+
+		case WM_CONVERSION_DONE:
+		{
+			if (g_job)
+				endConversion();
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+// Convert [start, end) on a worker thread, behind a progress dialog that offers to cancel.
+// With readOnly, the document cannot be edited until the result is applied.
+static void startBackgroundConversion(HWND hScintilla, size_t start, size_t end, CodecId id, const CodecOptions& options, const CommandSample& sample, const BufferUsage& buffers, bool readOnly)
+{
+	if (g_job)
+	{
+		::MessageBox(nppData._nppHandle, TEXT("A conversion is already running."), TEXT("MIME Tools"), MB_OK);
+		return;
+	}
+
+	const CodecInfo *info = codecInfo(id);
+	StopWatch watch;
+	std::unique_ptr<BackgroundConversion> job(new BackgroundConversion);
+	job->job.reset(new ConversionJob(scintillaCall(hScintilla), start, end, createCodec(id, options), readOnly));
+	job->info = info;
+	job->sample = sample;
+	job->sample.fetchNs += watch.lapNs("fetch");
+	job->buffers = buffers;
+
+	job->hDialog = ::CreateDialogParam(g_hInst, MAKEINTRESOURCE(IDD_PROGRESS), nppData._nppHandle, progressDlgProc, 0);
+	::SendMessage(nppData._nppHandle, NPPM_MODELESSDIALOG, MODELESSDIALOGADD, (LPARAM)job->hDialog);
+	::SendMessage(nppData._nppHandle, NPPM_DARKMODESUBCLASSANDTHEME, static_cast<WPARAM>(NppDarkMode::dmfInit), reinterpret_cast<LPARAM>(job->hDialog));
+
+	std::wstring caption = TEXT("Converting ") + std::to_wstring((end - start) >> 20) + TEXT(" MB (") + std::wstring(info->name, info->name + strlen(info->name)) + TEXT(")...");
+	::SetDlgItemText(job->hDialog, IDC_PROGRESS_TEXT, caption.c_str());
+	::ShowWindow(job->hDialog, SW_SHOW);
+
+	HWND hDialog = job->hDialog;
+	g_job = std::move(job);
+	g_job->job->start([hDialog]() { ::PostMessage(hDialog, WM_CONVERSION_DONE, 0, 0); });
+}
+
+// Convert the whole document in place, piece by piece: each piece read through
+// SCI_GETRANGEPOINTER is replaced by what the codec could convert of it, the codec keeping
+// the few bytes it needs to see more of. The plugin only ever holds one piece of output.
+// On error, the pieces already replaced are undone.
+// From BACKGROUND_CONVERSION_MIN, the document is converted by a worker thread instead,
+// read-only meanwhile, and replaced at once.
+static void convertDocument(HWND hScintilla, CodecId id, const CodecOptions& options)
+{
+	size_t length = ::SendMessage(hScintilla, SCI_GETLENGTH, 0, 0);
+	if (length == 0) return;
+
+	BufferUsage buffers;
+	CommandSample sample;
+	sample.id = id;
+	sample.route = CommandRoute::document;
+	sample.inputBytes = length;
+
+	if (length >= BACKGROUND_CONVERSION_MIN)
+	{
+		startBackgroundConversion(hScintilla, 0, length, id, options, sample, buffers, true);
+		return;
+	}
+
+	HCURSOR hPreviousCursor = ::SetCursor(::LoadCursor(NULL, IDC_WAIT));
+
+	std::unique_ptr<Codec> codec = createCodec(id, options);
+	PooledString output(CONVERSION_PIECE_SIZE);
+	size_t pos = 0;      // start of the text not converted yet
+	size_t end = length; // end of the document, as it shrinks or grows
+	bool ok = true;
+	bool modified = false;
+	StopWatch watch;
+
+	::SendMessage(hScintilla, SCI_BEGINUNDOACTION, 0, 0);
+	while (ok && pos < end)
+	{
+		size_t pieceLength = end - pos < CONVERSION_PIECE_SIZE ? end - pos : CONVERSION_PIECE_SIZE;
+		const char *text = (const char *)::SendMessage(hScintilla, SCI_GETRANGEPOINTER, pos, pieceLength);
+		sample.fetchNs += watch.lapNs("fetch");
+
+		output->clear();
+		ok = codec->process(text, pieceLength, *output);
+		sample.codecNs += watch.lapNs("codec");
+		if (ok)
+		{
+			::SendMessage(hScintilla, SCI_SETTARGETRANGE, pos, pos + pieceLength);
+			::SendMessage(hScintilla, SCI_REPLACETARGET, output->length(), (LPARAM)output->data());
+			pos += output->length();
+			end = end - pieceLength + output->length();
+			modified = true;
+			sample.outputBytes += output->length();
+			sample.replaceNs += watch.lapNs("replace");
+		}
+	}
+	if (ok)
+	{
+		output->clear();
+		ok = codec->finish(*output);
+		sample.codecNs += watch.lapNs("codec");
+		if (ok)
+		{
+			::SendMessage(hScintilla, SCI_SETTARGETRANGE, pos, pos);
+			::SendMessage(hScintilla, SCI_REPLACETARGET, output->length(), (LPARAM)output->data());
+			sample.outputBytes += output->length();
+		}
+	}
+	::SendMessage(hScintilla, SCI_ENDUNDOACTION, 0, 0);
+	sample.replaceNs += watch.lapNs("replace");
+
+	::SetCursor(hPreviousCursor);
+
+	sample.ok = ok;
+	sample.outputCapacity = output->capacity();
+	buffers.addTo(sample);
+	recordCommand(sample);
+
+	if (!ok)
+	{
+		if (modified)
+			::SendMessage(hScintilla, SCI_UNDO, 0, 0);
+		::MessageBoxA(nppData._nppHandle, codec->errorMessage(), codecInfo(id)->title, MB_OK);
+	}
+}
+
+// Convert text into hTarget through a ScintillaSink; the time spent is added to sample
+static bool appendConversion(HWND hTarget, CodecId id, const CodecOptions& options, const char *text, size_t length, CommandSample& sample, const char **errorMessage)
+{
+	StopWatch watch;
+	std::unique_ptr<ScintillaSink> sink(new ScintillaSink(hTarget));
+	bool ok = convertTo(id, text, length, *sink, options, errorMessage);
+	uint64_t elapsedNs = watch.lapNs("convert");
+	sample.codecNs += elapsedNs - sink->writeNs();
+	sample.replaceNs += sink->writeNs();
+	sample.outputBytes += sink->written();
+	sample.outputCapacity = std::max<uint64_t>(sample.outputCapacity, SINK_STAGING_SIZE);
+	return ok;
+}
+
+// Stream the conversion of the selections, or of the whole document, into a new document.
+// The source text is read in place: the pointers stay valid since nothing modifies the
+// source document while it is hidden behind the new one.
+static void convertIntoNewTab(HWND hScintilla, CodecId id, const CodecOptions& options)
+{
+	struct SourceRange
+	{
+		size_t start;
+		size_t end;
+	};
+	std::vector<SourceRange> ranges;
+
+	CommandSample sample;
+	sample.id = id;
+	sample.route = CommandRoute::newTab;
+	StopWatch watch;
+	BufferUsage buffers;
+
+	size_t nbSelections = ::SendMessage(hScintilla, SCI_GETSELECTIONS, 0, 0);
+	for (size_t i = 0; i < nbSelections; ++i)
+	{
+		size_t start = ::SendMessage(hScintilla, SCI_GETSELECTIONNSTART, i, 0);
+		size_t end = ::SendMessage(hScintilla, SCI_GETSELECTIONNEND, i, 0);
+		if (end > start)
+			ranges.push_back({start, end});
+	}
+	if (ranges.empty())
+	{
+		size_t length = ::SendMessage(hScintilla, SCI_GETLENGTH, 0, 0);
+		if (length == 0) return;
+		ranges.push_back({0, length});
+	}
+	std::sort(ranges.begin(), ranges.end(), [](const SourceRange& a, const SourceRange& b) { return a.start < b.start; });
+
+	// A single range does not need the whole document to be made contiguous
+	const char *text;      // document text from position textStart
+	size_t textStart = 0;
+	if (ranges.size() == 1)
+	{
+		textStart = ranges[0].start;
+		text = (const char *)::SendMessage(hScintilla, SCI_GETRANGEPOINTER, textStart, ranges[0].end - textStart);
+	}
+	else
+		text = (const char *)::SendMessage(hScintilla, SCI_GETCHARACTERPOINTER, 0, 0);
+
+	for (const SourceRange& range : ranges)
+		sample.inputBytes += range.end - range.start;
+	sample.fetchNs = watch.lapNs("fetch");
+
+	HCURSOR hPreviousCursor = ::SetCursor(::LoadCursor(NULL, IDC_WAIT));
+
+	::SendMessage(nppData._nppHandle, NPPM_MENUCOMMAND, 0, IDM_FILE_NEW);
+	HWND hNewScintilla = getCurrentScintillaHandle();
+	const char *eol = getEolString(hNewScintilla);
+
+	::SendMessage(hNewScintilla, SCI_SETUNDOCOLLECTION, FALSE, 0);
+	sample.replaceNs = watch.lapNs("replace");
+	const char *errorMessage = "";
+	bool ok = true;
+	for (size_t i = 0; ok && i < ranges.size(); ++i)
+	{
+		if (i > 0)
+			::SendMessage(hNewScintilla, SCI_APPENDTEXT, strlen(eol), (LPARAM)eol);
+		ok = appendConversion(hNewScintilla, id, options, text + ranges[i].start - textStart, ranges[i].end - ranges[i].start, sample, &errorMessage);
+	}
+	watch.lapNs();
+	::SendMessage(hNewScintilla, SCI_SETUNDOCOLLECTION, TRUE, 0);
+	::SendMessage(hNewScintilla, SCI_EMPTYUNDOBUFFER, 0, 0);
+	sample.replaceNs += watch.lapNs("replace");
+
+	::SetCursor(hPreviousCursor);
+
+	sample.ok = ok;
+	buffers.addTo(sample);
+	recordCommand(sample);
+
+	if (ok)
+	{
+		::SendMessage(hNewScintilla, SCI_GOTOPOS, 0, 0);
+		return;
+	}
+
+	// The half filled document is emptied so that it closes without asking to be saved
+	::SendMessage(hNewScintilla, SCI_CLEARALL, 0, 0);
+	::SendMessage(hNewScintilla, SCI_SETSAVEPOINT, 0, 0);
+	::SendMessage(nppData._nppHandle, NPPM_MENUCOMMAND, 0, IDM_FILE_CLOSE);
+	::MessageBoxA(nppData._nppHandle, errorMessage, codecInfo(id)->title, MB_OK);
+}
+
+bool chooseFile(bool save, const TCHAR *title, TCHAR *path)
+{
+	OPENFILENAME ofn = {};
+	ofn.lStructSize = sizeof(ofn);
+	ofn.hwndOwner = nppData._nppHandle;
+	ofn.lpstrFilter = TEXT("All files (*.*)\0*.*\0");
+	ofn.lpstrFile = path;
+	ofn.nMaxFile = MAX_PATH;
+	ofn.lpstrTitle = title;
+	ofn.Flags = OFN_PATHMUSTEXIST | OFN_HIDEREADONLY | (save ? OFN_OVERWRITEPROMPT : OFN_FILEMUSTEXIST);
+	return (save ? ::GetSaveFileName(&ofn) : ::GetOpenFileName(&ofn)) != FALSE;
+}
+
+uint64_t fileSize(const TCHAR *path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!::GetFileAttributesEx(path, GetFileExInfoStandard, &attributes))
+		return 0;
+	return uint64_t(attributes.nFileSizeHigh) << 32 | attributes.nFileSizeLow;
+}
+
+void convertChosenFile(CodecId id, const CodecOptions& options)
+{
+	const CodecInfo *info = codecInfo(id);
+	std::wstring codecName(info->name, info->name + strlen(info->name));
+
+	TCHAR source[MAX_PATH] = {};
+	std::wstring title = TEXT("File to convert (") + codecName + TEXT(")");
+	if (!chooseFile(false, title.c_str(), source))
+		return;
+
+	// the destination is proposed next to the source, named after the conversion
+	TCHAR destination[MAX_PATH] = {};
+	std::wstring proposed = std::wstring(source) + TEXT(".") + codecName;
+	if (proposed.length() < MAX_PATH)
+		lstrcpy(destination, proposed.c_str());
+	title = TEXT("Converted file (") + codecName + TEXT(")");
+	if (!chooseFile(true, title.c_str(), destination))
+		return;
+
+	HCURSOR hPreviousCursor = ::SetCursor(::LoadCursor(NULL, IDC_WAIT));
+	const char *errorMessage = "";
+	StopWatch watch;
+	BufferUsage buffers;
+	bool ok = convertFile(id, source, destination, options, &errorMessage);
+	::SetCursor(hPreviousCursor);
+
+	// the whole file conversion is counted as codec time
+	CommandSample sample;
+	sample.id = id;
+	sample.route = CommandRoute::file;
+	sample.ok = ok;
+	sample.codecNs = watch.lapNs("codec");
+	sample.inputBytes = fileSize(source);
+	sample.outputBytes = ok ? fileSize(destination) : 0;
+	buffers.addTo(sample);
+	recordCommand(sample);
+
+	if (!ok)
+		::MessageBoxA(nppData._nppHandle, errorMessage, info->title, MB_OK);
+}
+
+// One of the selections of a multiple or rectangular selection
+struct SelectionItem
+{
+	size_t index;        // in Scintilla's selection list
+	size_t start;
+	size_t end;
+	bool caretAtStart;
+	PooledString output;
+	bool ok;
+	const char *errorMessage;
+};
+
+// Convert every selection concurrently, then replace them back-to-front in one undo action,
+// so that the positions of the selections still to be replaced are not shifted
+static void convertSelections(HWND hScintilla, size_t nbSelections, CodecId id, const CodecOptions& options)
+{
+	CommandSample sample;
+	sample.id = id;
+	sample.route = CommandRoute::selections;
+	StopWatch watch;
+	BufferUsage buffers;
+
+	std::vector<SelectionItem> items(nbSelections);
+	for (size_t i = 0; i < nbSelections; ++i)
+	{
+		SelectionItem& item = items[i];
+		item.index = i;
+		item.start = ::SendMessage(hScintilla, SCI_GETSELECTIONNSTART, i, 0);
+		item.end = ::SendMessage(hScintilla, SCI_GETSELECTIONNEND, i, 0);
+		item.caretAtStart = size_t(::SendMessage(hScintilla, SCI_GETSELECTIONNCARET, i, 0)) == item.start;
+		item.ok = true;
+		item.errorMessage = "";
+
+		// the output buffers come from the pool of this thread, the workers only fill them
+		item.output.reserve(item.end - item.start);
+	}
+	size_t mainSelection = ::SendMessage(hScintilla, SCI_GETMAINSELECTION, 0, 0);
+	std::sort(items.begin(), items.end(), [](const SelectionItem& a, const SelectionItem& b) { return a.start < b.start; });
+
+	// Pointers got from SCI_GETRANGEPOINTER may be invalidated by the next call,
+	// the whole document is made contiguous once instead
+	const char *text = (const char *)::SendMessage(hScintilla, SCI_GETCHARACTERPOINTER, 0, 0);
+	sample.fetchNs = watch.lapNs("fetch");
+
+	parallelFor(nbSelections, [&](size_t i)
+	{
+		SelectionItem& item = items[i];
+		if (item.end > item.start)
+			item.ok = convertText(id, text + item.start, item.end - item.start, *item.output, options, &item.errorMessage);
+	});
+	sample.codecNs = watch.lapNs("codec");
+
+	for (const SelectionItem& item : items)
+	{
+		sample.inputBytes += item.end - item.start;
+		sample.outputBytes += item.output->length();
+		sample.outputCapacity += item.output->capacity();
+	}
+	buffers.addTo(sample);
+	for (const SelectionItem& item : items)
+	{
+		if (!item.ok)
+		{
+			recordCommand(sample);
+			::MessageBoxA(nppData._nppHandle, item.errorMessage, codecInfo(id)->title, MB_OK);
+			return;
+		}
+	}
+
+	::SendMessage(hScintilla, SCI_BEGINUNDOACTION, 0, 0);
+	for (size_t i = nbSelections; i-- > 0; )
+	{
+		const SelectionItem& item = items[i];
+		if (item.end > item.start)
+		{
+			::SendMessage(hScintilla, SCI_SETTARGETRANGE, item.start, item.end);
+			::SendMessage(hScintilla, SCI_REPLACETARGET, item.output->length(), (LPARAM)item.output->data());
+		}
+	}
+	::SendMessage(hScintilla, SCI_ENDUNDOACTION, 0, 0);
+
+	// Select the converted texts, now shifted by the length changes of the ones before them
+	size_t newMainSelection = 0;
+	ptrdiff_t shift = 0;
+	for (size_t i = 0; i < nbSelections; ++i)
+	{
+		const SelectionItem& item = items[i];
+		size_t start = item.start + shift;
+		size_t end = item.end > item.start ? start + item.output->length() : start;
+		shift += ptrdiff_t(end - start) - ptrdiff_t(item.end - item.start);
+
+		size_t caret = item.caretAtStart ? start : end;
+		size_t anchor = item.caretAtStart ? end : start;
+		::SendMessage(hScintilla, i == 0 ? SCI_SETSELECTION : SCI_ADDSELECTION, caret, anchor);
+		if (item.index == mainSelection)
+			newMainSelection = i;
+	}
+	::SendMessage(hScintilla, SCI_SETMAINSELECTION, newMainSelection, 0);
+
+	sample.replaceNs = watch.lapNs("replace");
+	sample.ok = true;
+	recordCommand(sample);
+}
+
+void convertSelection(HWND hScintilla, CodecId id, const CodecOptions& options, ConversionOutput output)
+{
+	if (output == ConversionOutput::newTab)
+	{
+		convertIntoNewTab(hScintilla, id, options);
+		return;
+	}
+
+	size_t nbSelections = ::SendMessage(hScintilla, SCI_GETSELECTIONS, 0, 0);
+	if (nbSelections > 1)
+	{
+		convertSelections(hScintilla, nbSelections, id, options);
+		return;
+	}
+
+	size_t start = ::SendMessage(hScintilla, SCI_GETSELECTIONSTART, 0, 0);
+	size_t end = ::SendMessage(hScintilla, SCI_GETSELECTIONEND, 0, 0);
+	if (end < start)
+	{
+		size_t tmp = start;
+		start = end;
+		end = tmp;
+	}
+	size_t length = end - start;
+	if (length == 0)
+	{
+		convertDocument(hScintilla, id, options);
+		return;
+	}
+
+	const CodecInfo *info = codecInfo(id);
+	CommandSample sample;
+	sample.id = id;
+	sample.route = length < BACKGROUND_CONVERSION_MIN ? CommandRoute::selection : CommandRoute::background;
+	sample.inputBytes = length;
+	StopWatch watch;
+	BufferUsage buffers;
+
+	const char *text = (const char *)::SendMessage(hScintilla, SCI_GETRANGEPOINTER, start, length);
+
+	if (length < BACKGROUND_CONVERSION_MIN)
+	{
+		sample.fetchNs = watch.lapNs("fetch");
+		PooledString converted(length);
+		const char *errorMessage = "";
+		sample.ok = convertText(id, text, length, *converted, options, &errorMessage);
+		sample.codecNs = watch.lapNs("codec");
+		sample.outputBytes = converted->length();
+		sample.outputCapacity = converted->capacity();
+		if (sample.ok)
+		{
+			replaceRange(hScintilla, start, end, *converted);
+			sample.replaceNs = watch.lapNs("replace");
+		}
+		buffers.addTo(sample);
+		recordCommand(sample);
+
+		if (!sample.ok)
+			::MessageBoxA(nppData._nppHandle, errorMessage, info->title, MB_OK);
+		return;
+	}
+
+	sample.fetchNs = watch.lapNs("fetch");
+	startBackgroundConversion(hScintilla, start, end, id, options, sample, buffers, false);
+}
+
+void cancelConversion()
+{
+	if (!g_job)
+		return;
+
+	g_job->job->cancel();
+	g_job->job->join();
+	closeJob(std::move(g_job));
+}
+
+static UINT_PTR g_bufferTrimTimer = 0;
+
+static void CALLBACK trimBuffers(HWND /*hwnd*/, UINT /*message*/, UINT_PTR /*id*/, DWORD /*time*/)
+{
+	trimBufferPool();
+}
+
+void startBufferTrimming()
+{
+	if (!g_bufferTrimTimer)
+		g_bufferTrimTimer = ::SetTimer(NULL, 0, BUFFER_TRIM_PERIOD, trimBuffers);
+}
+
+void stopBufferTrimming()
+{
+	if (g_bufferTrimTimer)
+		::KillTimer(NULL, g_bufferTrimTimer);
+	g_bufferTrimTimer = 0;
+	trimBufferPool(0);
+}
+
+static bool writeTextFile(const TCHAR *path, const std::string& text)
+{
+	FILE *file = _wfopen(path, L"wb");
+	if (!file)
+		return false;
+	bool ok = fwrite(text.data(), 1, text.length(), file) == text.length();
+	return fclose(file) == 0 && ok;
+}
+
+void saveConversionTrace()
+{
+	stopTrace();
+	if (traceEventCount() == 0)
+	{
+		::MessageBox(nppData._nppHandle, TEXT("No conversion was traced."), TEXT("Trace conversions"), MB_OK);
+		return;
+	}
+
+	TCHAR path[MAX_PATH] = TEXT("mimeTools-trace.json");
+	if (!chooseFile(true, TEXT("Save the trace (chrome://tracing, Perfetto)"), path))
+		return;
+	if (!writeTextFile(path, traceJson()))
+		::MessageBox(nppData._nppHandle, TEXT("The file could not be written."), TEXT("Trace conversions"), MB_OK);
+}
+
+void showConversionStatistics()
+{
+	std::vector<CommandSample> samples = recordedCommands();
+	if (samples.empty())
+	{
+		::MessageBox(nppData._nppHandle, TEXT("No conversion was run yet."), TEXT("Performance statistics"), MB_OK);
+		return;
+	}
+
+	std::string text = commandSummaryText(summarizeCommands(samples));
+	text += "\nSave the " + std::to_string(samples.size()) + " samples as CSV?";
+	if (::MessageBoxA(nppData._nppHandle, text.c_str(), "Performance statistics", MB_YESNO) != IDYES)
+		return;
+
+	TCHAR path[MAX_PATH] = TEXT("mimeTools-statistics.csv");
+	if (!chooseFile(true, TEXT("Save the samples"), path))
+		return;
+
+	if (!writeTextFile(path, commandSamplesCsv(samples)))
+		::MessageBox(nppData._nppHandle, TEXT("The file could not be written."), TEXT("Performance statistics"), MB_OK);
+}
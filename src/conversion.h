@@ -0,0 +1,73 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+
+#include "codec.h"
+
+// Where the converted text goes
+enum class ConversionOutput {
+	replace,    // replaces the converted text
+	newTab      // streamed into a new document, the source one is left untouched
+};
+
+// Selections and documents up to this size are converted right away on the UI thread
+constexpr size_t BACKGROUND_CONVERSION_MIN = 4 << 20;
+
+// Replace the selection of hScintilla by its conversion.
+// A large selection is copied and converted on a worker thread while a progress dialog
+// offers to cancel; the result is applied later, only if the document still holds the
+// converted text at the same place.
+// Without selection, the whole document is converted in place, piece by piece; a large
+// one the way a large selection is, the document being read-only until the result is applied.
+// Multiple and rectangular selections are converted concurrently and replaced in one undo
+// action, each converted text being selected afterwards.
+// With ConversionOutput::newTab, the conversion of the selections (or of the document) is
+// appended piece by piece to a new document, without undo history.
+void convertSelection(HWND hScintilla, CodecId id, const CodecOptions& options, ConversionOutput output = ConversionOutput::replace);
+
+// Replace [start, end) with text in one SCI_REPLACETARGET, then select it
+void replaceRange(HWND hScintilla, size_t start, size_t end, const std::string& text);
+
+// Stop the running conversion (if any) and wait for its worker thread
+void cancelConversion();
+
+// Give back to the system, once idle, the buffers the commands leave in the pool of the
+// UI thread (see bufferPool.h): checked every BUFFER_TRIM_PERIOD ms from startBufferTrimming()
+constexpr UINT BUFFER_TRIM_PERIOD = 5000;
+void startBufferTrimming();
+void stopBufferTrimming();
+
+// Ask for a file to convert and for the file to write, then convert with convertFile()
+// (the file is never loaded into Scintilla)
+void convertChosenFile(CodecId id, const CodecOptions& options);
+
+// Open (or save) file dialog; false if the user cancelled it
+bool chooseFile(bool save, const TCHAR *title, TCHAR *path);
+
+// 0 if the file cannot be read
+uint64_t fileSize(const TCHAR *path);
+
+// Stop tracing (see trace.h) and offer to save the recorded spans as Chrome trace events
+void saveConversionTrace();
+
+// Show the percentiles of the conversions run so far (see commandStats.h),
+// then offer to save every sample as CSV
+void showConversionStatistics();
@@ -0,0 +1,116 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <string.h>
+
+#include "conversionJob.h"
+#include "commandStats.h"
+
+ConversionJob::ConversionJob(ScintillaCall view, size_t start, size_t end, std::unique_ptr<Codec> codec, bool readOnly)
+	: _view(std::move(view)), _start(start), _end(end), _codec(std::move(codec))
+{
+	_document = _view(SCI_GETDOCPOINTER, 0, 0);
+	_view(SCI_ADDREFDOCUMENT, 0, _document);
+	const char *text = reinterpret_cast<const char *>(_view(SCI_GETRANGEPOINTER, start, end - start));
+	_input.assign(text, end - start);
+
+	if (readOnly)
+	{
+		_wasReadOnly = _view(SCI_GETREADONLY, 0, 0) != 0;
+		_view(SCI_SETREADONLY, 1, 0);
+		_readOnlySet = true;
+	}
+}
+
+ConversionJob::~ConversionJob()
+{
+	cancel();
+	join();
+	restoreReadOnly();
+	_view(SCI_RELEASEDOCUMENT, 0, _document);
+}
+
+void ConversionJob::restoreReadOnly()
+{
+	if (!_readOnlySet)
+		return;
+	_readOnlySet = false;
+	if (_view(SCI_GETDOCPOINTER, 0, 0) == _document)
+		_view(SCI_SETREADONLY, _wasReadOnly, 0);
+}
+
+void ConversionJob::start(std::function<void()> finished)
+{
+	_finished = std::move(finished);
+	_worker = std::thread(&ConversionJob::run, this);
+}
+
+void ConversionJob::join()
+{
+	if (_worker.joinable())
+		_worker.join();
+}
+
+double ConversionJob::progress() const
+{
+	return _input.empty() ? 1 : double(_converted) / double(_input.length());
+}
+
+void ConversionJob::run()
+{
+	CancellationScope scope(_cancel);
+	StopWatch watch;
+	bool ok = true;
+	size_t length = _input.length();
+	for (size_t pos = 0; ok && pos < length && !isCancelled(); pos += CONVERSION_PIECE_SIZE)
+	{
+		size_t pieceLength = length - pos < CONVERSION_PIECE_SIZE ? length - pos : CONVERSION_PIECE_SIZE;
+		ok = _codec->process(_input.data() + pos, pieceLength, _output);
+		_converted = pos + pieceLength;
+	}
+	if (ok && !isCancelled())
+		ok = _codec->finish(_output);
+
+	_ok = ok;
+	_codecNs = watch.lapNs("codec");
+	if (_finished)
+		_finished();
+}
+
+bool ConversionJob::isTargetUnchanged() const
+{
+	if (_view(SCI_GETDOCPOINTER, 0, 0) != _document)
+		return false;
+
+	size_t docLength = _view(SCI_GETLENGTH, 0, 0);
+	if (docLength < _end)
+		return false;
+
+	const char *current = reinterpret_cast<const char *>(_view(SCI_GETRANGEPOINTER, _start, _end - _start));
+	return current && memcmp(current, _input.data(), _input.length()) == 0;
+}
+
+bool ConversionJob::apply()
+{
+	if (!isTargetUnchanged())
+		return false;
+
+	restoreReadOnly();
+	_view(SCI_SETTARGETRANGE, _start, _end);
+	_view(SCI_REPLACETARGET, _output.length(), reinterpret_cast<sptr_t>(_output.data()));
+	_view(SCI_SETSEL, _start, _start + _output.length());
+	return true;
+}
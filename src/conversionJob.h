@@ -0,0 +1,105 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "codec.h"
+#include "parallel.h"
+#include "Scintilla.h"
+
+// The worker hands the input to the codec in pieces of this size,
+// progress and cancellation are checked in between
+constexpr size_t CONVERSION_PIECE_SIZE = 1 << 20;
+
+// Sends a message to a Scintilla view: SendMessage to its window in the plugin,
+// a document in memory in the tests
+typedef std::function<sptr_t(unsigned int message, uptr_t wParam, sptr_t lParam)> ScintillaCall;
+
+// A conversion of [start, end) of the document of a view, run on a worker thread against
+// a copy of the text, then applied back on the UI thread:
+//
+//	ConversionJob job(view, start, end, createCodec(id, options));
+//	job.start(finished);      // finished() is called on the worker once it is done
+//	job.progress();           // meanwhile, for a progress bar
+//	job.cancel();             // stops the worker between pieces, and the parallel paths of the codec
+//	job.join();
+//	job.apply();              // false if the document changed in the meantime
+//
+// The document is referenced (SCI_ADDREFDOCUMENT) while the job lives, so that it cannot be
+// freed and another one be given its address: SCI_GETDOCPOINTER then tells whether the view
+// still shows it.
+// With readOnly, the document is also made read-only until apply() or the destruction of the
+// job, which give it back its state if the view still shows it. Notepad++ sets that state
+// again when the tab is left and shown again: isTargetUnchanged() still catches the edits.
+class ConversionJob {
+public:
+	ConversionJob(ScintillaCall view, size_t start, size_t end, std::unique_ptr<Codec> codec, bool readOnly = false);
+	~ConversionJob();
+
+	ConversionJob(const ConversionJob&) = delete;
+	ConversionJob& operator=(const ConversionJob&) = delete;
+
+	void start(std::function<void()> finished);
+	void cancel() { _cancel.cancel(); };
+	bool isCancelled() const { return _cancel.isCancelled(); };
+	void join();
+
+	// Part of the input converted so far, from 0 to 1
+	double progress() const;
+
+	// Once joined
+	bool ok() const { return _ok; };
+	const char *errorMessage() const { return _codec->errorMessage(); };
+	const std::string& input() const { return _input; };
+	const std::string& output() const { return _output; };
+	uint64_t codecNs() const { return _codecNs; };
+
+	// The view still shows the same document, holding the converted text at the same place
+	bool isTargetUnchanged() const;
+
+	// Replace the converted text by the output in one SCI_REPLACETARGET, then select it;
+	// false, the document being left alone, if the target changed
+	bool apply();
+
+private:
+	void run();
+	void restoreReadOnly();
+
+	ScintillaCall _view;
+	sptr_t _document = 0;
+	size_t _start = 0;
+	size_t _end = 0;
+	std::string _input;
+	std::unique_ptr<Codec> _codec;
+	bool _readOnlySet = false;
+	bool _wasReadOnly = false;
+
+	std::string _output;
+	bool _ok = false;
+	uint64_t _codecNs = 0;
+	std::atomic<size_t> _converted{0};
+	CancellationToken _cancel;
+	std::function<void()> _finished;
+	std::thread _worker;
+};
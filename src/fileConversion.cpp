@@ -0,0 +1,214 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <string>
+
+#include "fileConversion.h"
+#include "trace.h"
+
+// Each view is handed to the codec in pieces of this size, which bounds the output held in memory
+constexpr size_t FILE_CONVERSION_PIECE_SIZE = 1 << 20;
+
+static FILE *openDestination(const PathChar *path)
+{
+#ifdef _WIN32
+	return _wfopen(path, L"wb");
+#else
+	return fopen(path, "wb");
+#endif
+}
+
+static void removeDestination(const PathChar *path)
+{
+#ifdef _WIN32
+	_wremove(path);
+#else
+	remove(path);
+#endif
+}
+
+static bool samePath(const PathChar *path1, const PathChar *path2)
+{
+#ifdef _WIN32
+	return _wcsicmp(path1, path2) == 0;
+#else
+	return strcmp(path1, path2) == 0;
+#endif
+}
+
+bool convertFile(CodecId id, const PathChar *source, const PathChar *destination, const CodecOptions& options, const char **errorMessage)
+{
+	const char *message = "";
+	if (!errorMessage)
+		errorMessage = &message;
+
+	if (samePath(source, destination))
+	{
+		*errorMessage = "The destination file must not be the source file.";
+		return false;
+	}
+
+	MappedFile sourceFile;
+	if (!sourceFile.open(source))
+	{
+		*errorMessage = "Cannot open the source file.";
+		return false;
+	}
+
+	FILE *destinationFile = openDestination(destination);
+	if (!destinationFile)
+	{
+		*errorMessage = "Cannot create the destination file.";
+		return false;
+	}
+
+	std::unique_ptr<Codec> codec = createCodec(id, options);
+	std::unique_ptr<FileSink> sink(new FileSink(destinationFile));
+	bool ok = true;
+
+	uint64_t size = sourceFile.size();
+	for (uint64_t offset = 0; ok && offset < size; offset += MAPPED_VIEW_SIZE)
+	{
+		size_t viewLength = size - offset < MAPPED_VIEW_SIZE ? size_t(size - offset) : MAPPED_VIEW_SIZE;
+		const char *view;
+		{
+			TRACE_SPAN_BYTES("map view", viewLength);
+			view = sourceFile.view(offset, viewLength);
+		}
+		if (!view)
+		{
+			*errorMessage = "Cannot read the source file.";
+			ok = false;
+			break;
+		}
+
+		for (size_t pos = 0; ok && pos < viewLength; pos += FILE_CONVERSION_PIECE_SIZE)
+		{
+			size_t pieceLength = viewLength - pos < FILE_CONVERSION_PIECE_SIZE ? viewLength - pos : FILE_CONVERSION_PIECE_SIZE;
+			{
+				TRACE_SPAN_BYTES("codec", pieceLength);
+				ok = processTo(*codec, view + pos, pieceLength, *sink);
+			}
+			if (!ok)
+				*errorMessage = codec->errorMessage();
+			else if (!sink->ok())
+			{
+				*errorMessage = "Cannot write the destination file.";
+				ok = false;
+			}
+		}
+	}
+	sourceFile.close();
+
+	if (ok)
+	{
+		ok = finishTo(*codec, *sink);
+		if (!ok)
+			*errorMessage = codec->errorMessage();
+		else if (!sink->flush())
+		{
+			*errorMessage = "Cannot write the destination file.";
+			ok = false;
+		}
+	}
+
+	sink.reset();
+	if (fclose(destinationFile) != 0 && ok)
+	{
+		*errorMessage = "Cannot write the destination file.";
+		ok = false;
+	}
+	if (!ok)
+		removeDestination(destination);
+	return ok;
+}
+
+static size_t countLines(const char *text, size_t length)
+{
+	size_t lines = 0;
+	const char *end = text + length;
+	for (const char *nl; (nl = static_cast<const char *>(memchr(text, '\n', end - text))) != nullptr; text = nl + 1)
+		++lines;
+	return lines;
+}
+
+bool samlDecodeAllFile(const PathChar *source, std::vector<SamlDecoded>& decoded, const char **errorMessage)
+{
+	const char *message = "";
+	if (!errorMessage)
+		errorMessage = &message;
+	decoded.clear();
+
+	MappedFile sourceFile;
+	if (!sourceFile.open(source))
+	{
+		*errorMessage = "Cannot open the source file.";
+		return false;
+	}
+
+	// Each view is scanned in place from its first whole line to its last one; the line
+	// cut by the end of a view is copied and completed with the start of the next view
+	SamlCollector collector;
+	std::string cutLine;
+	size_t line = 0;
+	uint64_t size = sourceFile.size();
+	for (uint64_t offset = 0; offset < size; offset += MAPPED_VIEW_SIZE)
+	{
+		size_t viewLength = size - offset < MAPPED_VIEW_SIZE ? size_t(size - offset) : MAPPED_VIEW_SIZE;
+		const char *view;
+		{
+			TRACE_SPAN_BYTES("map view", viewLength);
+			view = sourceFile.view(offset, viewLength);
+		}
+		if (!view)
+		{
+			*errorMessage = "Cannot read the source file.";
+			return false;
+		}
+
+		const char *firstEnd = static_cast<const char *>(memchr(view, '\n', viewLength));
+		if (!firstEnd)
+		{
+			cutLine.append(view, viewLength);
+			continue;
+		}
+		size_t start = 0;
+		if (!cutLine.empty())
+		{
+			start = firstEnd + 1 - view;
+			cutLine.append(view, start);
+			collector.add(cutLine.data(), cutLine.length(), line);
+			++line;
+			cutLine.clear();
+		}
+
+		size_t end = viewLength;
+		while (end > start && view[end - 1] != '\n')
+			--end;
+		collector.add(view + start, end - start, line);
+		line += countLines(view + start, end - start);
+		cutLine.assign(view + end, viewLength - end);
+	}
+	collector.add(cutLine.data(), cutLine.length(), line);
+	sourceFile.close();
+
+	decoded = collector.decodeAll();
+	return true;
+}
@@ -0,0 +1,36 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <vector>
+
+#include "codec.h"
+#include "mappedFile.h"
+#include "saml.h"
+
+// Convert the file source into the file destination.
+// The source is read through MappedFile views and fed to the streaming codec, the output is
+// written sequentially as it comes: memory use does not depend on the file size (except for
+// the SAML codecs, which need the whole message).
+// On error, errorMessage (if given) receives the reason and the destination file is removed.
+bool convertFile(CodecId id, const PathChar *source, const PathChar *destination, const CodecOptions& options = CodecOptions(), const char **errorMessage = nullptr);
+
+// samlDecodeAll() over the file source, read through MappedFile views: only the distinct
+// payloads and a line cut by the end of a view are held in memory.
+// On error, errorMessage (if given) receives the reason.
+bool samlDecodeAllFile(const PathChar *source, std::vector<SamlDecoded>& decoded, const char **errorMessage = nullptr);
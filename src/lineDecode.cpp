@@ -0,0 +1,89 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "lineDecode.h"
+#include "base64Runs.h"
+#include "codec.h"
+#include "trace.h"
+
+static bool hasPercentEscape(const char *line, size_t length)
+{
+	for (const char *p = line, *end = line + length; (p = static_cast<const char *>(memchr(p, '%', end - p))) != nullptr; ++p)
+	{
+		if (end - p >= 3 && isxdigit(static_cast<unsigned char>(p[1])) && isxdigit(static_cast<unsigned char>(p[2])))
+			return true;
+	}
+	return false;
+}
+
+// Annotations are lines of text: CR are dropped and the length is capped
+static void appendAnnotationText(const std::string& text, std::string& annotation)
+{
+	size_t length = std::min(text.length(), LINE_DECODE_ANNOTATION_MAX);
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (text[i] != '\r')
+			annotation += text[i];
+	}
+	if (text.length() > length)
+		annotation += "...";
+}
+
+std::string decodeLinePayloads(const char *line, size_t length)
+{
+	TRACE_SPAN_BYTES("decode line", length);
+
+	std::string annotation;
+	if (length > LINE_DECODE_LENGTH_MAX)
+	{
+		annotation = "(line too long to decode)";
+		return annotation;
+	}
+
+	std::vector<Base64Run> runs = base64DecodeRuns(line, length);
+	for (const Base64Run& run : runs)
+	{
+		if (!annotation.empty())
+			annotation += '\n';
+		if (run.isText)
+			appendAnnotationText(run.decoded, annotation);
+		else
+			annotation += "(" + std::to_string(run.decoded.length()) + " bytes of binary data)";
+	}
+
+	if (runs.empty() && hasPercentEscape(line, length))
+	{
+		std::string decoded;
+		if (convertText(CodecId::urlDecode, line, length, decoded))
+			appendAnnotationText(decoded, annotation);
+	}
+	return annotation;
+}
+
+const std::string& LineDecodeCache::decode(const char *line, size_t length)
+{
+	uint64_t key = contentHash(line, length);
+	const std::string *cached = _cache.find(key);
+	if (cached)
+		return *cached;
+	return _cache.insert(key, decodeLinePayloads(line, length));
+}
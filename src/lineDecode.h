@@ -0,0 +1,54 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "lruCache.h"
+
+// Longer lines are not decoded: their annotation says so
+constexpr size_t LINE_DECODE_LENGTH_MAX = 1 << 20;
+
+// Longer decoded payloads are cut in the annotation
+constexpr size_t LINE_DECODE_ANNOTATION_MAX = 1024;
+
+// Lines whose decoding is kept, a few screens of a large log
+constexpr size_t LINE_DECODE_CACHE_LINES = 4096;
+
+// What a log line carries once decoded, to show as its annotation: each base64 run (see
+// base64Runs.h) decoded, one per annotation line, or else the whole line URL decoded if it
+// holds percent escapes. Empty when there is nothing encoded on the line.
+std::string decodeLinePayloads(const char *line, size_t length);
+
+// decodeLinePayloads() through an LRU cache keyed by the hash of the line content, so
+// that scrolling back over lines already seen decodes nothing
+class LineDecodeCache {
+public:
+	explicit LineDecodeCache(size_t capacity = LINE_DECODE_CACHE_LINES) : _cache(capacity) {};
+
+	const std::string& decode(const char *line, size_t length);
+
+	void clear() { _cache.clear(); };
+	uint64_t hits() const { return _cache.hits(); };
+	uint64_t misses() const { return _cache.misses(); };
+
+private:
+	LruCache<uint64_t, std::string> _cache;
+};
@@ -0,0 +1,98 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// 64 bit FNV-1a of a text, the key of the caches of decoded text
+inline uint64_t contentHash(const char *data, size_t length)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+// At most capacity values; inserting one more drops the least recently used.
+// find() and insert() are O(1). Not thread safe.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+	explicit LruCache(size_t capacity) : _capacity(capacity ? capacity : 1) {};
+
+	// nullptr if key is not cached; the pointer is valid until the next insert() or clear()
+	const Value *find(const Key& key)
+	{
+		auto found = _index.find(key);
+		if (found == _index.end())
+		{
+			++_misses;
+			return nullptr;
+		}
+		++_hits;
+		_entries.splice(_entries.begin(), _entries, found->second);
+		return &found->second->second;
+	};
+
+	const Value& insert(const Key& key, Value value)
+	{
+		auto found = _index.find(key);
+		if (found != _index.end())
+		{
+			found->second->second = std::move(value);
+			_entries.splice(_entries.begin(), _entries, found->second);
+			return found->second->second;
+		}
+
+		if (_entries.size() == _capacity)
+		{
+			_index.erase(_entries.back().first);
+			_entries.pop_back();
+		}
+		_entries.emplace_front(key, std::move(value));
+		_index.emplace(key, _entries.begin());
+		return _entries.front().second;
+	};
+
+	void clear()
+	{
+		_entries.clear();
+		_index.clear();
+	};
+
+	size_t size() const { return _entries.size(); };
+	uint64_t hits() const { return _hits; };
+	uint64_t misses() const { return _misses; };
+
+private:
+	typedef std::list<std::pair<Key, Value>> Entries;
+
+	size_t _capacity;
+	Entries _entries;    // most recently used first
+	std::unordered_map<Key, typename Entries::iterator, Hash> _index;
+	uint64_t _hits = 0;
+	uint64_t _misses = 0;
+};
@@ -0,0 +1,149 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mappedFile.h"
+
+#ifdef _WIN32
+
+bool MappedFile::open(const PathChar *path)
+{
+	close();
+
+	_file = ::CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		_file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(_file, &size))
+	{
+		close();
+		return false;
+	}
+	_size = uint64_t(size.QuadPart);
+
+	// an empty file cannot be mapped, and does not need to be
+	if (_size > 0)
+	{
+		_mapping = ::CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!_mapping)
+		{
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void MappedFile::unmapView()
+{
+	if (_view)
+		::UnmapViewOfFile(_view);
+	_view = nullptr;
+	_viewLength = 0;
+}
+
+void MappedFile::close()
+{
+	unmapView();
+	if (_mapping)
+		::CloseHandle(_mapping);
+	if (_file)
+		::CloseHandle(_file);
+	_mapping = nullptr;
+	_file = nullptr;
+	_size = 0;
+}
+
+const char *MappedFile::view(uint64_t offset, size_t length)
+{
+	unmapView();
+	if (!_mapping || length == 0 || offset + length > _size)
+		return nullptr;
+
+	_view = ::MapViewOfFile(_mapping, FILE_MAP_READ, DWORD(offset >> 32), DWORD(offset & 0xFFFFFFFF), length);
+	if (!_view)
+		return nullptr;
+	_viewLength = length;
+	return static_cast<const char *>(_view);
+}
+
+#else
+
+bool MappedFile::open(const PathChar *path)
+{
+	close();
+
+	_file = ::open(path, O_RDONLY);
+	if (_file < 0)
+		return false;
+
+	struct stat status;
+	if (::fstat(_file, &status) != 0 || !S_ISREG(status.st_mode))
+	{
+		close();
+		return false;
+	}
+	_size = uint64_t(status.st_size);
+	return true;
+}
+
+void MappedFile::unmapView()
+{
+	if (_view)
+		::munmap(_view, _viewLength);
+	_view = nullptr;
+	_viewLength = 0;
+}
+
+void MappedFile::close()
+{
+	unmapView();
+	if (_file >= 0)
+		::close(_file);
+	_file = -1;
+	_size = 0;
+}
+
+const char *MappedFile::view(uint64_t offset, size_t length)
+{
+	unmapView();
+	if (_file < 0 || length == 0 || offset + length > _size)
+		return nullptr;
+
+	void *view = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, _file, off_t(offset));
+	if (view == MAP_FAILED)
+		return nullptr;
+	::madvise(view, length, MADV_SEQUENTIAL);
+
+	_view = view;
+	_viewLength = length;
+	return static_cast<const char *>(_view);
+}
+
+#endif
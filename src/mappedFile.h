@@ -0,0 +1,67 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// File names are UTF-16 on Windows, bytes elsewhere
+#ifdef _WIN32
+typedef wchar_t PathChar;
+#else
+typedef char PathChar;
+#endif
+
+// Size of the views MappedFile maps: a multiple of the allocation granularity of
+// every system (64 KB on Windows), small enough for a 32 bit address space
+constexpr size_t MAPPED_VIEW_SIZE = 64 << 20;
+
+// Read-only memory mapping of a file, one view at a time, so that a file of any size
+// can be read with constant memory (CreateFileMapping/MapViewOfFile on Windows, mmap elsewhere).
+class MappedFile {
+
+public:
+	MappedFile() {};
+	~MappedFile() { close(); };
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const PathChar *path);
+	void close();
+
+	uint64_t size() const { return _size; };
+
+	// Map [offset, offset + length) and return its address, or nullptr on error.
+	// offset must be a multiple of MAPPED_VIEW_SIZE and length at most MAPPED_VIEW_SIZE;
+	// the previous view is unmapped.
+	const char *view(uint64_t offset, size_t length);
+
+private:
+	void unmapView();
+
+#ifdef _WIN32
+	void *_file = nullptr;       // HANDLE
+	void *_mapping = nullptr;    // HANDLE
+#else
+	int _file = -1;
+#endif
+	uint64_t _size = 0;
+	void *_view = nullptr;
+	size_t _viewLength = 0;
+};
@@ -17,21 +17,46 @@
 // Enhance Base64 features, and rewrite Base64 encode/decode implementation
 // Copyright 2019 by Paul Nankervis <paulnank@hotmail.com>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "PluginInterface.h"
+#include "menuCmdID.h"
 #include "mimeTools.h"
-#include "b64.h"
-#include "qp.h"
 #include "url.h"
 #include "saml.h"
+#include "base64Runs.h"
+#include "base64Search.h"
+#include "xmlFormat.h"
+#include "codec.h"
+#include "commandStats.h"
+#include "conversion.h"
+#include "fileConversion.h"
+#include "trace.h"
+#include "viewportDecode.h"
+#include "caretPreview.h"
+#include "pipelineMenu.h"
+#include "parallel.h"
 
 
 const TCHAR PLUGIN_NAME[] = TEXT("MIME Tools");
-const int nbFunc = 22;
+const int nbFunc = 38;
+
+// The saved pipelines follow the fixed commands: a separator, one command each, then the editing command
+const int nbFuncMax = nbFunc + 2 + int(SAVED_PIPELINE_MAX);
+int g_nbFuncItems = nbFunc;
 
 HINSTANCE g_hInst = nullptr;;
 NppData nppData;
-FuncItem funcItem[nbFunc];
+FuncItem funcItem[nbFuncMax];
 HWND g_hAboutDlg = nullptr;
+bool g_formatSamlXml = false;
+bool g_convertIntoNewTab = false;
+bool g_convertFiles = false;
+bool g_traceConversions = false;
+bool g_decodeVisibleLines = false;
+bool g_previewCaretToken = false;
 
 BOOL APIENTRY DllMain(HANDLE hModule, DWORD reasonForCall, LPVOID /*lpReserved*/)
 {
@@ -63,9 +88,27 @@ BOOL APIENTRY DllMain(HANDLE hModule, DWORD reasonForCall, LPVOID /*lpReserved*/
 			
 			funcItem[18]._pFunc = NULL;
 			funcItem[19]._pFunc = convertSamlDecode;
-
-			funcItem[20]._pFunc = NULL;
-			funcItem[21]._pFunc = about;
+			funcItem[20]._pFunc = convertSamlEncode;
+			funcItem[21]._pFunc = convertSamlDecodeAll;
+			funcItem[22]._pFunc = convertSamlDecodeSummary;
+			funcItem[23]._pFunc = gotoSamlSummaryField;
+			funcItem[24]._pFunc = toggleFormatSamlXml;
+
+			funcItem[25]._pFunc = NULL;
+			funcItem[26]._pFunc = convertSmartDecode;
+			funcItem[27]._pFunc = convertBase64Runs;
+			funcItem[28]._pFunc = findInBase64;
+			funcItem[29]._pFunc = toggleDecodeVisibleLines;
+			funcItem[30]._pFunc = togglePreviewCaretToken;
+
+			funcItem[31]._pFunc = NULL;
+			funcItem[32]._pFunc = toggleConvertIntoNewTab;
+			funcItem[33]._pFunc = toggleConvertFiles;
+			funcItem[34]._pFunc = toggleTraceConversions;
+
+			funcItem[35]._pFunc = NULL;
+			funcItem[36]._pFunc = showConversionStatistics;
+			funcItem[37]._pFunc = about;
 
 			lstrcpy(funcItem[0]._itemName, TEXT("Base64 Encode"));
 			lstrcpy(funcItem[1]._itemName, TEXT("Base64 Encode with padding"));
@@ -93,10 +136,30 @@ BOOL APIENTRY DllMain(HANDLE hModule, DWORD reasonForCall, LPVOID /*lpReserved*/
 			lstrcpy(funcItem[18]._itemName, TEXT("-SEPARATOR-"));
 
 			lstrcpy(funcItem[19]._itemName, TEXT("SAML Decode"));
+			lstrcpy(funcItem[20]._itemName, TEXT("SAML Encode"));
+			lstrcpy(funcItem[21]._itemName, TEXT("SAML Decode all parameters into new tab"));
+			lstrcpy(funcItem[22]._itemName, TEXT("SAML Decode and summarize into new tab"));
+			lstrcpy(funcItem[23]._itemName, TEXT("Go to SAML summary field"));
+			lstrcpy(funcItem[24]._itemName, TEXT("Format decoded SAML XML"));
 			
-			lstrcpy(funcItem[20]._itemName, TEXT("-SEPARATOR-"));
+			lstrcpy(funcItem[25]._itemName, TEXT("-SEPARATOR-"));
+
+			lstrcpy(funcItem[26]._itemName, TEXT("Smart Decode (detect the encoding)"));
+			lstrcpy(funcItem[27]._itemName, TEXT("Base64 Decode every run of the document"));
+			lstrcpy(funcItem[28]._itemName, TEXT("Find in base64 (decoded text)..."));
+			lstrcpy(funcItem[29]._itemName, TEXT("Decode visible lines as annotations"));
+			lstrcpy(funcItem[30]._itemName, TEXT("Preview encoded token at caret"));
 
-			lstrcpy(funcItem[21]._itemName, TEXT("About"));
+			lstrcpy(funcItem[31]._itemName, TEXT("-SEPARATOR-"));
+
+			lstrcpy(funcItem[32]._itemName, TEXT("Convert into new tab"));
+			lstrcpy(funcItem[33]._itemName, TEXT("Convert files (choose source and destination)"));
+			lstrcpy(funcItem[34]._itemName, TEXT("Trace conversions (Chrome trace events)"));
+
+			lstrcpy(funcItem[35]._itemName, TEXT("-SEPARATOR-"));
+
+			lstrcpy(funcItem[36]._itemName, TEXT("Performance statistics..."));
+			lstrcpy(funcItem[37]._itemName, TEXT("About"));
 
 			funcItem[0]._init2Check = false;
 			funcItem[1]._init2Check = false;
@@ -151,9 +214,28 @@ BOOL APIENTRY DllMain(HANDLE hModule, DWORD reasonForCall, LPVOID /*lpReserved*/
 	return TRUE;
 }
 
+// Menu commands of the pipelines saved in mimeTools.ini, the config directory being known from now on
+static void addSavedPipelineCommands()
+{
+	loadSavedPipelines();
+
+	int index = nbFunc;
+	funcItem[index]._pFunc = NULL;
+	lstrcpy(funcItem[index++]._itemName, TEXT("-SEPARATOR-"));
+	for (size_t i = 0; i < savedPipelineCount(); ++i, ++index)
+	{
+		funcItem[index]._pFunc = savedPipelineCommand(i);
+		lstrcpyn(funcItem[index]._itemName, savedPipelineName(i), menuItemSize);
+	}
+	funcItem[index]._pFunc = editSavedPipelines;
+	lstrcpy(funcItem[index++]._itemName, TEXT("Edit saved pipelines..."));
+	g_nbFuncItems = index;
+}
+
 extern "C" __declspec(dllexport) void setInfo(NppData notpadPlusData)
 {
 	nppData = notpadPlusData;
+	addSavedPipelineCommands();
 }
 
 extern "C" __declspec(dllexport) const TCHAR * getName()
@@ -163,7 +245,7 @@ extern "C" __declspec(dllexport) const TCHAR * getName()
 
 extern "C" __declspec(dllexport) FuncItem * getFuncsArray(int *nbF)
 {
-	*nbF = nbFunc;
+	*nbF = g_nbFuncItems;
 	return funcItem;
 }
 
@@ -180,6 +262,39 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification* notifyCode)
 			}
 			break;
 		}
+
+		case SCN_UPDATEUI:
+		{
+			HWND hScintilla = (HWND)notifyCode->nmhdr.hwndFrom;
+			if (hScintilla != nppData._scintillaMainHandle && hScintilla != nppData._scintillaSecondHandle)
+				break;
+			if (g_decodeVisibleLines && (notifyCode->updated & (SC_UPDATE_CONTENT | SC_UPDATE_V_SCROLL)))
+				annotateVisibleLines(hScintilla);
+			if (g_previewCaretToken && (notifyCode->updated & (SC_UPDATE_CONTENT | SC_UPDATE_SELECTION)))
+				previewTokenAtCaret(hScintilla);
+			break;
+		}
+
+		case NPPN_BUFFERACTIVATED:
+		{
+			if (g_decodeVisibleLines)
+				annotateVisibleLines(getCurrentScintillaHandle());
+			break;
+		}
+
+		case NPPN_READY:
+		{
+			startBufferTrimming();
+			break;
+		}
+
+		case NPPN_SHUTDOWN:
+		{
+			cancelConversion();
+			shutdownThreadPool();
+			stopBufferTrimming();
+			break;
+		}
 	}
 }
 
@@ -207,106 +322,72 @@ HWND getCurrentScintillaHandle()
 	return (currentEdit == 0)?nppData._scintillaMainHandle:nppData._scintillaSecondHandle;
 };
 
+const char *getEolString(HWND hScintilla)
+{
+	switch (::SendMessage(hScintilla, SCI_GETEOLMODE, 0, 0))
+	{
+		case SC_EOL_CRLF:
+			return "\r\n";
+		case SC_EOL_CR:
+			return "\r";
+		default:
+			return "\n";
+	}
+}
+
 
 
-void convertAsciiToBase64(size_t wrapLength, bool padFlag, bool byLineFlag)
+// Convert the selection of the current view (the document without selection), in place or into a new tab,
+// or a file chosen by the user
+static void convertCurrentSelection(CodecId id, const std::string& pipeline = std::string())
 {
 	HWND hCurrScintilla = getCurrentScintillaHandle();
-	size_t nbSelections = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONS, 0, 0);
-	if (nbSelections > 1) return;
-
-	size_t selectedLength = ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, 0);
-	if (selectedLength == 0) return;
 
-	char *selectedText = new char[selectedLength + 1];
-	::SendMessage(hCurrScintilla, SCI_TARGETFROMSELECTION, 0, 0);
-	::SendMessage(hCurrScintilla, SCI_GETTARGETTEXT, 0, (LPARAM)selectedText);
-
-	size_t bufferLength = (selectedLength + 2) / 3 * 4 + 1;
-	if (wrapLength > 0)
+	CodecOptions options;
+	options.eol = getEolString(hCurrScintilla);
+	options.formatXml = g_formatSamlXml;
+	options.pipeline = pipeline;
+	if (g_convertFiles)
 	{
-		bufferLength += bufferLength / wrapLength;
+		convertChosenFile(id, options);
+		return;
 	}
-	char *encodedText = new char[bufferLength + 1];
-
-	int len = base64Encode(encodedText, selectedText, selectedLength, wrapLength, padFlag, byLineFlag);
-	encodedText[len] = '\0';
-	
-    ::SendMessage(hCurrScintilla, SCI_TARGETFROMSELECTION, 0, 0);
-    ::SendMessage(hCurrScintilla, SCI_REPLACETARGET, len, (LPARAM)encodedText);
-
-	delete[] selectedText;
-	delete[] encodedText;
-
+	convertSelection(hCurrScintilla, id, options, g_convertIntoNewTab ? ConversionOutput::newTab : ConversionOutput::replace);
 }
 
-
 void convertToBase64FromAscii()
 {
-	convertAsciiToBase64(0, false, false);
+	convertCurrentSelection(CodecId::base64Encode);
 }
 
 void convertToBase64FromAscii_pad()
 {
-	convertAsciiToBase64(0, true, false);
+	convertCurrentSelection(CodecId::base64EncodePad);
 }
 
 void convertToBase64FromAscii_B64Format()
 {
-	convertAsciiToBase64(64, true, false);
+	convertCurrentSelection(CodecId::base64EncodeWrap);
 }
 
 void convertToBase64FromAscii_byline()
 {
-	convertAsciiToBase64(0, false, true);
-}
-
-
-void convertBase64ToAscii(bool strictFlag, bool whitespaceReset)
-{
-	HWND hCurrScintilla = getCurrentScintillaHandle();
-	size_t nbSelections = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONS, 0, 0);
-	if (nbSelections > 1) return;
-	size_t selectedLength = ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, 0);
-	if (selectedLength == 0) return;
-
-	char *selectedText = new char[selectedLength + 1];
-	::SendMessage(hCurrScintilla, SCI_TARGETFROMSELECTION, 0, 0);
-	::SendMessage(hCurrScintilla, SCI_GETTARGETTEXT, 0, (LPARAM)selectedText);
-
-	char *decodedText = new char[selectedLength];
-
-	int len = base64Decode(decodedText, selectedText, selectedLength, strictFlag, whitespaceReset);
-
-	if (len < 0)
-	{
-		::MessageBox(nppData._nppHandle, TEXT("Problem!"), TEXT("Base64"), MB_OK);
-	}
-	else
-	{
-		decodedText[len] = '\0';
-		::SendMessage(hCurrScintilla, SCI_TARGETFROMSELECTION, 0, 0);
-        ::SendMessage(hCurrScintilla, SCI_REPLACETARGET, len, (LPARAM)decodedText);
-	}
-
-	delete[] selectedText;
-	delete[] decodedText;
-
+	convertCurrentSelection(CodecId::base64EncodeByLine);
 }
 
 void convertToAsciiFromBase64()
 {
-	convertBase64ToAscii(false, false);
+	convertCurrentSelection(CodecId::base64Decode);
 }
 
 void convertToAsciiFromBase64_strict()
 {
-	convertBase64ToAscii(true, false);
+	convertCurrentSelection(CodecId::base64DecodeStrict);
 }
 
 void convertToAsciiFromBase64_whitespaceReset()
 {
-	convertBase64ToAscii(false, true);
+	convertCurrentSelection(CodecId::base64DecodeByLine);
 }
 
 void convertURLMinEncode()
@@ -341,133 +422,33 @@ void convertURLFullEncodeByLine()
 
 void convertURLEncode (UrlEncodeMethod method, bool isByLine)
 {
-  HWND hCurrScintilla = getCurrentScintillaHandle();
-  size_t nbSelections = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONS, 0, 0);
-  if (nbSelections > 1) return;
-  size_t selBufLen = ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, 0);
-  if (selBufLen == 0) return;
-
-  char * selectedText = new char[selBufLen + 1];
-  ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, (LPARAM)selectedText);
-
-  // this line is added to walk around Scintilla 201 bug
-  size_t destBufLen = strlen(selectedText) * 3 + 1;
-  char* pEncodedText = new char[destBufLen];
-  
-  int len = AsciiToUrl(pEncodedText, selectedText, int(destBufLen), method, isByLine);
-
-  size_t start = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONSTART, 0, 0);
-  size_t end = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONEND, 0, 0);
-  if (end < start)
-  {
-    size_t tmp = start;
-    start = end;
-    end = tmp;
-  }
-  ::SendMessage(hCurrScintilla, SCI_SETTARGETSTART, start, 0);
-  ::SendMessage(hCurrScintilla, SCI_SETTARGETEND, end, 0);
-  ::SendMessage(hCurrScintilla, SCI_REPLACETARGET, len, (LPARAM)pEncodedText);
-  ::SendMessage(hCurrScintilla, SCI_SETSEL, start, start+len);
-
-  delete [] pEncodedText;
-  delete [] selectedText;
+	switch (method)
+	{
+		case UrlEncodeMethod::RFC1738:
+			convertCurrentSelection(isByLine ? CodecId::urlEncodeRFC1738ByLine : CodecId::urlEncodeRFC1738);
+			break;
+		case UrlEncodeMethod::extended:
+			convertCurrentSelection(isByLine ? CodecId::urlEncodeExtendedByLine : CodecId::urlEncodeExtended);
+			break;
+		default:
+			convertCurrentSelection(isByLine ? CodecId::urlEncodeFullByLine : CodecId::urlEncodeFull);
+			break;
+	}
 }
 
 void convertURLDecode()
 {
-  HWND hCurrScintilla = getCurrentScintillaHandle();
-  size_t nbSelections = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONS, 0, 0);
-  if (nbSelections > 1) return;
-  size_t selBufLen = ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, 0);
-  if (selBufLen == 0) return;
-
-  char * selectedText = new char[selBufLen + 1];
-  ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, (LPARAM)selectedText);
-
-  // this line is added to walk around Scintilla 201 bug
-  size_t destBufLen = strlen(selectedText) + 1;
-  char* pDecodedText = new char[destBufLen + 1];
-
-  int len = UrlToAscii(pDecodedText, selectedText, int(destBufLen));
-
-  if (len <= -1)
-    ::MessageBox(nppData._nppHandle, TEXT("Encoding Invalid!"), TEXT("URL Decode"), MB_OK);
-  else
-  {
-    size_t start = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONSTART, 0, 0);
-    size_t end = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONEND, 0, 0);
-    if (end < start)
-    {
-      size_t tmp = start;
-      start = end;
-      end = tmp;
-    }
-    ::SendMessage(hCurrScintilla, SCI_SETTARGETSTART, start, 0);
-    ::SendMessage(hCurrScintilla, SCI_SETTARGETEND, end, 0);
-    ::SendMessage(hCurrScintilla, SCI_REPLACETARGET, len, (LPARAM)pDecodedText);
-    ::SendMessage(hCurrScintilla, SCI_SETSEL, start, start+len);
-  }	
-
-  delete [] pDecodedText;
-  delete [] selectedText;
-}
-
-enum qpOp {qp_encode, qp_decode};
-
-void quotedPrintableConvert(qpOp op)
-{
-	HWND hCurrScintilla = getCurrentScintillaHandle();
-	size_t nbSelections = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONS, 0, 0);
-	if (nbSelections > 1) return;
-    size_t bufLength = ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, 0);
-    if (bufLength == 0) return;
-
-	char * selectedText = new char[bufLength + 1];
-    ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, (LPARAM)selectedText);
-
-	char *qpText;
-	QuotedPrintable qp;
-
-	if (op == qp_decode)
-	{
-		qpText = qp.decode(selectedText);
-		if (!qpText)
-		{
-			::MessageBox(nppData._nppHandle, TEXT("It's not a valid Quoted-printable text"), TEXT("Quoted-printable decode error"), MB_OK);
-			return;
-		}
-	}
-	else
-		qpText = qp.encode(selectedText);
-
-	if (qpText == NULL)
-		::MessageBox(nppData._nppHandle, TEXT("Problem!"), TEXT("Quoted-printable encoding"), MB_OK);
-	else
-	{
-		size_t start = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONSTART, 0, 0);
-		size_t end = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONEND, 0, 0);
-		if (end < start)
-		{
-			size_t tmp = start;
-			start = end;
-			end = tmp;
-		}
-		::SendMessage(hCurrScintilla, SCI_SETTARGETSTART, start, 0);
-		::SendMessage(hCurrScintilla, SCI_SETTARGETEND, end, 0);
-		::SendMessage(hCurrScintilla, SCI_REPLACETARGET, strlen(qpText), (LPARAM)qpText);
-		::SendMessage(hCurrScintilla, SCI_SETSEL, start, start+strlen(qpText));
-	}
-	delete [] selectedText;
+	convertCurrentSelection(CodecId::urlDecode);
 }
 
 void convertToAsciiFromQuotedPrintable()
 {
-	quotedPrintableConvert(qp_decode);
+	convertCurrentSelection(CodecId::qpDecode);
 }
 
 void convertToQuotedPrintable()
 {
-	quotedPrintableConvert(qp_encode);
+	convertCurrentSelection(CodecId::qpEncode);
 }
 
 BOOL CALLBACK aboutDlgProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM /*lParam*/)
@@ -513,6 +494,125 @@ void about()
 }
 
 void convertSamlDecode()
+{
+	convertCurrentSelection(CodecId::samlDecode);
+}
+
+void convertSamlEncode()
+{
+	convertCurrentSelection(CodecId::samlEncode);
+}
+
+void convertSmartDecode()
+{
+	convertCurrentSelection(CodecId::smartDecode);
+}
+
+void convertPipeline(const std::string& stages)
+{
+	convertCurrentSelection(CodecId::pipeline, stages);
+}
+
+// Every SAML parameter of the current document, or of a file chosen by the user in file mode
+// (read through MappedFile views, never loaded into Scintilla), decoded into a new tab
+void convertSamlDecodeAll()
+{
+  CommandSample sample;
+  sample.id = CodecId::samlDecode;
+  sample.route = CommandRoute::samlAll;
+  StopWatch watch;
+  BufferUsage buffers;
+  std::vector<SamlDecoded> decoded;
+
+  if (g_convertFiles)
+  {
+    TCHAR source[MAX_PATH] = {};
+    if (!chooseFile(false, TEXT("File to scan for SAML parameters"), source))
+      return;
+    watch.lapNs();
+
+    HCURSOR hPreviousCursor = ::SetCursor(::LoadCursor(NULL, IDC_WAIT));
+    const char *errorMessage = "";
+    bool ok = samlDecodeAllFile(source, decoded, &errorMessage);
+    ::SetCursor(hPreviousCursor);
+
+    // the whole file scan is counted as codec time
+    sample.codecNs = watch.lapNs("codec");
+    sample.inputBytes = fileSize(source);
+    if (!ok)
+    {
+      buffers.addTo(sample);
+      recordCommand(sample);
+      ::MessageBoxA(nppData._nppHandle, errorMessage, "SAML Decode", MB_OK);
+      return;
+    }
+  }
+  else
+  {
+    HWND hCurrScintilla = getCurrentScintillaHandle();
+    size_t docLength = ::SendMessage(hCurrScintilla, SCI_GETLENGTH, 0, 0);
+    if (docLength == 0) return;
+    sample.inputBytes = docLength;
+
+    // the document is scanned in place: nothing modifies it until decoding is over
+    const char *docText = (const char *)::SendMessage(hCurrScintilla, SCI_GETCHARACTERPOINTER, 0, 0);
+    sample.fetchNs = watch.lapNs("fetch");
+
+    decoded = samlDecodeAll(docText, docLength);
+    sample.codecNs = watch.lapNs("codec");
+  }
+
+  if (decoded.empty())
+  {
+    buffers.addTo(sample);
+    recordCommand(sample);
+    ::MessageBox(nppData._nppHandle, TEXT("No SAMLRequest or SAMLResponse parameter found."), TEXT("SAML Decode"), MB_OK);
+    return;
+  }
+
+  ::SendMessage(nppData._nppHandle, NPPM_MENUCOMMAND, 0, IDM_FILE_NEW);
+  HWND hNewScintilla = getCurrentScintillaHandle();
+
+  const char *eol = getEolString(hNewScintilla);
+
+  std::string report;
+  for (const SamlDecoded& payload : decoded)
+  {
+    report += payload.lines.size() > 1 ? "Lines " : "Line ";
+    for (size_t i = 0; i < payload.lines.size(); ++i)
+    {
+      if (i > 0)
+        report += ", ";
+      report += std::to_string(payload.lines[i] + 1);
+    }
+    report += payload.isResponse ? " (SAMLResponse) -> " : " (SAMLRequest) -> ";
+    if (payload.result <= 0)
+      report += samlDecodeErrorMessage(payload.result);
+    else if (g_formatSamlXml)
+    {
+      report += eol;
+      report += XmlFormatter::formatString(payload.xml.c_str(), payload.xml.length(), eol);
+    }
+    else
+      report += payload.xml;
+    report += eol;
+  }
+  sample.codecNs += watch.lapNs("codec");
+
+  ::SendMessage(hNewScintilla, SCI_APPENDTEXT, report.length(), (LPARAM)report.c_str());
+
+  sample.replaceNs = watch.lapNs("replace");
+  sample.ok = true;
+  sample.outputBytes = report.length();
+  sample.outputCapacity = report.capacity();
+  buffers.addTo(sample);
+  recordCommand(sample);
+}
+
+static const char samlSummaryHeader[] = "---- SAML summary (offsets are positions in this document) ----";
+static const char samlSummaryOffsetPrefix[] = " @";
+
+void convertSamlDecodeSummary()
 {
   HWND hCurrScintilla = getCurrentScintillaHandle();
   size_t nbSelections = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONS, 0, 0);
@@ -520,45 +620,331 @@ void convertSamlDecode()
   size_t bufLength = ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, 0);
   if (bufLength == 0) return;
 
-  char *selectedText = new char[bufLength + 1];
-  char *samlDecodedText = new char[SAML_MESSAGE_MAX_SIZE];
-  ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, (LPARAM)selectedText);
+  CommandSample sample;
+  sample.id = CodecId::samlDecode;
+  sample.route = CommandRoute::samlSummary;
+  StopWatch watch;
+  BufferUsage buffers;
+
+  PooledString selectedText(bufLength + 1);
+  selectedText->resize(bufLength + 1);
+  ::SendMessage(hCurrScintilla, SCI_GETSELTEXT, 0, (LPARAM)&(*selectedText)[0]);
 
   // this line is added to walk around Scintilla 201 bug
-  bufLength = strlen(selectedText) + 1;
+  bufLength = strlen(selectedText->c_str());
+  sample.inputBytes = bufLength;
+  sample.fetchNs = watch.lapNs("fetch");
+
+  std::string xml;
+  int len = samlDecode(xml, selectedText->c_str(), bufLength);
+  sample.codecNs = watch.lapNs("codec");
+
+  if (len <= 0)
+  {
+    buffers.addTo(sample);
+    recordCommand(sample);
+    ::MessageBoxA(nppData._nppHandle, samlDecodeErrorMessage(len), "SAML Decode", MB_OK);
+    return;
+  }
+
+  ::SendMessage(nppData._nppHandle, NPPM_MENUCOMMAND, 0, IDM_FILE_NEW);
+  HWND hNewScintilla = getCurrentScintillaHandle();
+  const char *eol = getEolString(hNewScintilla);
+
+  sample.replaceNs = watch.lapNs("replace");
+
+  if (g_formatSamlXml)
+    xml = XmlFormatter::formatString(xml.c_str(), xml.length(), eol);
+
+  // The XML comes first in the new document, so that field offsets are document positions
+  std::vector<SamlField> fields = samlIndexFields(xml.c_str(), xml.length());
+  bool hasSignature = false;
+  bool hasCertificate = false;
+
+  std::string summary = eol;
+  summary += eol;
+  summary += samlSummaryHeader;
+  summary += eol;
+  for (const SamlField& field : fields)
+  {
+    hasSignature |= strcmp(field.name, "Signature") == 0;
+    hasCertificate |= strcmp(field.name, "X509Certificate") == 0;
+
+    summary += field.name;
+    summary += samlSummaryOffsetPrefix;
+    summary += std::to_string(field.offset);
+    if (!field.value.empty())
+    {
+      summary += ": ";
+      summary += field.value;
+    }
+    summary += eol;
+  }
+  if (!hasSignature)
+    summary += std::string("Signature: none") + eol;
+  if (!hasCertificate)
+    summary += std::string("X509Certificate: none") + eol;
+  sample.codecNs += watch.lapNs("codec");
+
+  ::SendMessage(hNewScintilla, SCI_APPENDTEXT, xml.length(), (LPARAM)xml.c_str());
+  ::SendMessage(hNewScintilla, SCI_APPENDTEXT, summary.length(), (LPARAM)summary.c_str());
+  ::SendMessage(hNewScintilla, SCI_GOTOPOS, xml.length() + strlen(eol) * 2, 0);
+
+  sample.replaceNs += watch.lapNs("replace");
+  sample.ok = true;
+  sample.outputBytes = xml.length() + summary.length();
+  sample.outputCapacity = xml.capacity() + summary.capacity();
+  buffers.addTo(sample);
+  recordCommand(sample);
+}
+
+// Moves the caret to the offset written on the current summary line ("Issuer @123: ...")
+void gotoSamlSummaryField()
+{
+  HWND hCurrScintilla = getCurrentScintillaHandle();
+  size_t caret = ::SendMessage(hCurrScintilla, SCI_GETCURRENTPOS, 0, 0);
+  size_t line = ::SendMessage(hCurrScintilla, SCI_LINEFROMPOSITION, caret, 0);
+  size_t lineLength = ::SendMessage(hCurrScintilla, SCI_LINELENGTH, line, 0);
 
+  std::string lineText(lineLength + 1, '\0');
+  ::SendMessage(hCurrScintilla, SCI_GETLINE, line, (LPARAM)&lineText[0]);
 
-  int len = samlDecode(samlDecodedText, selectedText, int(bufLength));
-  
-  switch (len) 
+  size_t at = lineText.find(samlSummaryOffsetPrefix);
+  if (at == std::string::npos || !isdigit((unsigned char)lineText[at + 2]))
   {
-    case 0:
-	  ::MessageBox(nppData._nppHandle, TEXT("SAML Decode returned zero size."), TEXT("SAML Decode"), MB_OK);
-	  break;
-    case SAML_DECODE_ERROR_URLDECODE:
-	  ::MessageBox(nppData._nppHandle, TEXT("Could not URL Decode text."), TEXT("SAML Decode"), MB_OK);
-	  break;
-	case SAML_DECODE_ERROR_BASE64DECODE:
-	  ::MessageBox(nppData._nppHandle, TEXT("Could not BASE64 Decode text after URL Decoding."), TEXT("SAML Decode"), MB_OK);
-	  break;
-	case SAML_DECODE_ERROR_INFLATE:
-	  ::MessageBox(nppData._nppHandle, TEXT("Could not inflate text after BASE64 Decoding."), TEXT("SAML Decode"), MB_OK);
-	  break;
-	default:
-      size_t start = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONSTART, 0, 0);
-      size_t end = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONEND, 0, 0);
-      if (end < start)
-      {
-        size_t tmp = start;
-        start = end;
-        end = tmp;
-      }
-      ::SendMessage(hCurrScintilla, SCI_SETTARGETSTART, start, 0);
-      ::SendMessage(hCurrScintilla, SCI_SETTARGETEND, end, 0);
-      ::SendMessage(hCurrScintilla, SCI_REPLACETARGET, len, (LPARAM)samlDecodedText);
-      ::SendMessage(hCurrScintilla, SCI_SETSEL, start, start+len);
+    ::MessageBox(nppData._nppHandle, TEXT("The current line is not a SAML summary field."), TEXT("SAML Decode"), MB_OK);
+    return;
   }
-  
-  delete [] selectedText;
-  delete [] samlDecodedText;
-}
\ No newline at end of file
+
+  size_t offset = strtoul(lineText.c_str() + at + 2, nullptr, 10);
+  ::SendMessage(hCurrScintilla, SCI_GOTOPOS, offset, 0);
+}
+
+// Longer decoded runs are cut in the annotations, the new tab gets them whole
+constexpr size_t BASE64_RUN_ANNOTATION_MAX = 1024;
+
+static void appendDecodedRun(const Base64Run& run, size_t maxLength, std::string& out)
+{
+	if (!run.isText)
+	{
+		out += "(" + std::to_string(run.decoded.length()) + " bytes of binary data)";
+		return;
+	}
+	out.append(run.decoded, 0, maxLength);
+	if (run.decoded.length() > maxLength)
+		out += "...";
+}
+
+// Decode every base64 run of the document: below its line as an annotation, or
+// into a new tab when "Convert into new tab" is checked
+void convertBase64Runs()
+{
+	HWND hCurrScintilla = getCurrentScintillaHandle();
+	size_t docLength = ::SendMessage(hCurrScintilla, SCI_GETLENGTH, 0, 0);
+	if (docLength == 0) return;
+
+	CommandSample sample;
+	sample.id = CodecId::base64DecodeStrict;
+	sample.route = CommandRoute::base64Runs;
+	sample.inputBytes = docLength;
+	StopWatch watch;
+	BufferUsage buffers;
+
+	// the document is scanned in place: nothing modifies it until decoding is over
+	const char *docText = (const char *)::SendMessage(hCurrScintilla, SCI_GETCHARACTERPOINTER, 0, 0);
+	sample.fetchNs = watch.lapNs("fetch");
+
+	std::vector<Base64Run> runs = base64DecodeRuns(docText, docLength);
+	sample.codecNs = watch.lapNs("codec");
+
+	// "Decode visible lines" would replace these annotations as the view scrolls: it is
+	// turned off, and its annotations removed
+	if (!g_convertIntoNewTab)
+	{
+		if (g_decodeVisibleLines)
+			toggleDecodeVisibleLines();
+		::SendMessage(hCurrScintilla, SCI_ANNOTATIONCLEARALL, 0, 0);
+	}
+	if (runs.empty())
+	{
+		buffers.addTo(sample);
+		recordCommand(sample);
+		::MessageBox(nppData._nppHandle, TEXT("No base64 text found."), TEXT("Base64 Decode"), MB_OK);
+		return;
+	}
+
+	std::string report;
+	if (g_convertIntoNewTab)
+	{
+		::SendMessage(nppData._nppHandle, NPPM_MENUCOMMAND, 0, IDM_FILE_NEW);
+		HWND hNewScintilla = getCurrentScintillaHandle();
+		const char *eol = getEolString(hNewScintilla);
+
+		for (const Base64Run& run : runs)
+		{
+			report += "Line " + std::to_string(run.line + 1) + " -> ";
+			appendDecodedRun(run, run.decoded.length(), report);
+			report += eol;
+		}
+		sample.codecNs += watch.lapNs("codec");
+
+		::SendMessage(hNewScintilla, SCI_APPENDTEXT, report.length(), (LPARAM)report.c_str());
+		sample.outputBytes = report.length();
+	}
+	else
+	{
+		// the runs of a line share its annotation, one annotation line each
+		for (size_t i = 0; i < runs.size(); )
+		{
+			size_t line = runs[i].line;
+			report.clear();
+			for (; i < runs.size() && runs[i].line == line; ++i)
+			{
+				if (!report.empty())
+					report += '\n';
+				appendDecodedRun(runs[i], BASE64_RUN_ANNOTATION_MAX, report);
+			}
+			report.erase(std::remove(report.begin(), report.end(), '\r'), report.end());
+			::SendMessage(hCurrScintilla, SCI_ANNOTATIONSETTEXT, line, (LPARAM)report.c_str());
+			sample.outputBytes += report.length();
+		}
+		::SendMessage(hCurrScintilla, SCI_ANNOTATIONSETVISIBLE, ANNOTATION_BOXED, 0);
+	}
+
+	sample.replaceNs = watch.lapNs("replace");
+	sample.ok = true;
+	sample.outputCapacity = report.capacity();
+	buffers.addTo(sample);
+	recordCommand(sample);
+}
+
+// Last text searched by findInBase64(), UTF-8 as the documents
+static std::string g_base64SearchText;
+
+static INT_PTR CALLBACK base64SearchDlgProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM /*lParam*/)
+{
+	switch (message)
+	{
+		case WM_INITDIALOG:
+		{
+			::SetDlgItemTextA(hwnd, IDC_SEARCH_TEXT, g_base64SearchText.c_str());
+			::SendDlgItemMessage(hwnd, IDC_SEARCH_TEXT, EM_SETSEL, 0, -1);
+			::SendMessage(nppData._nppHandle, NPPM_DARKMODESUBCLASSANDTHEME, static_cast<WPARAM>(NppDarkMode::dmfInit), reinterpret_cast<LPARAM>(hwnd));
+			return TRUE;
+		}
+
+		case WM_COMMAND:
+		{
+			switch (LOWORD(wParam))
+			{
+				case IDOK:
+				{
+					wchar_t text[1024];
+					::GetDlgItemTextW(hwnd, IDC_SEARCH_TEXT, text, _countof(text));
+					int length = ::WideCharToMultiByte(CP_UTF8, 0, text, -1, nullptr, 0, nullptr, nullptr);
+					g_base64SearchText.assign(length > 0 ? length - 1 : 0, '\0');
+					if (length > 1)
+						::WideCharToMultiByte(CP_UTF8, 0, text, -1, &g_base64SearchText[0], length, nullptr, nullptr);
+					::EndDialog(hwnd, IDOK);
+					return TRUE;
+				}
+				case IDCANCEL:
+					::EndDialog(hwnd, IDCANCEL);
+					return TRUE;
+			}
+			return FALSE;
+		}
+	}
+	return FALSE;
+}
+
+// Ask for a text, then select the next place where the base64 text of the document holds it
+// (the base64 characters encoding it), from the caret and wrapping around
+void findInBase64()
+{
+	if (::DialogBoxParam(g_hInst, MAKEINTRESOURCE(IDD_BASE64_SEARCH), nppData._nppHandle, base64SearchDlgProc, 0) != IDOK)
+		return;
+
+	Base64Search search(g_base64SearchText);
+	if (!search.isValid())
+	{
+		::MessageBox(nppData._nppHandle, TEXT("Type at least 2 characters to find."), TEXT("Find in base64"), MB_OK);
+		return;
+	}
+
+	HWND hCurrScintilla = getCurrentScintillaHandle();
+	size_t docLength = ::SendMessage(hCurrScintilla, SCI_GETLENGTH, 0, 0);
+	const char *docText = (const char *)::SendMessage(hCurrScintilla, SCI_GETCHARACTERPOINTER, 0, 0);
+
+	// past the start of the current selection, which is the previous match when searching again
+	size_t selectionStart = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONSTART, 0, 0);
+	size_t selectionEnd = ::SendMessage(hCurrScintilla, SCI_GETSELECTIONEND, 0, 0);
+	size_t from = selectionEnd > selectionStart ? selectionStart + 1 : selectionStart;
+
+	Base64Match match;
+	if (search.findNext(docText, docLength, from, match) || (from > 0 && search.findNext(docText, docLength, 0, match)))
+	{
+		::SendMessage(hCurrScintilla, SCI_SETSEL, match.start, match.end);
+		::SendMessage(hCurrScintilla, SCI_SCROLLCARET, 0, 0);
+	}
+	else
+		::MessageBox(nppData._nppHandle, TEXT("The text was not found in base64 text."), TEXT("Find in base64"), MB_OK);
+}
+
+void toggleFormatSamlXml()
+{
+  g_formatSamlXml = !g_formatSamlXml;
+  ::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[24]._cmdID, g_formatSamlXml);
+}
+
+// Checked: the visible lines are decoded as annotations while scrolling, replacing those of
+// "Base64 Decode every run of the document"; unchecked: removed
+void toggleDecodeVisibleLines()
+{
+  g_decodeVisibleLines = !g_decodeVisibleLines;
+  ::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[29]._cmdID, g_decodeVisibleLines);
+  if (g_decodeVisibleLines)
+    annotateVisibleLines(getCurrentScintillaHandle());
+  else
+  {
+    clearVisibleLineAnnotations(nppData._scintillaMainHandle);
+    clearVisibleLineAnnotations(nppData._scintillaSecondHandle);
+  }
+}
+
+// Checked: the token at the caret is decoded in a calltip as the caret moves; unchecked: removed
+void togglePreviewCaretToken()
+{
+  g_previewCaretToken = !g_previewCaretToken;
+  ::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[30]._cmdID, g_previewCaretToken);
+  if (g_previewCaretToken)
+    previewTokenAtCaret(getCurrentScintillaHandle());
+  else
+  {
+    clearTokenPreview(nppData._scintillaMainHandle);
+    clearTokenPreview(nppData._scintillaSecondHandle);
+  }
+}
+
+void toggleConvertIntoNewTab()
+{
+  g_convertIntoNewTab = !g_convertIntoNewTab;
+  ::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[32]._cmdID, g_convertIntoNewTab);
+}
+
+void toggleConvertFiles()
+{
+  g_convertFiles = !g_convertFiles;
+  ::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[33]._cmdID, g_convertFiles);
+}
+
+// Checked: the conversions record trace spans; unchecked again: the trace is offered for saving
+void toggleTraceConversions()
+{
+  g_traceConversions = !g_traceConversions;
+  ::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[34]._cmdID, g_traceConversions);
+  if (g_traceConversions)
+    startTrace();
+  else
+    saveConversionTrace();
+}
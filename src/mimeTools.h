@@ -24,13 +24,24 @@
 #define VERSION_DIGITALVALUE 3, 1, 0, 0
 
 #define IDD_ABOUTBOX 250
+#define IDD_PROGRESS 251
+#define IDD_BASE64_SEARCH 252
+
+#define IDC_PROGRESS_TEXT 1001
+#define IDC_PROGRESS_BAR 1002
+#define IDC_SEARCH_TEXT 1003
 
 #ifndef IDC_STATIC 
 #define IDC_STATIC -1
 #endif
 
+#include <string>
+
 #include "url.h"
 
+HWND getCurrentScintillaHandle();
+const char *getEolString(HWND hScintilla);
+
 void convertToBase64FromAscii();
 void convertToBase64FromAscii_pad();
 void convertToBase64FromAscii_B64Format();
@@ -49,6 +60,20 @@ void convertURLFullEncodeByLine();
 void convertURLEncode(UrlEncodeMethod method, bool isByLine = false);
 void convertURLDecode();
 void convertSamlDecode();
+void convertSamlEncode();
+void convertSmartDecode();
+void convertPipeline(const std::string& stages);
+void convertBase64Runs();
+void findInBase64();
+void convertSamlDecodeAll();
+void convertSamlDecodeSummary();
+void gotoSamlSummaryField();
+void toggleDecodeVisibleLines();
+void togglePreviewCaretToken();
+void toggleFormatSamlXml();
+void toggleConvertIntoNewTab();
+void toggleConvertFiles();
+void toggleTraceConversions();
 void convertURLDecode();
 void about();
 
@@ -0,0 +1,363 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// mimetools-cli: the conversions of the plugin as a filter, from stdin to stdout
+//
+//	mimetools-cli base64-decode < dump.b64 > dump.bin
+//	mimetools-cli --format-xml --eol crlf saml-decode < request.txt
+//	mimetools-cli --count base64-encode-wrap < dump.bin
+//	mimetools-cli --pipeline "base64url-decode | gunzip" < token.txt
+//	mimetools-cli --base64-runs --min-length 64 < service.log
+//	mimetools-cli --find-base64 password < message.eml
+//
+// With MIMETOOLS_TRACE_FILE set, the stages of the conversion are written there as
+// Chrome trace events (see trace.h).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "codec.h"
+#include "base64Runs.h"
+#include "base64Search.h"
+#include "pipeline.h"
+#include "trace.h"
+
+// stdin is read in blocks of this size, whatever its length
+constexpr size_t CLI_BUFFER_SIZE = 1 << 20;
+
+static void usage(FILE *out)
+{
+	fprintf(out,
+		"usage: mimetools-cli [--format-xml] [--eol lf|crlf|cr] [--count] <conversion>\n"
+		"       mimetools-cli [--count] --pipeline \"stage | stage...\"\n"
+		"       mimetools-cli --base64-runs [--min-length n]\n"
+		"       mimetools-cli --find-base64 text\n"
+		"       mimetools-cli --list\n"
+		"       mimetools-cli --list-stages\n"
+		"\n"
+		"Converts stdin to stdout.\n"
+		"  --format-xml   pretty-print the XML decoded by saml-decode\n"
+		"  --eol          end of line of the formatted XML (default lf)\n"
+		"  --count        print the length in bytes of the output instead of the output\n"
+		"  --pipeline     chain the stages, each one converting the output of the previous one\n"
+		"  --base64-runs  decode every base64 run of stdin instead, one \"line: text\" each\n"
+		"  --min-length   shortest run taken for base64 (default 32)\n"
+		"  --find-base64  print where the base64 text of stdin holds text once decoded,\n"
+		"                 one \"start end\" line of byte offsets each\n"
+		"  --list         list the conversions\n"
+		"  --list-stages  list the stages of a pipeline\n"
+		"\n"
+		"MIMETOOLS_TRACE_FILE=trace.json writes the conversion stages as Chrome trace events.\n");
+}
+
+static void listCodecs()
+{
+	for (size_t i = 0; i < codecCount(); ++i)
+		printf("%s\n", codecInfo(static_cast<CodecId>(i))->name);
+}
+
+static void listStages()
+{
+	for (size_t i = 0; i < pipelineStageCount(); ++i)
+		printf("%s\n", pipelineStageName(i));
+}
+
+static bool writeOutput(const std::string& output)
+{
+	TRACE_SPAN_BYTES("write", output.length());
+	return output.empty() || fwrite(output.data(), 1, output.length(), stdout) == output.length();
+}
+
+static bool writeTrace(const char *path)
+{
+	std::string json = traceJson();
+	FILE *file = fopen(path, "wb");
+	if (!file)
+		return false;
+	bool ok = fwrite(json.data(), 1, json.length(), file) == json.length();
+	return fclose(file) == 0 && ok;
+}
+
+// Convert stdin into sink, block by block; false on a read, conversion or write error
+template <typename Sink>
+static bool streamInput(const CodecInfo *info, Codec& codec, Sink& sink)
+{
+	std::vector<char> buffer(CLI_BUFFER_SIZE);
+	bool ok = true;
+	size_t length;
+	while (ok)
+	{
+		{
+			TRACE_SPAN("read");
+			length = fread(buffer.data(), 1, buffer.size(), stdin);
+		}
+		if (length == 0)
+			break;
+
+		TRACE_SPAN_BYTES(info->name, length);
+		ok = processTo(codec, buffer.data(), length, sink);
+	}
+	if (ok && ferror(stdin))
+	{
+		fprintf(stderr, "mimetools-cli: cannot read the input\n");
+		return false;
+	}
+	if (ok)
+	{
+		TRACE_SPAN(info->name);
+		ok = finishTo(codec, sink);
+	}
+	if (ok)
+	{
+		TRACE_SPAN("write");
+		ok = sink.flush();
+	}
+
+	if (!ok)
+	{
+		if (*codec.errorMessage())
+			fprintf(stderr, "mimetools-cli: %s: %s\n", info->title, codec.errorMessage());
+		else
+			fprintf(stderr, "mimetools-cli: cannot write the output\n");
+	}
+	return ok;
+}
+
+// Convert stdin to stdout, or only print the length of the output, returns the exit code
+static int convertStream(const CodecInfo *info, const CodecOptions& options, bool countOnly)
+{
+	std::unique_ptr<Codec> codec = createCodec(info->id, options);
+	if (countOnly)
+	{
+		CountingSink sink;
+		if (!streamInput(info, *codec, sink))
+			return 1;
+		printf("%llu\n", (unsigned long long)sink.count());
+	}
+	else
+	{
+		FileSink sink(stdout);
+		if (!streamInput(info, *codec, sink))
+			return 1;
+	}
+
+	if (fflush(stdout) != 0)
+	{
+		fprintf(stderr, "mimetools-cli: cannot write the output\n");
+		return 1;
+	}
+	return 0;
+}
+
+static bool readInput(std::string& input)
+{
+	TRACE_SPAN("read");
+	std::vector<char> buffer(CLI_BUFFER_SIZE);
+	size_t length;
+	while ((length = fread(buffer.data(), 1, buffer.size(), stdin)) > 0)
+		input.append(buffer.data(), length);
+	if (ferror(stdin))
+	{
+		fprintf(stderr, "mimetools-cli: cannot read the input\n");
+		return false;
+	}
+	return true;
+}
+
+// Decode the base64 runs of stdin, returns the exit code (1 when there is none, as grep)
+static int decodeBase64Runs(size_t minLength)
+{
+	std::string input;
+	if (!readInput(input))
+		return 1;
+
+	std::vector<Base64Run> runs = base64DecodeRuns(input.data(), input.length(), minLength);
+
+	std::string output;
+	for (const Base64Run& run : runs)
+	{
+		output += std::to_string(run.line + 1);
+		output += ": ";
+		if (run.isText)
+			output += run.decoded;
+		else
+			output += "(" + std::to_string(run.decoded.length()) + " bytes of binary data)";
+		output += '\n';
+	}
+	if (!writeOutput(output) || fflush(stdout) != 0)
+	{
+		fprintf(stderr, "mimetools-cli: cannot write the output\n");
+		return 1;
+	}
+	return runs.empty() ? 1 : 0;
+}
+
+// Search text in the base64 text of stdin, returns the exit code (1 when not found)
+static int findInBase64(const char *text)
+{
+	Base64Search search(text);
+	if (!search.isValid())
+	{
+		fprintf(stderr, "mimetools-cli: the text to find must have at least %u characters\n", unsigned(BASE64_SEARCH_LENGTH_MIN));
+		return 2;
+	}
+
+	std::string input;
+	if (!readInput(input))
+		return 1;
+
+	std::vector<Base64Match> matches = search.findAll(input.data(), input.length());
+
+	std::string output;
+	for (const Base64Match& match : matches)
+		output += std::to_string(match.start) + ' ' + std::to_string(match.end) + '\n';
+	if (!writeOutput(output) || fflush(stdout) != 0)
+	{
+		fprintf(stderr, "mimetools-cli: cannot write the output\n");
+		return 1;
+	}
+	return matches.empty() ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	CodecOptions options;
+	const CodecInfo *info = nullptr;
+	bool base64Runs = false;
+	size_t minLength = BASE64_RUN_LENGTH_MIN;
+	const char *searchText = nullptr;
+	bool countOnly = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		if (strcmp(arg, "--list") == 0)
+		{
+			listCodecs();
+			return 0;
+		}
+		else if (strcmp(arg, "--list-stages") == 0)
+		{
+			listStages();
+			return 0;
+		}
+		else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+		{
+			usage(stdout);
+			return 0;
+		}
+		else if (strcmp(arg, "--base64-runs") == 0)
+			base64Runs = true;
+		else if (strcmp(arg, "--find-base64") == 0 && i + 1 < argc)
+			searchText = argv[++i];
+		else if (strcmp(arg, "--min-length") == 0 && i + 1 < argc)
+		{
+			minLength = strtoul(argv[++i], nullptr, 10);
+			if (minLength == 0)
+			{
+				fprintf(stderr, "mimetools-cli: invalid minimum length \"%s\"\n", argv[i]);
+				return 2;
+			}
+		}
+		else if (strcmp(arg, "--format-xml") == 0)
+			options.formatXml = true;
+		else if (strcmp(arg, "--count") == 0)
+			countOnly = true;
+		else if (strcmp(arg, "--pipeline") == 0 && i + 1 < argc && !info)
+		{
+			options.pipeline = argv[++i];
+			std::string errorMessage;
+			if (!checkPipeline(options.pipeline, &errorMessage))
+			{
+				fprintf(stderr, "mimetools-cli: %s (see --list-stages)\n", errorMessage.c_str());
+				return 2;
+			}
+			info = codecInfo(CodecId::pipeline);
+		}
+		else if (strcmp(arg, "--eol") == 0 && i + 1 < argc)
+		{
+			const char *eol = argv[++i];
+			if (strcmp(eol, "lf") == 0)
+				options.eol = "\n";
+			else if (strcmp(eol, "crlf") == 0)
+				options.eol = "\r\n";
+			else if (strcmp(eol, "cr") == 0)
+				options.eol = "\r";
+			else
+			{
+				fprintf(stderr, "mimetools-cli: unknown end of line \"%s\"\n", eol);
+				return 2;
+			}
+		}
+		else if (!info && arg[0] != '-')
+		{
+			info = findCodec(arg);
+			if (!info)
+			{
+				fprintf(stderr, "mimetools-cli: unknown conversion \"%s\" (see --list)\n", arg);
+				return 2;
+			}
+		}
+		else
+		{
+			usage(stderr);
+			return 2;
+		}
+	}
+	if ((info != nullptr) + base64Runs + (searchText != nullptr) != 1 || (countOnly && !info))
+	{
+		usage(stderr);
+		return 2;
+	}
+
+#ifdef _WIN32
+	_setmode(_fileno(stdin), _O_BINARY);
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	const char *tracePath = getenv("MIMETOOLS_TRACE_FILE");
+	if (tracePath && *tracePath)
+		startTrace();
+
+	int result;
+	if (base64Runs)
+		result = decodeBase64Runs(minLength);
+	else if (searchText)
+		result = findInBase64(searchText);
+	else
+		result = convertStream(info, options, countOnly);
+
+	if (tracePath && *tracePath)
+	{
+		stopTrace();
+		if (!writeTrace(tracePath))
+		{
+			fprintf(stderr, "mimetools-cli: cannot write the trace to %s\n", tracePath);
+			return result ? result : 1;
+		}
+	}
+	return result;
+}
@@ -0,0 +1,294 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+#include "bufferPool.h"
+
+namespace {
+
+// Slot of the threads that joined a job once every slot was taken: they steal single items
+constexpr size_t NO_SLOT = size_t(-1);
+
+thread_local const CancellationToken *t_cancel = nullptr;
+
+// A range of indexes of a job: its thread takes them from next on, thieves from end down
+struct Slot
+{
+	std::mutex mutex;
+	size_t next = 0;
+	size_t end = 0;
+};
+
+// One parallelFor(), on the stack of its calling thread, which owns slot 0
+struct Job
+{
+	void (*call)(void *context, size_t i) = nullptr;
+	void *context = nullptr;
+	const CancellationToken *cancel = nullptr;
+	size_t nbSlots = 0;
+	std::unique_ptr<Slot[]> slots;
+	std::atomic<size_t> nextSlot{1};
+	std::atomic<bool> hasWork{true};       // cleared once a thread found every slot empty
+	std::atomic<size_t> executed{0};
+
+	size_t workers = 0;                     // inside the job, under ThreadPool::_mutex
+	std::condition_variable workersLeft;
+};
+
+// Next index for the thread of slot mine: from its own range, else stolen from another
+bool takeItem(Job& job, size_t mine, size_t& index)
+{
+	if (job.cancel && job.cancel->isCancelled())
+		return false;
+
+	if (mine != NO_SLOT)
+	{
+		Slot& own = job.slots[mine];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (own.next < own.end)
+		{
+			index = own.next++;
+			return true;
+		}
+	}
+
+	size_t first = mine == NO_SLOT ? 0 : mine + 1;
+	for (size_t k = 0; k < job.nbSlots; ++k)
+	{
+		size_t victim = (first + k) % job.nbSlots;
+		if (victim == mine)
+			continue;
+
+		size_t stolenBegin;
+		size_t stolenEnd;
+		{
+			Slot& slot = job.slots[victim];
+			std::lock_guard<std::mutex> lock(slot.mutex);
+			size_t left = slot.end - slot.next;
+			if (left == 0)
+				continue;
+			if (left == 1 || mine == NO_SLOT)
+			{
+				index = --slot.end;
+				return true;
+			}
+			stolenEnd = slot.end;
+			slot.end -= left / 2;
+			stolenBegin = slot.end;
+		}
+
+		// the stolen range is not in any slot meanwhile: this thread runs it all the same
+		Slot& own = job.slots[mine];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		own.next = stolenBegin + 1;
+		own.end = stolenEnd;
+		index = stolenBegin;
+		return true;
+	}
+
+	job.hasWork.store(false, std::memory_order_relaxed);
+	return false;
+}
+
+void work(Job& job, size_t mine)
+{
+	const CancellationToken *previous = t_cancel;
+	t_cancel = job.cancel;
+	size_t index;
+	while (takeItem(job, mine, index))
+	{
+		job.call(job.context, index);
+		job.executed.fetch_add(1, std::memory_order_relaxed);
+	}
+	t_cancel = previous;
+}
+
+class ThreadPool {
+public:
+	explicit ThreadPool(size_t nbWorkers)
+	{
+		for (size_t i = 0; i < nbWorkers; ++i)
+			_threads.emplace_back(&ThreadPool::workerLoop, this);
+	};
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_wake.notify_all();
+		for (std::thread& thread : _threads)
+			thread.join();
+	};
+
+	size_t threadCount() const { return _threads.size() + 1; };
+
+	// Publish the job, work on it, then wait for the workers still running an item of it
+	void run(Job& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_jobs.push_back(&job);
+		}
+		if (job.nbSlots - 1 >= _threads.size())
+			_wake.notify_all();
+		else
+		{
+			for (size_t i = 1; i < job.nbSlots; ++i)
+				_wake.notify_one();
+		}
+
+		work(job, 0);
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_jobs.erase(std::find(_jobs.begin(), _jobs.end(), &job));
+		job.workersLeft.wait(lock, [&job]() { return job.workers == 0; });
+	};
+
+private:
+	void workerLoop()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		bool trimmed = true;
+		for (;;)
+		{
+			auto found = std::find_if(_jobs.begin(), _jobs.end(), [](Job *job) { return job->hasWork.load(std::memory_order_relaxed); });
+			if (found == _jobs.end())
+			{
+				if (_stopping)
+					return;
+				if (trimmed)
+					_wake.wait(lock);
+				else if (_wake.wait_for(lock, std::chrono::nanoseconds(BUFFER_POOL_IDLE_NS)) == std::cv_status::timeout)
+				{
+					lock.unlock();
+					trimBufferPool(0);
+					lock.lock();
+					trimmed = true;
+				}
+				continue;
+			}
+
+			Job& job = **found;
+			++job.workers;
+			lock.unlock();
+
+			size_t mine = job.nextSlot.fetch_add(1, std::memory_order_relaxed);
+			work(job, mine < job.nbSlots ? mine : NO_SLOT);
+			trimmed = false;
+
+			lock.lock();
+			if (--job.workers == 0)
+				job.workersLeft.notify_all();
+		}
+	};
+
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::vector<Job *> _jobs;      // running parallelFor() calls, nested ones included
+	bool _stopping = false;
+	std::vector<std::thread> _threads;
+};
+
+std::mutex g_poolLock;
+std::unique_ptr<ThreadPool> g_pool;
+bool g_poolShutdown = false;
+
+ThreadPool *sharedPool()
+{
+	std::lock_guard<std::mutex> guard(g_poolLock);
+	if (!g_pool && !g_poolShutdown)
+	{
+		size_t nbThreads = std::thread::hardware_concurrency();
+		const char *threads = getenv("MIMETOOLS_THREADS");
+		if (threads && atoi(threads) > 0)
+			nbThreads = size_t(atoi(threads));
+		g_pool.reset(new ThreadPool(nbThreads > 1 ? nbThreads - 1 : 0));
+	}
+	return g_pool.get();
+}
+
+} // namespace
+
+CancellationScope::CancellationScope(const CancellationToken& token) : _previous(t_cancel)
+{
+	t_cancel = &token;
+}
+
+CancellationScope::~CancellationScope()
+{
+	t_cancel = _previous;
+}
+
+size_t parallelThreadCount()
+{
+	ThreadPool *pool = sharedPool();
+	return pool ? pool->threadCount() : 1;
+}
+
+void shutdownThreadPool()
+{
+	// joined once out of the lock
+	std::unique_ptr<ThreadPool> pool;
+	{
+		std::lock_guard<std::mutex> guard(g_poolLock);
+		g_poolShutdown = true;
+		pool = std::move(g_pool);
+	}
+}
+
+bool runParallel(size_t count, void (*call)(void *context, size_t i), void *context, const CancellationToken *cancel)
+{
+	if (!cancel)
+		cancel = t_cancel;
+
+	ThreadPool *pool = count > 1 ? sharedPool() : nullptr;
+	size_t nbSlots = pool ? std::min(count, pool->threadCount()) : 1;
+	if (nbSlots <= 1)
+	{
+		const CancellationToken *previous = t_cancel;
+		t_cancel = cancel;
+		size_t i = 0;
+		for (; i < count && !(cancel && cancel->isCancelled()); ++i)
+			call(context, i);
+		t_cancel = previous;
+		return i == count;
+	}
+
+	Job job;
+	job.call = call;
+	job.context = context;
+	job.cancel = cancel;
+	job.nbSlots = nbSlots;
+	job.slots.reset(new Slot[nbSlots]);
+	for (size_t s = 0; s < nbSlots; ++s)
+	{
+		job.slots[s].next = count * s / nbSlots;
+		job.slots[s].end = count * (s + 1) / nbSlots;
+	}
+	pool->run(job);
+	return job.executed.load(std::memory_order_relaxed) == count;
+}
@@ -0,0 +1,98 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+
+// The parallel paths of the codecs run on one shared pool of worker threads, created on
+// the first parallelFor() with a thread per core but the calling one, which works too.
+// Idle workers sleep on a condition variable; after BUFFER_POOL_IDLE_NS (see bufferPool.h)
+// without work they give back the buffers of their pool before sleeping on.
+//
+// Every thread taking part in a parallelFor() starts on its own range of indexes, taken one
+// at a time; once it is empty, the thread steals the upper half of the range of another
+// one. Items of very different cost (a 100 bytes SAMLRequest next to a 1 MB SAMLResponse)
+// still balance well, and consecutive items mostly run on the same thread.
+//
+// A parallelFor() called from an item (samlDecodeAll() inflating a large payload) is run
+// by the calling worker and by the idle ones: the pool never waits on itself.
+
+// Set by a command to stop the parallelFor() calls it started: the items not started yet
+// are skipped, those running finish. Their results are incomplete, only to be discarded.
+class CancellationToken {
+public:
+	void cancel() { _cancelled.store(true, std::memory_order_relaxed); };
+	bool isCancelled() const { return _cancelled.load(std::memory_order_relaxed); };
+
+private:
+	std::atomic<bool> _cancelled{false};
+};
+
+// The parallelFor() calls made on this thread while the scope lives, and from their items
+// on any thread, without a token of their own, stop when token is cancelled. This reaches
+// the parallel paths inside the codecs, which know nothing of commands.
+class CancellationScope {
+public:
+	explicit CancellationScope(const CancellationToken& token);
+	~CancellationScope();
+
+	CancellationScope(const CancellationScope&) = delete;
+	CancellationScope& operator=(const CancellationScope&) = delete;
+
+private:
+	const CancellationToken *_previous;
+};
+
+// Threads running a parallelFor(): the workers of the pool and the calling thread.
+// Creates the pool, with one thread per core, or MIMETOOLS_THREADS (environment variable)
+// threads when set: the tests stress the pool with more threads than the machine has cores.
+size_t parallelThreadCount();
+
+// Stop and join the workers; the parallelFor() calls made afterwards run on the calling
+// thread alone. No parallelFor() may be running. The plugin calls it at NPPN_SHUTDOWN:
+// threads cannot be joined once the DLL is being unloaded.
+void shutdownThreadPool();
+
+// Non template part of parallelFor(): call(context, i) for every i in [0, count)
+bool runParallel(size_t count, void (*call)(void *context, size_t i), void *context, const CancellationToken *cancel);
+
+// Call fn(i) for every i in [0, count), spread over all the cores, and return once all
+// the calls returned. fn must only touch state owned by item i.
+// False if cancel (or the token of the current CancellationScope) stopped the loop.
+template <typename Fn>
+bool parallelFor(size_t count, Fn fn, const CancellationToken *cancel = nullptr)
+{
+	return runParallel(count, [](void *context, size_t i) { (*static_cast<Fn *>(context))(i); }, &fn, cancel);
+}
+
+// Call fn(piece, begin, end) for the pieces of [0, length) of pieceLength each, the last
+// one shorter. The pieces do not depend on the number of threads: when the output of a
+// piece has a size known from its length, it goes at an offset known from its index, and
+// the result is the same as a single thread's.
+template <typename Fn>
+bool parallelForRanges(size_t length, size_t pieceLength, Fn fn, const CancellationToken *cancel = nullptr)
+{
+	size_t nbPieces = (length + pieceLength - 1) / pieceLength;
+	return parallelFor(nbPieces, [&](size_t piece)
+	{
+		size_t begin = piece * pieceLength;
+		size_t end = length - begin < pieceLength ? length : begin + pieceLength;
+		fn(piece, begin, end);
+	}, cancel);
+}
@@ -0,0 +1,732 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "parallelInflate.h"
+#include "parallel.h"
+#include "trace.h"
+
+namespace {
+
+// Back-references reach at most this far
+constexpr size_t WINDOW_SIZE = 32768;
+
+// Codes up to this length are decoded with one table lookup
+constexpr int FAST_BITS = 10;
+
+// A chunk smaller than this is not worth a thread, even when the count is forced
+constexpr size_t CHUNK_SIZE_MIN = 4096;
+
+// A chunk looks that far for a block start. Blocks are much shorter (16K symbols for
+// tdeflate and zlib): a stream where none is found there, made of fixed Huffman blocks
+// that cannot be told from random bits or of very long blocks, is inflated sequentially.
+constexpr size_t BLOCK_SEARCH_BYTES = 128 << 10;
+
+constexpr size_t NO_BLOCK_START = size_t(-1);
+
+const uint16_t lengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+const uint8_t lengthExtraBits[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+const uint16_t distBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+const uint8_t distExtraBits[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+const uint8_t codeLengthOrder[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// Reads the stream LSB first from any bit position
+class BitReader {
+public:
+	BitReader(const uint8_t *src, size_t len, size_t bitPos) : _src(src), _len(len), _pos(bitPos) {};
+
+	size_t pos() const { return _pos; };
+	bool overflow() const { return _pos > _len * 8; };
+
+	// n <= 32; reading past the end yields zeros (and overflow() afterwards)
+	uint32_t peek(int n) const
+	{
+		size_t byte = _pos >> 3;
+		uint64_t v = 0;
+		if (byte + 8 <= _len)
+		{
+			memcpy(&v, _src + byte, 8);  // little endian
+		}
+		else
+		{
+			for (size_t i = 0; byte + i < _len; ++i)
+				v |= uint64_t(_src[byte + i]) << (8 * i);
+		}
+		return uint32_t((v >> (_pos & 7)) & ((uint64_t(1) << n) - 1));
+	};
+
+	void skip(int n) { _pos += n; };
+
+	uint32_t bits(int n)
+	{
+		uint32_t v = peek(n);
+		_pos += n;
+		return v;
+	};
+
+	void alignToByte() { _pos = (_pos + 7) & ~size_t(7); };
+
+private:
+	const uint8_t *_src;
+	size_t _len;
+	size_t _pos;
+};
+
+// Canonical Huffman code, same layout as tinf (code length counts, symbols sorted by code)
+// plus a lookup table for the short codes
+class HuffTable {
+public:
+	// Follows zlib: no over-subscribed code, an incomplete one only if it holds a single code
+	bool build(const uint8_t *lengths, unsigned int num)
+	{
+		memset(_count, 0, sizeof(_count));
+		for (unsigned int i = 0; i < num; ++i)
+			_count[lengths[i]]++;
+		_count[0] = 0;
+
+		int left = 1;
+		unsigned int nbCodes = 0;
+		for (int len = 1; len < 16; ++len)
+		{
+			left <<= 1;
+			left -= _count[len];
+			if (left < 0)
+				return false;
+			nbCodes += _count[len];
+		}
+		if (left > 0 && nbCodes > 1)
+			return false;
+
+		uint16_t offs[16];
+		uint16_t nextCode[16];
+		unsigned int code = 0;
+		offs[0] = 0;
+		nextCode[0] = 0;
+		for (int len = 1; len < 16; ++len)
+		{
+			offs[len] = uint16_t(offs[len - 1] + (len > 1 ? _count[len - 1] : 0));
+			code = (code + (len > 1 ? _count[len - 1] : 0)) << 1;
+			nextCode[len] = uint16_t(code);
+		}
+
+		memset(_fast, 0, sizeof(_fast));
+		for (unsigned int sym = 0; sym < num; ++sym)
+		{
+			int len = lengths[sym];
+			if (!len)
+				continue;
+			_symbols[offs[len]++] = uint16_t(sym);
+
+			unsigned int c = nextCode[len]++;
+			if (len <= FAST_BITS)
+			{
+				unsigned int reversed = 0;
+				for (int i = 0; i < len; ++i)
+					reversed |= ((c >> i) & 1) << (len - 1 - i);
+				for (unsigned int r = reversed; r < (1u << FAST_BITS); r += 1u << len)
+					_fast[r] = uint16_t((sym << 4) | len);
+			}
+		}
+		return true;
+	};
+
+	// Returns the symbol, or -1 for a code not in the table
+	int decode(BitReader& in) const
+	{
+		uint32_t bits = in.peek(15);
+		uint16_t entry = _fast[bits & ((1u << FAST_BITS) - 1)];
+		if (entry)
+		{
+			in.skip(entry & 15);
+			return entry >> 4;
+		}
+
+		// longer codes: walk the code length counts bit by bit (as puff does)
+		int code = 0, first = 0, index = 0;
+		for (int len = 1; len < 16; ++len)
+		{
+			code |= bits & 1;
+			bits >>= 1;
+			int count = _count[len];
+			if (code - count < first)
+			{
+				in.skip(len);
+				return _symbols[index + (code - first)];
+			}
+			index += count;
+			first += count;
+			first <<= 1;
+			code <<= 1;
+		}
+		return -1;
+	};
+
+private:
+	uint16_t _fast[1 << FAST_BITS];  // (symbol << 4) | length, 0 for longer codes
+	uint16_t _count[16];
+	uint16_t _symbols[288];
+};
+
+struct FixedTables
+{
+	HuffTable lit;
+	HuffTable dist;
+
+	FixedTables()
+	{
+		uint8_t lengths[288];
+		unsigned int i = 0;
+		for (; i < 144; ++i) lengths[i] = 8;
+		for (; i < 256; ++i) lengths[i] = 9;
+		for (; i < 280; ++i) lengths[i] = 7;
+		for (; i < 288; ++i) lengths[i] = 8;
+		lit.build(lengths, 288);
+
+		// 32 codes as in zlib: 30 would be an incomplete code, which build() rejects.
+		// Codes 30 and 31 never appear in valid data, inflateBlockData() rejects them.
+		for (i = 0; i < 32; ++i) lengths[i] = 5;
+		dist.build(lengths, 32);
+	};
+};
+
+const FixedTables& fixedTables()
+{
+	static const FixedTables tables;
+	return tables;
+}
+
+bool readDynamicTrees(BitReader& in, HuffTable& lit, HuffTable& dist)
+{
+	unsigned int hlit = in.bits(5) + 257;
+	unsigned int hdist = in.bits(5) + 1;
+	unsigned int hclen = in.bits(4) + 4;
+	if (hlit > 286 || hdist > 30)
+		return false;
+
+	uint8_t lengths[288 + 32];
+	memset(lengths, 0, 19);
+	for (unsigned int i = 0; i < hclen; ++i)
+		lengths[codeLengthOrder[i]] = uint8_t(in.bits(3));
+
+	HuffTable codeLengths;
+	if (!codeLengths.build(lengths, 19))
+		return false;
+
+	for (unsigned int num = 0; num < hlit + hdist; )
+	{
+		int sym = codeLengths.decode(in);
+		if (sym < 0)
+			return false;
+
+		if (sym < 16)
+		{
+			lengths[num++] = uint8_t(sym);
+			continue;
+		}
+
+		uint8_t repeated = 0;
+		unsigned int count;
+		if (sym == 16)
+		{
+			if (num == 0)
+				return false;
+			repeated = lengths[num - 1];
+			count = 3 + in.bits(2);
+		}
+		else if (sym == 17)
+			count = 3 + in.bits(3);
+		else
+			count = 11 + in.bits(7);
+
+		if (num + count > hlit + hdist)
+			return false;
+		memset(lengths + num, repeated, count);
+		num += count;
+	}
+
+	// a block always ends with an end-of-block code
+	if (lengths[256] == 0)
+		return false;
+
+	return !in.overflow() && lit.build(lengths, hlit) && dist.build(lengths + hlit, hdist);
+}
+
+// Inflated output. In a chunk inflated without its preceding window, T is uint16_t:
+// values below 256 are bytes, 256 + i stands for byte i of the unknown 32 KB window.
+template <typename T>
+struct Output
+{
+	std::vector<T> data;
+	size_t len = 0;
+
+	bool reserve(size_t n, size_t maxLen)
+	{
+		if (len + n > maxLen)
+			return false;
+		if (len + n > data.size())
+		{
+			size_t size = data.size() * 2;
+			if (size < len + n) size = len + n;
+			if (size < 65536) size = 65536;
+			data.resize(size);
+		}
+		return true;
+	};
+};
+
+// window is 0 for a stream read from its start, WINDOW_SIZE when the preceding output is unknown
+template <typename T>
+int inflateBlockData(BitReader& in, const HuffTable& lit, const HuffTable& dist, Output<T>& out, size_t window, size_t maxLen)
+{
+	for (;;)
+	{
+		int sym = lit.decode(in);
+		if (sym < 0 || in.overflow())
+			return TINF_DATA_ERROR;
+
+		if (sym < 256)
+		{
+			if (!out.reserve(1, maxLen))
+				return TINF_BUF_ERROR;
+			out.data[out.len++] = T(sym);
+			continue;
+		}
+		if (sym == 256)
+			return TINF_OK;
+
+		sym -= 257;
+		if (sym > 28)
+			return TINF_DATA_ERROR;
+		size_t length = lengthBase[sym] + in.bits(lengthExtraBits[sym]);
+
+		int distSym = dist.decode(in);
+		if (distSym < 0 || distSym > 29)
+			return TINF_DATA_ERROR;
+		size_t offs = distBase[distSym] + in.bits(distExtraBits[distSym]);
+
+		if (offs > out.len + window)
+			return TINF_DATA_ERROR;
+		if (!out.reserve(length, maxLen))
+			return TINF_BUF_ERROR;
+
+		T *dest = out.data.data() + out.len;
+		if (offs <= out.len)
+		{
+			for (size_t i = 0; i < length; ++i)
+				dest[i] = dest[i - offs];
+		}
+		else
+		{
+			// reaches into the unknown window: placeholders, then copies of what follows them
+			size_t fromWindow = offs - out.len;
+			for (size_t i = 0; i < length; ++i)
+				dest[i] = i < fromWindow ? T(256 + window - fromWindow + i) : dest[i - offs];
+		}
+		out.len += length;
+	}
+}
+
+template <typename T>
+int inflateStoredBlock(BitReader& in, const uint8_t *src, size_t srcLen, Output<T>& out, size_t maxLen)
+{
+	in.alignToByte();
+	size_t byte = in.pos() >> 3;
+	if (byte + 4 > srcLen)
+		return TINF_DATA_ERROR;
+
+	size_t length = src[byte] | (src[byte + 1] << 8);
+	size_t invLength = src[byte + 2] | (src[byte + 3] << 8);
+	if (length != (~invLength & 0xffff))
+		return TINF_DATA_ERROR;
+	byte += 4;
+
+	if (length > srcLen - byte)
+		return TINF_DATA_ERROR;
+	if (!out.reserve(length, maxLen))
+		return TINF_BUF_ERROR;
+
+	T *dest = out.data.data() + out.len;
+	for (size_t i = 0; i < length; ++i)
+		dest[i] = src[byte + i];
+	out.len += length;
+
+	in.skip(int((length + 4) * 8));
+	return TINF_OK;
+}
+
+// Inflates blocks until a block boundary at or after stopBit, or the end of the final block
+template <typename T>
+int inflateBlocks(BitReader& in, const uint8_t *src, size_t srcLen, Output<T>& out, size_t stopBit, size_t window, size_t maxLen, bool& final)
+{
+	HuffTable lit, dist;
+	final = false;
+
+	for (bool first = true; first || in.pos() < stopBit; first = false)
+	{
+		uint32_t bfinal = in.bits(1);
+		uint32_t btype = in.bits(2);
+
+		int res;
+		switch (btype)
+		{
+			case 0:
+				res = inflateStoredBlock(in, src, srcLen, out, maxLen);
+				break;
+			case 1:
+				res = inflateBlockData(in, fixedTables().lit, fixedTables().dist, out, window, maxLen);
+				break;
+			case 2:
+				res = readDynamicTrees(in, lit, dist) ? inflateBlockData(in, lit, dist, out, window, maxLen) : TINF_DATA_ERROR;
+				break;
+			default:
+				res = TINF_DATA_ERROR;
+		}
+
+		if (res != TINF_OK)
+			return res;
+		if (in.overflow())
+			return TINF_DATA_ERROR;
+		if (bfinal)
+		{
+			final = true;
+			break;
+		}
+	}
+	return TINF_OK;
+}
+
+// Is bit a plausible start of a non final dynamic block: its header gives valid codes,
+// the whole block decodes, and what follows is a valid block type.
+bool isBlockStart(const uint8_t *src, size_t srcLen, size_t bit, Output<uint16_t>& scratch)
+{
+	BitReader in(src, srcLen, bit);
+	if (in.peek(3) != (2 << 1))
+		return false;
+	in.skip(3);
+
+	HuffTable lit, dist;
+	if (!readDynamicTrees(in, lit, dist))
+		return false;
+
+	scratch.len = 0;
+	if (inflateBlockData(in, lit, dist, scratch, WINDOW_SIZE, size_t(-1)) != TINF_OK || in.overflow())
+		return false;
+
+	return (in.peek(3) >> 1) != 3;
+}
+
+// Is byte the LEN of a non final stored block: NLEN is its complement, a header fits in the
+// bits before it, and the block that follows decodes. The header itself cannot be placed
+// (its padding is not known), so the block boundary returned is the end of the stored
+// block, or NO_BLOCK_START.
+size_t storedBlockEnd(const uint8_t *src, size_t srcLen, size_t byte, Output<uint16_t>& scratch)
+{
+	if (byte == 0 || byte + 4 > srcLen)
+		return NO_BLOCK_START;
+	uint32_t len = src[byte] | (src[byte + 1] << 8);
+	uint32_t nlen = src[byte + 2] | (src[byte + 3] << 8);
+	if (len != (~nlen & 0xffff) || byte + 4 + len >= srcLen)
+		return NO_BLOCK_START;
+
+	// BFINAL 0 and BTYPE 00 start 3 to 10 bits before the byte
+	uint32_t before = (src[byte - 1] << 8) | (byte >= 2 ? src[byte - 2] : 0);
+	int shift = byte >= 2 ? 6 : 8;
+	while (shift <= 13 && ((before >> shift) & 7) != 0)
+		++shift;
+	if (shift > 13)
+		return NO_BLOCK_START;
+
+	size_t end = (byte + 4 + len) * 8;
+	BitReader in(src, srcLen, end);
+	bool final;
+	scratch.len = 0;
+	if (inflateBlocks(in, src, srcLen, scratch, 0, WINDOW_SIZE, size_t(-1), final) != TINF_OK)
+		return NO_BLOCK_START;
+	return final || (in.peek(3) >> 1) != 3 ? end : NO_BLOCK_START;
+}
+
+// First block boundary in [fromBit, toBit): the start of a dynamic block or the end of a
+// stored one (which may lie past toBit). Gives up as soon as giveUp is set.
+size_t findBlockStart(const uint8_t *src, size_t srcLen, size_t fromBit, size_t toBit, const std::atomic<bool>& giveUp)
+{
+	Output<uint16_t> scratch;
+	for (size_t bit = fromBit; bit < toBit; ++bit)
+	{
+		if ((bit & 7) == 0)
+		{
+			if (giveUp.load(std::memory_order_relaxed))
+				break;
+			size_t end = storedBlockEnd(src, srcLen, bit >> 3, scratch);
+			if (end != NO_BLOCK_START)
+				return end;
+		}
+		if (isBlockStart(src, srcLen, bit, scratch))
+			return bit;
+	}
+	return NO_BLOCK_START;
+}
+
+struct Segment
+{
+	size_t startBit = 0;
+	size_t endBit = 0;
+	bool final = false;
+	int result = TINF_OK;
+	Output<uint16_t> symbols;
+};
+
+void inflateSegment(Segment& segment, const uint8_t *src, size_t srcLen, size_t stopBit, size_t window, size_t maxLen)
+{
+	BitReader in(src, srcLen, segment.startBit);
+	segment.result = inflateBlocks(in, src, srcLen, segment.symbols, stopBit, window, maxLen, segment.final);
+	segment.endBit = in.pos();
+}
+
+// Resolve placeholders with the window preceding the segment. minRef is the first window byte
+// that exists (the window of a segment starting less than 32 KB into the output is partial).
+bool translate(const uint16_t *symbols, size_t count, const uint8_t *window, size_t minRef, uint8_t *dest)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint16_t v = symbols[i];
+		if (v < 256)
+			dest[i] = uint8_t(v);
+		else if (size_t(v - 256) >= minRef)
+			dest[i] = window[v - 256];
+		else
+			return false;
+	}
+	return true;
+}
+
+int sequentialInflate(std::string& dest, const uint8_t *src, size_t srcLen, size_t destMaxLen)
+{
+	Output<uint8_t> out;
+	BitReader in(src, srcLen, 0);
+	bool final;
+	int res = inflateBlocks(in, src, srcLen, out, size_t(-1), 0, destMaxLen, final);
+	if (res == TINF_OK)
+		dest.assign(reinterpret_cast<const char *>(out.data.data()), out.len);
+	return res;
+}
+
+} // namespace
+
+
+int parallelInflate(std::string& dest, const void *source, size_t sourceLen, size_t destMaxLen, unsigned int nbChunks)
+{
+	const uint8_t *src = static_cast<const uint8_t *>(source);
+	dest.clear();
+
+	if (nbChunks == 0)
+	{
+		nbChunks = static_cast<unsigned int>(parallelThreadCount());
+		if (nbChunks > sourceLen / PARALLEL_INFLATE_CHUNK_MIN)
+			nbChunks = static_cast<unsigned int>(sourceLen / PARALLEL_INFLATE_CHUNK_MIN);
+	}
+	else if (nbChunks > sourceLen / CHUNK_SIZE_MIN)
+	{
+		nbChunks = static_cast<unsigned int>(sourceLen / CHUNK_SIZE_MIN);
+	}
+
+	if (nbChunks <= 1)
+		return sequentialInflate(dest, src, sourceLen, destMaxLen);
+
+	// 1. Every chunk but the first looks for a block start near its beginning. When the
+	//    second one finds none, neither would the others: the stream is inflated sequentially.
+	size_t chunkBits = sourceLen / nbChunks * 8;
+	std::vector<size_t> chunkStarts(nbChunks, NO_BLOCK_START);
+	std::atomic<bool> giveUp{false};
+	chunkStarts[0] = 0;
+	parallelFor(nbChunks - 1, [&](size_t i)
+	{
+		size_t chunk = i + 1;
+		size_t fromBit = chunk * chunkBits;
+		size_t toBit = chunk + 1 < nbChunks ? (chunk + 1) * chunkBits : sourceLen * 8;
+		if (toBit - fromBit > BLOCK_SEARCH_BYTES * 8)
+			toBit = fromBit + BLOCK_SEARCH_BYTES * 8;
+		TRACE_SPAN("inflate find block start");
+		chunkStarts[chunk] = findBlockStart(src, sourceLen, fromBit, toBit, giveUp);
+		if (chunk == 1 && chunkStarts[chunk] == NO_BLOCK_START)
+			giveUp.store(true, std::memory_order_relaxed);
+	});
+
+	if (chunkStarts[1] == NO_BLOCK_START)
+		return sequentialInflate(dest, src, sourceLen, destMaxLen);
+
+	// the end of a stored block may lie past the starts found by the next chunks
+	std::vector<size_t> starts;
+	for (size_t start : chunkStarts)
+	{
+		if (start != NO_BLOCK_START && (starts.empty() || start > starts.back()))
+			starts.push_back(start);
+	}
+
+	// 2. Speculative inflate of every chunk, up to the start found by the next one
+	std::vector<Segment> speculated(starts.size());
+	parallelFor(starts.size(), [&](size_t i)
+	{
+		speculated[i].startBit = starts[i];
+		size_t stopBit = i + 1 < starts.size() ? starts[i + 1] : size_t(-1);
+		TRACE_SPAN("inflate chunk");
+		inflateSegment(speculated[i], src, sourceLen, stopBit, i ? WINDOW_SIZE : 0, destMaxLen);
+	});
+
+	// 3. Link the chunks: each must end where the next one starts, otherwise the gap
+	//    is inflated sequentially from the last verified block boundary
+	std::vector<Segment> chain;
+	size_t totalLen = 0;
+	size_t next = 1;
+	chain.push_back(std::move(speculated[0]));
+	for (;;)
+	{
+		Segment& last = chain.back();
+		if (last.result != TINF_OK)
+			return last.result;
+		totalLen += last.symbols.len;
+		if (totalLen > destMaxLen)
+			return TINF_BUF_ERROR;
+		if (last.final)
+			break;
+
+		size_t endBit = last.endBit;
+		while (next < starts.size() && starts[next] < endBit)
+			++next;
+
+		if (next < starts.size() && starts[next] == endBit)
+		{
+			chain.push_back(std::move(speculated[next++]));
+		}
+		else
+		{
+			Segment gap;
+			gap.startBit = endBit;
+			size_t stopBit = next < starts.size() ? starts[next] : size_t(-1);
+			TRACE_SPAN("inflate gap");
+			inflateSegment(gap, src, sourceLen, stopBit, WINDOW_SIZE, destMaxLen - totalLen);
+			chain.push_back(std::move(gap));
+		}
+	}
+
+	// 4. The window of each segment is the end of the previous one, resolved
+	std::vector<std::vector<uint8_t>> windows(chain.size(), std::vector<uint8_t>(WINDOW_SIZE));
+	std::vector<size_t> offsets(chain.size());
+	for (size_t i = 1; i < chain.size(); ++i)
+	{
+		const Output<uint16_t>& prev = chain[i - 1].symbols;
+		offsets[i] = offsets[i - 1] + prev.len;
+
+		size_t kept = prev.len < WINDOW_SIZE ? WINDOW_SIZE - prev.len : 0;
+		memcpy(windows[i].data(), windows[i - 1].data() + WINDOW_SIZE - kept, kept);
+		size_t minRef = offsets[i - 1] < WINDOW_SIZE ? WINDOW_SIZE - offsets[i - 1] : 0;
+		if (!translate(prev.data.data() + prev.len - (WINDOW_SIZE - kept), WINDOW_SIZE - kept, windows[i - 1].data(), minRef, windows[i].data() + kept))
+			return TINF_DATA_ERROR;
+	}
+
+	// 5. Translate every segment to bytes
+	dest.resize(totalLen);
+	std::vector<char> translated(chain.size(), 0);
+	parallelFor(chain.size(), [&](size_t i)
+	{
+		size_t minRef = offsets[i] < WINDOW_SIZE ? WINDOW_SIZE - offsets[i] : 0;
+		TRACE_SPAN_BYTES("inflate translate", chain[i].symbols.len);
+		translated[i] = translate(chain[i].symbols.data.data(), chain[i].symbols.len, windows[i].data(), minRef, reinterpret_cast<uint8_t *>(&dest[0]) + offsets[i]);
+	});
+
+	for (char ok : translated)
+	{
+		if (!ok)
+		{
+			dest.clear();
+			return TINF_DATA_ERROR;
+		}
+	}
+	return TINF_OK;
+}
+
+size_t gzipHeaderLength(const void *source, size_t sourceLen)
+{
+	enum { FHCRC = 2, FEXTRA = 4, FNAME = 8, FCOMMENT = 16 };
+	const uint8_t *src = static_cast<const uint8_t *>(source);
+
+	if (sourceLen < 18 || src[0] != 0x1f || src[1] != 0x8b || src[2] != 8 || (src[3] & 0xe0))
+		return 0;
+
+	uint8_t flg = src[3];
+	size_t start = 10;
+	if (flg & FEXTRA)
+		start += 2 + (src[10] | (src[11] << 8));
+	if (flg & FNAME)
+	{
+		while (start < sourceLen && src[start])
+			++start;
+		++start;
+	}
+	if (flg & FCOMMENT)
+	{
+		while (start < sourceLen && src[start])
+			++start;
+		++start;
+	}
+	if (flg & FHCRC)
+		start += 2;
+	return start > sourceLen - 8 ? 0 : start;
+}
+
+int parallelGunzip(std::string& dest, const void *source, size_t sourceLen, size_t destMaxLen, unsigned int nbChunks)
+{
+	const uint8_t *src = static_cast<const uint8_t *>(source);
+	dest.clear();
+
+	size_t start = gzipHeaderLength(source, sourceLen);
+	if (start == 0)
+		return TINF_DATA_ERROR;
+
+	const uint8_t *trailer = src + sourceLen - 8;
+	unsigned int crc32 = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (unsigned int)(trailer[3] << 24);
+	unsigned int size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | (unsigned int)(trailer[7] << 24);
+
+	int res = parallelInflate(dest, src + start, sourceLen - 8 - start, destMaxLen, nbChunks);
+	if (res != TINF_OK)
+		return res;
+
+	// ISIZE is the size modulo 2^32
+	if (static_cast<unsigned int>(dest.length()) != size || tinf_crc32(dest.data(), static_cast<unsigned int>(dest.length())) != crc32)
+	{
+		dest.clear();
+		return TINF_DATA_ERROR;
+	}
+	return TINF_OK;
+}
@@ -0,0 +1,53 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <string>
+
+#include "tinf.h"
+
+// Below this compressed size, a stream is inflated by a single thread
+constexpr size_t PARALLEL_INFLATE_CHUNK_MIN = 1 << 20;
+
+// Speculative parallel inflate (after pugz, Kerbiriou & Chikhi 2019).
+//
+// The compressed stream is cut in chunks, one per thread. Except for the first one,
+// each chunk looks for a block boundary in its first 128 KB: the start of a dynamic
+// Huffman block (a bit position where a header parses into complete codes and a whole
+// block decodes) or the end of a stored block (found through its LEN and NLEN), then
+// inflates from there. Fixed Huffman blocks cannot be found: when the second chunk finds
+// nothing, the stream is inflated sequentially. Since the 32 KB of output preceding the chunk is not known yet,
+// a back-reference into it is written as a placeholder naming the window byte.
+// Once the first chunk is done, the chunks are linked: chunk i must have stopped on a
+// block boundary exactly where chunk i+1 started, then its last 32 KB give the window
+// to replace the placeholders of chunk i+1, and so on. Every chunk is then translated
+// to bytes in parallel.
+// A wrong guess (a start that was not a block boundary) is caught by the linking: the
+// stream is then inflated sequentially from the last verified boundary, up to the next
+// chunk start that matches. The result is always the one of a sequential inflate.
+//
+// Return TINF_OK, TINF_DATA_ERROR, or TINF_BUF_ERROR if the output would be larger
+// than destMaxLen. nbChunks = 0 uses one chunk per core.
+int parallelInflate(std::string& dest, const void *source, size_t sourceLen, size_t destMaxLen, unsigned int nbChunks = 0);
+
+// Length of the header of the gzip member at source, 0 unless source starts with a valid
+// header and has room for the 8 bytes of the trailer
+size_t gzipHeaderLength(const void *source, size_t sourceLen);
+
+// Same as parallelInflate() for a gzip member: header checked and skipped, CRC32 and size of the trailer verified
+int parallelGunzip(std::string& dest, const void *source, size_t sourceLen, size_t destMaxLen, unsigned int nbChunks = 0);
@@ -0,0 +1,373 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "pipeline.h"
+#include "bufferPool.h"
+#include "parallelInflate.h"
+#include "tdef.h"
+#include "trace.h"
+
+namespace {
+
+// The stages that are not conversions of their own, after those of codec.h
+enum class ExtraStage {
+	base64UrlEncode,
+	base64UrlDecode,
+	inflate,
+	deflate,
+	gunzip
+};
+
+const char *const extraStageNames[] = {
+	"base64url-encode",
+	"base64url-decode",
+	"inflate",
+	"deflate",
+	"gunzip"
+};
+
+constexpr size_t EXTRA_STAGE_COUNT = sizeof(extraStageNames) / sizeof(extraStageNames[0]);
+
+// The conversions of codec.h usable as stages: all but CodecId::pipeline, which is the last one
+size_t codecStageCount()
+{
+	return codecCount() - 1;
+}
+
+// base64url (RFC 4648 section 5): '-' and '_' instead of '+' and '/', without padding
+class Base64UrlEncodeStage : public Codec {
+public:
+	Base64UrlEncodeStage() : _encoder(createCodec(CodecId::base64Encode)) {};
+
+	bool process(const char *text, size_t length, std::string& out) override
+	{
+		size_t outLength = out.length();
+		_encoder->process(text, length, out);
+		toUrlAlphabet(out, outLength);
+		return true;
+	};
+
+	bool finish(std::string& out) override
+	{
+		size_t outLength = out.length();
+		_encoder->finish(out);
+		toUrlAlphabet(out, outLength);
+		return true;
+	};
+
+private:
+	static void toUrlAlphabet(std::string& out, size_t from)
+	{
+		std::replace(out.begin() + from, out.end(), '+', '-');
+		std::replace(out.begin() + from, out.end(), '/', '_');
+	};
+
+	std::unique_ptr<Codec> _encoder;
+};
+
+// The standard alphabet is still decoded, padding is optional
+class Base64UrlDecodeStage : public Codec {
+public:
+	Base64UrlDecodeStage() : _decoder(createCodec(CodecId::base64Decode)) {};
+
+	bool process(const char *text, size_t length, std::string& out) override
+	{
+		PooledString standard(length);
+		standard->assign(text, length);
+		std::replace(standard->begin(), standard->end(), '-', '+');
+		std::replace(standard->begin(), standard->end(), '_', '/');
+		return checked(_decoder->process(standard->data(), standard->length(), out));
+	};
+
+	bool finish(std::string& out) override
+	{
+		return checked(_decoder->finish(out));
+	};
+
+private:
+	bool checked(bool ok)
+	{
+		if (!ok)
+			_errorMessage = _decoder->errorMessage();
+		return ok;
+	};
+
+	std::unique_ptr<Codec> _decoder;
+};
+
+// Keeps its whole input, converted at once by finish()
+class WholeStage : public Codec {
+public:
+	bool process(const char *text, size_t length, std::string& /*out*/) override
+	{
+		_input->append(text, length);
+		return true;
+	};
+
+	bool finish(std::string& out) override
+	{
+		bool ok = _input->empty() || convert(_input->data(), _input->length(), out);
+		_input->clear();
+		return ok;
+	};
+
+protected:
+	virtual bool convert(const char *text, size_t length, std::string& out) = 0;
+
+private:
+	PooledString _input;
+};
+
+// Raw deflate (as in SAML redirect messages) or a gzip member, on all cores when large
+class InflateStage : public WholeStage {
+public:
+	explicit InflateStage(bool gzip) : _gzip(gzip) {};
+
+protected:
+	bool convert(const char *text, size_t length, std::string& out) override
+	{
+		TRACE_SPAN_BYTES(_gzip ? "gunzip" : "inflate", length);
+
+		// parallelInflate() replaces its output: only an empty out is written directly
+		PooledString inflated;
+		std::string& dest = out.empty() ? out : *inflated;
+		int result = _gzip ? parallelGunzip(dest, text, length, PIPELINE_INFLATED_SIZE_MAX)
+		                   : parallelInflate(dest, text, length, PIPELINE_INFLATED_SIZE_MAX);
+		if (result != TINF_OK)
+		{
+			if (result == TINF_BUF_ERROR)
+				_errorMessage = "The inflated data is too large.";
+			else
+				_errorMessage = _gzip ? "The data is not gzip compressed." : "The data is not raw deflate compressed.";
+			return false;
+		}
+		if (&dest != &out)
+			out += dest;
+		return true;
+	};
+
+private:
+	bool _gzip;
+};
+
+// Raw deflate at the default level
+class DeflateStage : public WholeStage {
+protected:
+	bool convert(const char *text, size_t length, std::string& out) override
+	{
+		TRACE_SPAN_BYTES("deflate", length);
+		if (length > UINT_MAX / 2)
+		{
+			_errorMessage = "The text is too large to deflate.";
+			return false;
+		}
+
+		size_t outLength = out.length();
+		unsigned int deflatedLength = tdef_bound((unsigned int)length);
+		out.resize(outLength + deflatedLength);
+		if (tdef_compress(&out[outLength], &deflatedLength, text, (unsigned int)length, TDEF_LEVEL_DEFAULT) != TDEF_OK)
+		{
+			out.resize(outLength);
+			_errorMessage = "Could not deflate text.";
+			return false;
+		}
+		out.resize(outLength + deflatedLength);
+		return true;
+	};
+};
+
+std::unique_ptr<Codec> createStage(size_t index, const CodecOptions& options)
+{
+	if (index < codecStageCount())
+		return createCodec(static_cast<CodecId>(index), options);
+
+	switch (static_cast<ExtraStage>(index - codecStageCount()))
+	{
+		case ExtraStage::base64UrlEncode:
+			return std::unique_ptr<Codec>(new Base64UrlEncodeStage());
+		case ExtraStage::base64UrlDecode:
+			return std::unique_ptr<Codec>(new Base64UrlDecodeStage());
+		case ExtraStage::inflate:
+			return std::unique_ptr<Codec>(new InflateStage(false));
+		case ExtraStage::deflate:
+			return std::unique_ptr<Codec>(new DeflateStage());
+		case ExtraStage::gunzip:
+			return std::unique_ptr<Codec>(new InflateStage(true));
+	}
+	return nullptr;
+}
+
+// Stage indexes of the names in stages, blanks around the names ignored
+bool parseStages(const std::string& stages, std::vector<size_t>& indexes, std::string& errorMessage)
+{
+	indexes.clear();
+	size_t pos = 0;
+	for (;;)
+	{
+		size_t end = stages.find(PIPELINE_STAGE_SEPARATOR, pos);
+		if (end == std::string::npos)
+			end = stages.length();
+
+		size_t first = stages.find_first_not_of(" \t", pos);
+		size_t last = stages.find_last_not_of(" \t", end == 0 ? 0 : end - 1);
+		if (first == std::string::npos || first >= end || last < first)
+		{
+			bool single = end == stages.length() && indexes.empty();
+			errorMessage = single ? "The pipeline has no stage." : "The pipeline has an empty stage.";
+			return false;
+		}
+
+		std::string name = stages.substr(first, last + 1 - first);
+		size_t index = 0;
+		while (index < pipelineStageCount() && name != pipelineStageName(index))
+			++index;
+		if (index == pipelineStageCount())
+		{
+			errorMessage = "Unknown stage \"" + name + "\".";
+			return false;
+		}
+		indexes.push_back(index);
+
+		if (end == stages.length())
+			return true;
+		pos = end + 1;
+	}
+}
+
+class Pipeline : public Codec {
+public:
+	Pipeline(const std::string& stages, const CodecOptions& options)
+	{
+		std::vector<size_t> indexes;
+		if (!parseStages(stages, indexes, _message))
+		{
+			_errorMessage = _message.c_str();
+			return;
+		}
+
+		_buffers.reserve(indexes.size());
+		for (size_t index : indexes)
+		{
+			_stages.push_back(createStage(index, options));
+			_names.push_back(pipelineStageName(index));
+			_buffers.emplace_back();
+		}
+	};
+
+	bool process(const char *text, size_t length, std::string& out) override
+	{
+		if (_stages.empty())
+			return false;
+
+		for (size_t pos = 0; pos < length; pos += PIPELINE_BLOCK_SIZE)
+		{
+			if (!feed(0, text + pos, length - pos < PIPELINE_BLOCK_SIZE ? length - pos : PIPELINE_BLOCK_SIZE, out))
+				return false;
+		}
+		return true;
+	};
+
+	// Each stage is finished once all that comes out of the previous ones went through it
+	bool finish(std::string& out) override
+	{
+		if (_stages.empty())
+			return false;
+
+		size_t last = _stages.size() - 1;
+		for (size_t stage = 0; stage < last; ++stage)
+		{
+			std::string& buffer = *_buffers[stage];
+			buffer.clear();
+			if (!_stages[stage]->finish(buffer))
+				return failed(stage);
+			if (!handOn(stage + 1, buffer, out))
+				return false;
+		}
+		return _stages[last]->finish(out) || failed(last);
+	};
+
+private:
+	// Give a block to stage, then its output to the following stages; the last one writes to out
+	bool feed(size_t stage, const char *data, size_t length, std::string& out)
+	{
+		if (stage == _stages.size() - 1)
+			return _stages[stage]->process(data, length, out) || failed(stage);
+
+		std::string& buffer = *_buffers[stage];
+		buffer.clear();
+		if (!_stages[stage]->process(data, length, buffer))
+			return failed(stage);
+		return handOn(stage + 1, buffer, out);
+	};
+
+	bool handOn(size_t stage, const std::string& data, std::string& out)
+	{
+		for (size_t pos = 0; pos < data.length(); pos += PIPELINE_BLOCK_SIZE)
+		{
+			size_t length = data.length() - pos < PIPELINE_BLOCK_SIZE ? data.length() - pos : PIPELINE_BLOCK_SIZE;
+			if (!feed(stage, data.data() + pos, length, out))
+				return false;
+		}
+		return true;
+	};
+
+	bool failed(size_t stage)
+	{
+		_message = std::string(_names[stage]) + ": " + _stages[stage]->errorMessage();
+		_errorMessage = _message.c_str();
+		return false;
+	};
+
+	std::vector<std::unique_ptr<Codec>> _stages;
+	std::vector<const char *> _names;
+	std::vector<PooledString> _buffers;   // output of each stage but the last, one block at a time
+	std::string _message;
+};
+
+} // namespace
+
+size_t pipelineStageCount()
+{
+	return codecStageCount() + EXTRA_STAGE_COUNT;
+}
+
+const char *pipelineStageName(size_t index)
+{
+	if (index < codecStageCount())
+		return codecInfo(static_cast<CodecId>(index))->name;
+	return extraStageNames[index - codecStageCount()];
+}
+
+bool checkPipeline(const std::string& stages, std::string *errorMessage)
+{
+	std::vector<size_t> indexes;
+	std::string message;
+	bool ok = parseStages(stages, indexes, message);
+	if (!ok && errorMessage)
+		*errorMessage = message;
+	return ok;
+}
+
+std::unique_ptr<Codec> createPipeline(const std::string& stages, const CodecOptions& options)
+{
+	return std::unique_ptr<Codec>(new Pipeline(stages, options));
+}
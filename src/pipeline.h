@@ -0,0 +1,52 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+
+#include "codec.h"
+
+// A pipeline hands its input to the first stage in blocks of this size, and the output of
+// each stage to the next one in blocks of at most this size
+constexpr size_t PIPELINE_BLOCK_SIZE = 64 << 10;
+
+// Inflating and gunzipping stop with an error beyond this size
+constexpr size_t PIPELINE_INFLATED_SIZE_MAX = size_t(1) << 30;
+
+// Stages are separated by this character: "url-decode | base64-decode | inflate"
+constexpr char PIPELINE_STAGE_SEPARATOR = '|';
+
+// The stages a pipeline is made of: every conversion of codec.h but "pipeline", then
+// base64url-encode, base64url-decode, inflate, deflate and gunzip.
+// Numbered from 0 to pipelineStageCount() - 1.
+size_t pipelineStageCount();
+const char *pipelineStageName(size_t index);
+
+// Chain of streaming stages, a Codec itself: the output of each stage is given to the next
+// one block by block as it comes, so that no stage output is ever held whole between two
+// stages. A stage converting a whole message (SAML, Smart Decode, inflate, deflate, gunzip)
+// still keeps its own input until the end.
+// stages is a list of stage names separated by PIPELINE_STAGE_SEPARATOR; false (and
+// errorMessage set) when it names no stage or an unknown one.
+bool checkPipeline(const std::string& stages, std::string *errorMessage = nullptr);
+
+// The pipeline of stages, options given to every stage. An invalid pipeline fails on its
+// first process() or finish() call with the message of checkPipeline().
+std::unique_ptr<Codec> createPipeline(const std::string& stages, const CodecOptions& options = CodecOptions());
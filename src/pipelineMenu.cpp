@@ -0,0 +1,158 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "pipelineMenu.h"
+#include "pipeline.h"
+#include "mimeTools.h"
+
+extern NppData nppData;
+
+// GetPrivateProfileSection() fills at most this many characters
+constexpr DWORD PIPELINE_SECTION_SIZE = 32 << 10;
+
+const TCHAR PIPELINE_SECTION[] = TEXT("Pipelines");
+
+// Written when the plugin finds no mimeTools.ini
+static const char defaultPipelinesFile[] =
+	"; MIME Tools saved pipelines, one \"menu name=stages\" line each in [Pipelines].\r\n"
+	"; The stages are separated by '|', each one converting the output of the previous one;\r\n"
+	"; mimetools-cli --list-stages lists them. Read when Notepad++ starts.\r\n"
+	"[Pipelines]\r\n"
+	"Base64url Decode then gunzip=base64url-decode | gunzip\r\n"
+	"URL Decode twice=url-decode | url-decode\r\n"
+	"Quoted-printable Decode then Base64 Decode=qp-decode | base64-decode\r\n"
+	"Inflate then Base64 Encode=inflate | base64-encode-pad\r\n";
+
+struct SavedPipeline
+{
+	std::wstring name;
+	std::string stages;
+};
+
+static std::vector<SavedPipeline> g_savedPipelines;
+static TCHAR g_pipelinesPath[MAX_PATH] = {};
+
+static bool writeDefaultPipelines(const TCHAR *path)
+{
+	FILE *file = _wfopen(path, L"wb");
+	if (!file)
+		return false;
+	size_t length = sizeof(defaultPipelinesFile) - 1;
+	bool ok = fwrite(defaultPipelinesFile, 1, length, file) == length;
+	return fclose(file) == 0 && ok;
+}
+
+static std::string toUtf8(const std::wstring& text)
+{
+	int length = ::WideCharToMultiByte(CP_UTF8, 0, text.c_str(), int(text.length()), NULL, 0, NULL, NULL);
+	std::string utf8(length, '\0');
+	if (length > 0)
+		::WideCharToMultiByte(CP_UTF8, 0, text.c_str(), int(text.length()), &utf8[0], length, NULL, NULL);
+	return utf8;
+}
+
+void loadSavedPipelines()
+{
+	g_savedPipelines.clear();
+
+	TCHAR configDir[MAX_PATH] = {};
+	::SendMessage(nppData._nppHandle, NPPM_GETPLUGINSCONFIGDIR, MAX_PATH, (LPARAM)configDir);
+	if (!configDir[0] || lstrlen(configDir) + 16 >= MAX_PATH)
+		return;
+	lstrcpy(g_pipelinesPath, configDir);
+	lstrcat(g_pipelinesPath, TEXT("\\mimeTools.ini"));
+
+	if (::GetFileAttributes(g_pipelinesPath) == INVALID_FILE_ATTRIBUTES)
+		writeDefaultPipelines(g_pipelinesPath);
+
+	// "name=stages\0name=stages\0\0"
+	std::vector<TCHAR> section(PIPELINE_SECTION_SIZE);
+	DWORD length = ::GetPrivateProfileSection(PIPELINE_SECTION, section.data(), PIPELINE_SECTION_SIZE, g_pipelinesPath);
+	for (const TCHAR *line = section.data(); line < section.data() + length && *line && g_savedPipelines.size() < SAVED_PIPELINE_MAX; line += lstrlen(line) + 1)
+	{
+		std::wstring entry(line);
+		size_t equal = entry.find(TEXT('='));
+		if (equal == 0 || equal == std::wstring::npos)
+			continue;
+
+		SavedPipeline pipeline;
+		pipeline.name = entry.substr(0, equal);
+		pipeline.stages = toUtf8(entry.substr(equal + 1));
+		g_savedPipelines.push_back(pipeline);
+	}
+}
+
+size_t savedPipelineCount()
+{
+	return g_savedPipelines.size();
+}
+
+const TCHAR *savedPipelineName(size_t index)
+{
+	return g_savedPipelines[index].name.c_str();
+}
+
+static void runSavedPipeline(size_t index)
+{
+	const SavedPipeline& pipeline = g_savedPipelines[index];
+	std::string errorMessage;
+	if (!checkPipeline(pipeline.stages, &errorMessage))
+	{
+		errorMessage += "\nCorrect it in mimeTools.ini (\"Edit saved pipelines\") and restart Notepad++.";
+		::MessageBoxA(nppData._nppHandle, errorMessage.c_str(), "Pipeline", MB_OK);
+		return;
+	}
+	convertPipeline(pipeline.stages);
+}
+
+// A menu command is a function without parameter: one per place in the menu
+template <size_t index>
+static void runSavedPipelineCommand()
+{
+	runSavedPipeline(index);
+}
+
+static const PFUNCPLUGINCMD savedPipelineCommands[SAVED_PIPELINE_MAX] = {
+	runSavedPipelineCommand<0>,  runSavedPipelineCommand<1>,  runSavedPipelineCommand<2>,  runSavedPipelineCommand<3>,
+	runSavedPipelineCommand<4>,  runSavedPipelineCommand<5>,  runSavedPipelineCommand<6>,  runSavedPipelineCommand<7>,
+	runSavedPipelineCommand<8>,  runSavedPipelineCommand<9>,  runSavedPipelineCommand<10>, runSavedPipelineCommand<11>,
+	runSavedPipelineCommand<12>, runSavedPipelineCommand<13>, runSavedPipelineCommand<14>, runSavedPipelineCommand<15>
+};
+
+PFUNCPLUGINCMD savedPipelineCommand(size_t index)
+{
+	return savedPipelineCommands[index];
+}
+
+void editSavedPipelines()
+{
+	if (!g_pipelinesPath[0])
+	{
+		::MessageBox(nppData._nppHandle, TEXT("The plugins config directory is unknown."), TEXT("Pipeline"), MB_OK);
+		return;
+	}
+	if (::GetFileAttributes(g_pipelinesPath) == INVALID_FILE_ATTRIBUTES && !writeDefaultPipelines(g_pipelinesPath))
+	{
+		::MessageBox(nppData._nppHandle, TEXT("mimeTools.ini could not be written."), TEXT("Pipeline"), MB_OK);
+		return;
+	}
+	::SendMessage(nppData._nppHandle, NPPM_DOOPEN, 0, (LPARAM)g_pipelinesPath);
+}
@@ -0,0 +1,41 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <windows.h>
+
+#include "PluginInterface.h"
+
+// At most this many saved pipelines appear as menu commands
+constexpr size_t SAVED_PIPELINE_MAX = 16;
+
+// Saved pipelines (see pipeline.h) are the "menu name=stages" lines of the [Pipelines] section
+// of mimeTools.ini, in the plugins config directory. The file is read once, as the menu is
+// built: a pipeline added or changed there appears when Notepad++ starts again.
+
+// Read the saved pipelines, first writing the file with a few examples if there is none
+void loadSavedPipelines();
+
+size_t savedPipelineCount();
+const TCHAR *savedPipelineName(size_t index);
+
+// The menu command that runs saved pipeline index on the selection, like any conversion
+PFUNCPLUGINCMD savedPipelineCommand(size_t index);
+
+// Open mimeTools.ini in Notepad++
+void editSavedPipelines();
@@ -23,13 +23,16 @@ char * QuotedPrintable::encode(const char *str)
 	initVar();
 	size_t len = strlen(str);
 	
+	// Every char takes at most 3 bytes, and a soft line break "=\r\n" follows at least
+	// QP_ENCODED_LINE_LEN_MAX - 3 encoded bytes: this bound is never exceeded
 	_bufLen = len * 3;
-	size_t nbEOL = _bufLen / QP_ENCODED_LINE_LEN_MAX;
+	size_t nbEOL = _bufLen / (QP_ENCODED_LINE_LEN_MAX - 3) + 1;
 	_bufLen += nbEOL * 3;
 	_bufLen += 1;
 
-	_buffer = new char[_bufLen];
-	memset(_buffer, 0, _bufLen);
+	_storage.reserve(_bufLen);
+	_storage->assign(_bufLen, '\0');
+	_buffer = &(*_storage)[0];
 	
 	for (size_t i = 0 ; i < len ; i++)
 	{
@@ -44,7 +47,7 @@ char * QuotedPrintable::encode(const char *str)
 void QuotedPrintable::getQPChar(char c)
 {
 	bool crlf = false;
-	if ((c != '=' && c > 32 && c < 127) || c == ' ' || c == '	' || (UCHAR)c == 0x0D)
+	if ((c != '=' && c > 32 && c < 127) || c == ' ' || c == '	' || (unsigned char)c == 0x0D)
 	{
 		_chars[0] = c;
 		_nbChar = 1;
@@ -57,7 +60,7 @@ void QuotedPrintable::getQPChar(char c)
 	}
 	else
 	{
-		UCHAR uc = (UCHAR)c;
+		unsigned char uc = (unsigned char)c;
 		_chars[0] = '=';
 		_chars[1] = toChar(uc >> 4);
 		_chars[2] = toChar(uc & 15);
@@ -78,6 +81,7 @@ void QuotedPrintable::getQPChar(char c)
 	// ref: https://en.wikipedia.org/wiki/Quoted-printable
 	if (_nbCharInLine >= QP_ENCODED_LINE_LEN_MAX)
 	{
+		ensureRoom(3);
 		_buffer[_i++] = '=';
 		_buffer[_i++] = 0x0D;
 		_buffer[_i++] = 0x0A;
@@ -86,22 +90,23 @@ void QuotedPrintable::getQPChar(char c)
 
 }
 	
-void QuotedPrintable::putQPChar() 
+// Grow the buffer so that n more bytes and the final null fit.
+// Encoding reserves enough from the start, this only guards against a wrong estimate.
+void QuotedPrintable::ensureRoom(size_t n)
 {
-	// it happens rarely, but it happens
-	if (_i >= _bufLen)
-	{
-		size_t oldLen = _bufLen;
+	if (_i + n < _bufLen)
+		return;
+
+	while (_i + n >= _bufLen)
 		_bufLen *= 2;
-		char *newBuf = new char[_bufLen];
-		
-		for (size_t i = 0 ; i < oldLen ; i++)
-			newBuf[i] = _buffer[i];
-
-		char *tmp = _buffer;
-		_buffer = newBuf;
-		delete [] tmp;
-	}
+	_storage.reserve(_bufLen);
+	_storage->resize(_bufLen);
+	_buffer = &(*_storage)[0];
+}
+
+void QuotedPrintable::putQPChar() 
+{
+	ensureRoom(_nbChar);
 
 	for (int i = 0 ; i < _nbChar ; i++)
 		_buffer[_i++] = _chars[i];
@@ -113,33 +118,33 @@ char * QuotedPrintable::decode(const char *str)
 	
 	char *p = (char *)str;
 	size_t len = strlen(str);
+	const char *end = str + len;
 	
 	_bufLen = len + 1;
-	_buffer = new char[_bufLen];
-	char* line = new char[_bufLen];
+	_storage.reserve(_bufLen);
+	_storage->resize(_bufLen);
+	_buffer = &(*_storage)[0];
+	PooledString lineStorage(_bufLen);
+	lineStorage->resize(_bufLen);
+	char *line = &(*lineStorage)[0];
 
 	while (*p)
 	{
-		if (readQPLine(&p, line) == -1)
-		{
-			delete [] line;
+		int lineLen = readQPLine(&p, end, line);
+		if (lineLen == -1)
 			return NULL;
-		}
 
-		if (!translate(line))
-		{
-			delete[] line;
+		if (!translate(line, size_t(lineLen)))
 			return NULL;
-		}
 	}
 	_buffer[_i] = '\0';
-	delete[] line;
 	return _buffer;
 }
 
-int QuotedPrintable::readQPLine(char **pStr, char *lineBuf) 
+// The remaining length is given by end: a strlen here, once per line, made decoding quadratic
+int QuotedPrintable::readQPLine(char **pStr, const char *end, char *lineBuf) 
 {
-	size_t len = strlen(*pStr);
+	size_t len = end - *pStr;
 	size_t i = 0;
 	for (; i < len ; i++)
 	{
@@ -193,16 +198,15 @@ int QuotedPrintable::readQPLine(char **pStr, char *lineBuf)
 	return int(i);
 }
 
-bool QuotedPrintable::translate(char *line2Trans) 
+bool QuotedPrintable::translate(const char *line2Trans, size_t len) 
 {
-	size_t len = strlen(line2Trans);
 	for (size_t i = 0 ; i < len ; i++)
 	{
 		if (line2Trans[i] == '=')
 		{
 			if (i == len || (i + 1) == len|| (i + 2) == len)
 				return false;
-			UCHAR restoredChar;
+			unsigned char restoredChar;
 			//
 			
 			restoredChar = makeChar(line2Trans[i+1], line2Trans[i+2]);
@@ -19,7 +19,8 @@
 
 #include <stdint.h>
 #include <stdio.h>
-#include <windows.h>
+
+#include "bufferPool.h"
 
 // "QP works by using the equals sign = as an escape character.It also limits line length to 76, as some software has limits on line length."
 // ref: https://en.wikipedia.org/wiki/Quoted-printable
@@ -29,14 +30,11 @@ class QuotedPrintable {
 
 public:	
 	QuotedPrintable() : _buffer(NULL) {};
-	~QuotedPrintable() {
-		if (_buffer)
-			delete [] _buffer; 
-	};
 	char * encode(const char *str);
 	char * decode(const char *str);
 
 private:
+	PooledString _storage;     // _buffer points into it
 	char *_buffer = nullptr;
 	size_t _bufLen = 0;
 	size_t _i = 0;
@@ -45,9 +43,10 @@ private:
 	int _nbChar = 0;
 	char _chars[4] = {};
 
-	int readQPLine(char **pStr, char *lineBuf);
-	bool translate(char *line2Trans);
+	int readQPLine(char **pStr, const char *end, char *lineBuf);
+	bool translate(const char *line2Trans, size_t len);
 
+	void ensureRoom(size_t n);
 	void putQPChar();
 	void getQPChar(char c);
 	
@@ -71,11 +70,8 @@ private:
 
 
 	void initVar() {
-		if (_buffer)
-		{
-			delete [] _buffer;
-			_buffer = NULL;
-		}
+		_storage->clear();
+		_buffer = NULL;
 		_bufLen = 0; 
 		_i = 0;
 		_nbChar = 0;
@@ -15,83 +15,513 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 
+#include <string.h>
+
 #include "saml.h"
 #include "b64.h"
+#include "bufferPool.h"
 #include "url.h"
 #include "tinf.h"
+#include "tdef.h"
+#include "parallel.h"
+#include "parallelInflate.h"
+#include "trace.h"
 
 
-int samlDecode(char *dest, const char *encodedSamlStr, int bufLength)
+// Returns true if text starts like "<?xml" or "<saml"
+static bool looksLikeSamlXml(const char *text, size_t length)
 {
-  char *pUrlDecodedText = new char[bufLength];
-	
-  memset(dest, 0, SAML_MESSAGE_MAX_SIZE);
-  memset(pUrlDecodedText, 0, bufLength);
+  return length >= 5 && text[0] == '<' && text[3] == 'm' && text[4] == 'l';
+}
 
+int samlDecode(std::string &xml, const char *encodedSamlStr, size_t encodedLength, size_t maxLength)
+{
+  xml.clear();
 
-  // URL Decode
-  size_t urlDecodedLen = UrlToAscii(pUrlDecodedText, encodedSamlStr, bufLength);
+  // UrlToAscii needs a null terminated string
+  PooledString encoded(encodedLength + 1);
+  encoded->assign(encodedSamlStr, encodedLength);
+  PooledString urlDecodedText(encodedLength + 1);
+  urlDecodedText->resize(encodedLength + 1);
 
-  if (urlDecodedLen < 0)
+  // URL Decode
+  int urlDecodedLen;
   {
-    delete [] pUrlDecodedText;
-	return SAML_DECODE_ERROR_URLDECODE;
+	TRACE_SPAN_BYTES("saml url decode", encodedLength);
+	urlDecodedLen = UrlToAscii(&(*urlDecodedText)[0], encoded->c_str(), int(encodedLength + 1));
   }
 
-  char *base64DecodedText = new char[urlDecodedLen + 1];
+  if (urlDecodedLen < 0)
+	return SAML_DECODE_ERROR_URLDECODE;
 
-  int base64DecodedLen = base64Decode(base64DecodedText, pUrlDecodedText, urlDecodedLen, true, false);
+  PooledString base64DecodedText(urlDecodedLen + 1);
+  base64DecodedText->resize(urlDecodedLen + 1);
 
-  delete[] pUrlDecodedText;
+  int base64DecodedLen;
+  {
+	TRACE_SPAN_BYTES("saml base64 decode", urlDecodedLen);
+	base64DecodedLen = base64Decode(&(*base64DecodedText)[0], urlDecodedText->c_str(), urlDecodedLen, true, false);
+  }
 
   if (base64DecodedLen < 0)
-		return SAML_DECODE_ERROR_BASE64DECODE;
-
-  base64DecodedText[base64DecodedLen] = '\0';
-
+	return SAML_DECODE_ERROR_BASE64DECODE;
 
   // A SAML message should be longer than 10 chars
   if (base64DecodedLen < 10)
-  {
-	delete [] base64DecodedText;
 	return SAML_DECODE_ERROR_BASE64DECODE;
-  }
 
   // If the first 5 chars are "<?xml" or "<saml", no need to inflate
-  if (   (base64DecodedText[0] == '<')
-	  && (base64DecodedText[3] == 'm')
-	  && (base64DecodedText[4] == 'l'))
+  if (looksLikeSamlXml(base64DecodedText->c_str(), base64DecodedLen))
   {
-	memcpy(dest, base64DecodedText, base64DecodedLen);
-	delete [] base64DecodedText;
+	if (maxLength && size_t(base64DecodedLen) > maxLength)
+	  base64DecodedLen = int(maxLength);
+	xml.assign(base64DecodedText->c_str(), base64DecodedLen);
     return int(base64DecodedLen);
   }
-  
 
-  // Inflate the Base64 decoded text
-  char *inflatedText = new char[SAML_MESSAGE_MAX_SIZE];
-  unsigned int inflatedTextLen = 0;
-  
-  tinf_init();
-  int inflateReturnCode = tinf_uncompress(inflatedText, &inflatedTextLen, base64DecodedText);
-  delete [] base64DecodedText;
+  // tinf_init() fills global tables: do it once so that decoding can run on several threads
+  static const bool tinfInitialized = (tinf_init(), true);
+  (void)tinfInitialized;
+
+  TRACE_SPAN_BYTES("saml inflate", base64DecodedLen);
+
+  // Large payloads are inflated on all cores
+  if (!maxLength && size_t(base64DecodedLen) >= 2 * PARALLEL_INFLATE_CHUNK_MIN)
+  {
+	if (parallelInflate(xml, base64DecodedText->c_str(), base64DecodedLen, SAML_INFLATED_SIZE_MAX) != TINF_OK)
+	  return SAML_DECODE_ERROR_INFLATE;
+	return looksLikeSamlXml(xml.c_str(), xml.length()) ? int(xml.length()) : SAML_DECODE_ERROR_INFLATE;
+  }
+
+  // Inflate the Base64 decoded text, growing the output until it fits
+  size_t capacity = size_t(base64DecodedLen) * 8 + 4096;
+  if (maxLength)
+	capacity = maxLength;
+  int inflateReturnCode;
+  unsigned int inflatedTextLen;
+  do
+  {
+	xml.resize(capacity);
+	inflatedTextLen = (unsigned int)capacity;
+	inflateReturnCode = tinf_uncompress(&xml[0], &inflatedTextLen, base64DecodedText->c_str(), base64DecodedLen);
+	capacity *= 2;
+  } while (inflateReturnCode == TINF_BUF_ERROR && !maxLength && capacity <= SAML_INFLATED_SIZE_MAX);
+
+  // the first maxLength bytes are all that was asked for
+  if (inflateReturnCode == TINF_BUF_ERROR && maxLength && inflatedTextLen > 0)
+	inflateReturnCode = TINF_OK;
 
   if (inflateReturnCode != TINF_OK)
   {
-	delete [] inflatedText;
+	xml.clear();
 	return SAML_DECODE_ERROR_INFLATE;
   }
-  
-  memcpy(dest, inflatedText, inflatedTextLen);
-  delete [] inflatedText;
-  
+  xml.resize(inflatedTextLen);
+
   // If the first 5 chars are not "<?xml" or "<saml", there's a problem
-  if (!( (dest[0] == '<')
-	  && (dest[3] == 'm')
-	  && (dest[4] == 'l')))
+  if (!looksLikeSamlXml(xml.c_str(), xml.length()))
   {
 	  return SAML_DECODE_ERROR_INFLATE;
   }
   return int(inflatedTextLen);
-  
-}
\ No newline at end of file
+}
+
+int samlDecode(char *dest, const char *encodedSamlStr, int bufLength)
+{
+  *dest = '\0';
+
+  size_t encodedLength = 0;
+  while (encodedLength < size_t(bufLength) && encodedSamlStr[encodedLength])
+	++encodedLength;
+
+  PooledString xml;
+  int len = samlDecode(*xml, encodedSamlStr, encodedLength);
+  if (len <= 0)
+	return len;
+
+  if (xml->length() > SAML_MESSAGE_MAX_SIZE)
+	return SAML_DECODE_ERROR_INFLATE;
+
+  // only the message and its terminator are written, not the whole buffer
+  memcpy(dest, xml->c_str(), xml->length());
+  if (xml->length() < SAML_MESSAGE_MAX_SIZE)
+	dest[xml->length()] = '\0';
+  return len;
+}
+
+size_t samlEncodeBufferLength(size_t xmlLength)
+{
+  if (xmlLength > SAML_ENCODE_LENGTH_MAX)
+    return 0;
+
+  // deflate worst case, times 4/3 for base64, times 3 if every character gets URL encoded
+  return (size_t(tdef_bound((unsigned int)xmlLength)) + 2) / 3 * 4 * 3 + 1;
+}
+
+int samlEncode(char *dest, const char *xmlStr, size_t xmlLength, int level)
+{
+  if (xmlLength > SAML_ENCODE_LENGTH_MAX)
+    return SAML_ENCODE_ERROR_TOO_LARGE;
+
+  // Deflate the XML
+  unsigned int deflatedLen = tdef_bound((unsigned int)xmlLength);
+  PooledString deflatedText(deflatedLen);
+  deflatedText->resize(deflatedLen);
+
+  int deflateReturnCode;
+  {
+	TRACE_SPAN_BYTES("saml deflate", xmlLength);
+	deflateReturnCode = tdef_compress(&(*deflatedText)[0], &deflatedLen, xmlStr, (unsigned int)xmlLength, level);
+  }
+  if (deflateReturnCode != TDEF_OK)
+	return SAML_ENCODE_ERROR_DEFLATE;
+
+  // BASE64 Encode the deflated data, padded as the Redirect binding expects
+  PooledString base64EncodedText((deflatedLen + 2) / 3 * 4 + 1);
+  base64EncodedText->resize((deflatedLen + 2) / 3 * 4 + 1);
+  int base64EncodedLen;
+  {
+	TRACE_SPAN_BYTES("saml base64 encode", deflatedLen);
+	base64EncodedLen = base64Encode(&(*base64EncodedText)[0], deflatedText->data(), deflatedLen, 0, true, false);
+  }
+  (*base64EncodedText)[base64EncodedLen] = '\0';
+
+  // URL Encode, "extended" so that '+' is escaped as well
+  int len;
+  {
+	TRACE_SPAN_BYTES("saml url encode", base64EncodedLen);
+	len = AsciiToUrl(dest, base64EncodedText->c_str(), base64EncodedLen * 3 + 1, UrlEncodeMethod::extended);
+  }
+  return len;
+}
+
+
+const char *samlDecodeErrorMessage(int result)
+{
+  switch (result)
+  {
+    case 0:
+      return "SAML Decode returned zero size.";
+    case SAML_DECODE_ERROR_URLDECODE:
+      return "Could not URL Decode text.";
+    case SAML_DECODE_ERROR_BASE64DECODE:
+      return "Could not BASE64 Decode text after URL Decoding.";
+    case SAML_DECODE_ERROR_INFLATE:
+      return "Could not inflate text after BASE64 Decoding.";
+    default:
+      return "";
+  }
+}
+
+// Characters a URL encoded (or raw) base64 parameter value can be made of
+static bool isSamlValueChar(char c)
+{
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+      || c == '%' || c == '+' || c == '/' || c == '=' || c == '-' || c == '_' || c == '.';
+}
+
+std::vector<SamlMatch> samlFindAll(const char *text, size_t textLength)
+{
+  static const char samlPrefix[] = "SAML";
+  static const char requestParam[] = "Request=";
+  static const char responseParam[] = "Response=";
+
+  std::vector<SamlMatch> matches;
+  const char *end = text + textLength;
+  const char *lineCounted = text;
+  size_t line = 0;
+
+  for (const char *p = text; end - p > 4; )
+  {
+    const char *found = static_cast<const char *>(memchr(p, 'S', end - p));
+    if (!found)
+      break;
+    p = found + 1;
+
+    if (size_t(end - found) < sizeof(samlPrefix) - 1 || memcmp(found, samlPrefix, sizeof(samlPrefix) - 1) != 0)
+      continue;
+
+    const char *param = found + sizeof(samlPrefix) - 1;
+    size_t paramLength;
+    bool isResponse;
+    if (size_t(end - param) >= sizeof(requestParam) - 1 && memcmp(param, requestParam, sizeof(requestParam) - 1) == 0)
+    {
+      paramLength = sizeof(requestParam) - 1;
+      isResponse = false;
+    }
+    else if (size_t(end - param) >= sizeof(responseParam) - 1 && memcmp(param, responseParam, sizeof(responseParam) - 1) == 0)
+    {
+      paramLength = sizeof(responseParam) - 1;
+      isResponse = true;
+    }
+    else
+      continue;
+
+    const char *value = param + paramLength;
+    const char *valueEnd = value;
+    while (valueEnd < end && isSamlValueChar(*valueEnd))
+      ++valueEnd;
+    if (valueEnd == value)
+      continue;
+
+    // count lines incrementally, so the whole scan stays linear
+    for (const char *nl; (nl = static_cast<const char *>(memchr(lineCounted, '\n', value - lineCounted))) != nullptr; lineCounted = nl + 1)
+      ++line;
+    lineCounted = value;
+
+    SamlMatch match;
+    match.offset = value - text;
+    match.length = valueEnd - value;
+    match.line = line;
+    match.isResponse = isResponse;
+    matches.push_back(match);
+
+    p = valueEnd;
+  }
+  return matches;
+}
+
+void SamlCollector::add(const char *text, size_t textLength, size_t firstLine)
+{
+  std::vector<SamlMatch> matches;
+  {
+    TRACE_SPAN_BYTES("saml find", textLength);
+    matches = samlFindAll(text, textLength);
+  }
+
+  // Identical payloads (the same request logged by several proxies) are decoded only once
+  for (const SamlMatch& match : matches)
+  {
+    std::string payload(text + match.offset, match.length);
+    auto inserted = _payloadIndex.emplace(payload, _payloads.size());
+    if (inserted.second)
+    {
+      _payloads.push_back(std::move(payload));
+      _results.emplace_back();
+      _results.back().isResponse = match.isResponse;
+    }
+    std::vector<size_t>& lines = _results[inserted.first->second].lines;
+    if (lines.empty() || lines.back() != firstLine + match.line)
+      lines.push_back(firstLine + match.line);
+  }
+}
+
+std::vector<SamlDecoded> SamlCollector::decodeAll()
+{
+  parallelFor(_payloads.size(), [&](size_t i)
+  {
+    _results[i].result = samlDecode(_results[i].xml, _payloads[i].c_str(), _payloads[i].length());
+  });
+
+  std::vector<SamlDecoded> results = std::move(_results);
+  _payloads.clear();
+  _results.clear();
+  _payloadIndex.clear();
+  return results;
+}
+
+std::vector<SamlDecoded> samlDecodeAll(const char *text, size_t textLength)
+{
+  SamlCollector collector;
+  collector.add(text, textLength);
+  return collector.decodeAll();
+}
+
+static bool isXmlSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool isNameEnd(char c)
+{
+  return isXmlSpace(c) || c == '/' || c == '>' || c == '=';
+}
+
+static bool nameIs(const char *name, size_t nameLength, const char *expected)
+{
+  size_t expectedLength = strlen(expected);
+  return nameLength == expectedLength && memcmp(name, expected, nameLength) == 0;
+}
+
+// Returns the position following the end of the markup starting at p ("-->" for instance), or end
+static const char *skipPast(const char *p, const char *end, const char *terminator)
+{
+  size_t terminatorLength = strlen(terminator);
+  while (size_t(end - p) >= terminatorLength)
+  {
+    const char *found = static_cast<const char *>(memchr(p, terminator[0], end - p - terminatorLength + 1));
+    if (!found)
+      break;
+    if (memcmp(found, terminator, terminatorLength) == 0)
+      return found + terminatorLength;
+    p = found + 1;
+  }
+  return end;
+}
+
+std::vector<SamlField> samlIndexFields(const char *xml, size_t xmlLength)
+{
+  enum ElementKind { other, issuer, nameId, audience, conditions, subjectConfirmationData, attribute, signature, x509Certificate };
+
+  std::vector<SamlField> fields;
+  const char *end = xml + xmlLength;
+
+  for (const char *p = xml; p < end; )
+  {
+    const char *tag = static_cast<const char *>(memchr(p, '<', end - p));
+    if (!tag || end - tag < 2)
+      break;
+    p = tag + 1;
+
+    if (*p == '/')
+      continue;
+    if (*p == '?')
+    {
+      p = skipPast(p, end, "?>");
+      continue;
+    }
+    if (*p == '!')
+    {
+      if (end - p >= 3 && memcmp(p, "!--", 3) == 0)
+        p = skipPast(p, end, "-->");
+      else if (end - p >= 8 && memcmp(p, "![CDATA[", 8) == 0)
+        p = skipPast(p, end, "]]>");
+      continue;
+    }
+
+    // element name, without its namespace prefix
+    const char *name = p;
+    while (p < end && !isNameEnd(*p))
+    {
+      if (*p == ':')
+        name = p + 1;
+      ++p;
+    }
+    size_t nameLength = p - name;
+
+    ElementKind kind = other;
+    switch (nameLength ? *name : 0)
+    {
+      case 'A':
+        if (nameIs(name, nameLength, "Audience")) kind = audience;
+        else if (nameIs(name, nameLength, "Attribute")) kind = attribute;
+        break;
+      case 'C':
+        if (nameIs(name, nameLength, "Conditions")) kind = conditions;
+        break;
+      case 'I':
+        if (nameIs(name, nameLength, "Issuer")) kind = issuer;
+        break;
+      case 'N':
+        if (nameIs(name, nameLength, "NameID")) kind = nameId;
+        break;
+      case 'S':
+        if (nameIs(name, nameLength, "Signature")) kind = signature;
+        else if (nameIs(name, nameLength, "SubjectConfirmationData")) kind = subjectConfirmationData;
+        break;
+      case 'X':
+        if (nameIs(name, nameLength, "X509Certificate")) kind = x509Certificate;
+        break;
+    }
+
+    if (kind == signature || kind == x509Certificate)
+    {
+      SamlField field;
+      field.name = kind == signature ? "Signature" : "X509Certificate";
+      field.offset = tag - xml;
+      fields.push_back(field);
+    }
+
+    // '<' is not allowed in attribute values nor in text: the rest of an element
+    // without fields is skipped by looking for the next '<'
+    if (kind == other || kind == signature || kind == x509Certificate)
+      continue;
+
+    // attributes, up to the end of the tag ('>' may appear in a quoted value)
+    bool selfClosing = false;
+    while (p < end && *p != '>')
+    {
+      if (isXmlSpace(*p))
+      {
+        ++p;
+        continue;
+      }
+      if (*p == '/')
+      {
+        selfClosing = true;
+        ++p;
+        continue;
+      }
+      selfClosing = false;
+
+      const char *attrName = p;
+      while (p < end && !isNameEnd(*p))
+      {
+        if (*p == ':')
+          attrName = p + 1;
+        ++p;
+      }
+      size_t attrNameLength = p - attrName;
+
+      while (p < end && isXmlSpace(*p))
+        ++p;
+      if (p == end || *p != '=')
+        continue;
+      ++p;
+      while (p < end && isXmlSpace(*p))
+        ++p;
+      if (p == end || (*p != '"' && *p != '\''))
+        continue;
+
+      const char *value = p + 1;
+      const char *valueEnd = static_cast<const char *>(memchr(value, *p, end - value));
+      if (!valueEnd)
+        valueEnd = end;
+      p = valueEnd < end ? valueEnd + 1 : end;
+
+      const char *fieldName = nullptr;
+      if (kind == conditions || kind == subjectConfirmationData)
+      {
+        if (nameIs(attrName, attrNameLength, "NotBefore"))
+          fieldName = kind == conditions ? "Conditions/@NotBefore" : "SubjectConfirmationData/@NotBefore";
+        else if (nameIs(attrName, attrNameLength, "NotOnOrAfter"))
+          fieldName = kind == conditions ? "Conditions/@NotOnOrAfter" : "SubjectConfirmationData/@NotOnOrAfter";
+      }
+      else if (kind == attribute && nameIs(attrName, attrNameLength, "Name"))
+        fieldName = "Attribute/@Name";
+
+      if (fieldName)
+      {
+        SamlField field;
+        field.name = fieldName;
+        field.value.assign(value, valueEnd - value);
+        field.offset = value - xml;
+        fields.push_back(field);
+      }
+    }
+    if (p < end)
+      ++p;
+
+    if (!selfClosing && (kind == issuer || kind == nameId || kind == audience))
+    {
+      // text content, trimmed
+      const char *textEnd = static_cast<const char *>(memchr(p, '<', end - p));
+      if (!textEnd)
+        textEnd = end;
+      const char *text = p;
+      while (text < textEnd && isXmlSpace(*text))
+        ++text;
+      const char *trimmedEnd = textEnd;
+      while (trimmedEnd > text && isXmlSpace(trimmedEnd[-1]))
+        --trimmedEnd;
+
+      SamlField field;
+      field.name = kind == issuer ? "Issuer" : (kind == nameId ? "NameID" : "Audience");
+      field.value.assign(text, trimmedEnd - text);
+      field.offset = text - xml;
+      fields.push_back(field);
+      p = textEnd;
+    }
+  }
+  return fields;
+}
@@ -16,15 +16,91 @@
 
 #pragma once
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "b64.h"
 #include "url.h"
+#include "tdef.h"
 
 constexpr int SAML_DECODE_ERROR_URLDECODE = -1;
 constexpr int SAML_DECODE_ERROR_BASE64DECODE = -2;
 constexpr int SAML_DECODE_ERROR_INFLATE = -3;
+constexpr int SAML_ENCODE_ERROR_DEFLATE = -4;
+constexpr int SAML_ENCODE_ERROR_TOO_LARGE = -5;
 
 
 constexpr int SAML_MESSAGE_MAX_SIZE = 200000;
 
+// Inflating stops (with SAML_DECODE_ERROR_INFLATE) beyond this size
+constexpr size_t SAML_INFLATED_SIZE_MAX = size_t(1) << 30;
+
+// dest must hold SAML_MESSAGE_MAX_SIZE bytes, larger messages are rejected
 int samlDecode(char *dest, const char *samlStr, int bufLength);
 
+// Same without size limit: xml receives the decoded message. With a maxLength, inflating
+// stops there and xml receives the first maxLength bytes of the message.
+int samlDecode(std::string &xml, const char *samlStr, size_t samlLength, size_t maxLength = 0);
+
+// A SAMLRequest= or SAMLResponse= parameter value found in a text
+struct SamlMatch
+{
+	size_t offset = 0;       // offset of the value (just after '=')
+	size_t length = 0;
+	size_t line = 0;         // 0 based line of the value
+	bool isResponse = false;
+};
+
+// One distinct payload: identical values found on several lines are decoded once
+struct SamlDecoded
+{
+	std::vector<size_t> lines;
+	bool isResponse = false;
+	int result = 0;          // samlDecode() return value
+	std::string xml;
+};
+
+const char *samlDecodeErrorMessage(int result);
+std::vector<SamlMatch> samlFindAll(const char *text, size_t textLength);
+std::vector<SamlDecoded> samlDecodeAll(const char *text, size_t textLength);
+
+// samlDecodeAll() over a text read in pieces (a file, view by view). Each piece must hold
+// whole lines, so that no value is cut: firstLine is the 0 based line it starts at.
+// Identical payloads are kept once across pieces, decodeAll() decodes them concurrently.
+class SamlCollector {
+public:
+  void add(const char *text, size_t textLength, size_t firstLine = 0);
+  std::vector<SamlDecoded> decodeAll();
+
+private:
+  std::vector<std::string> _payloads;
+  std::vector<SamlDecoded> _results;
+  std::unordered_map<std::string, size_t> _payloadIndex;
+};
+
+// A field found by samlIndexFields()
+struct SamlField
+{
+	const char *name = "";   // "Issuer", "NameID", "Audience", "Conditions/@NotBefore", "Attribute/@Name"...
+	std::string value;       // element text or attribute value, as written (entities are not expanded)
+	size_t offset = 0;       // byte offset of the value in the XML (of the '<' for Signature / X509Certificate)
+};
+
+// Index the few fields needed to triage a SAML message, in document order:
+// Issuer, NameID, Audience (text), NotBefore / NotOnOrAfter of Conditions and
+// SubjectConfirmationData, Name of each Attribute, and where Signature and
+// X509Certificate elements start. Namespace prefixes are ignored.
+// Single forward scan over the XML, no tree is built.
+std::vector<SamlField> samlIndexFields(const char *xml, size_t xmlLength);
+
+// Larger XML is rejected with SAML_ENCODE_ERROR_TOO_LARGE, so that the encoded length
+// (up to 4 times the XML) still fits an int
+constexpr size_t SAML_ENCODE_LENGTH_MAX = 256 << 20;
+
+// Redirect binding encoding: raw deflate, then base64, then URL encode.
+// dest must hold at least samlEncodeBufferLength(xmlLength) bytes, which is 0 when the
+// XML is too large.
+size_t samlEncodeBufferLength(size_t xmlLength);
+int samlEncode(char *dest, const char *xmlStr, size_t xmlLength, int level = TDEF_LEVEL_DEFAULT);
+
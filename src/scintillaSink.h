@@ -0,0 +1,50 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stdint.h>
+#include <windows.h>
+
+#include "sink.h"
+#include "Scintilla.h"
+#include "trace.h"
+
+// Appends the output to the document of a Scintilla view, SINK_STAGING_SIZE bytes at a time.
+// The time spent in SCI_APPENDTEXT is kept apart from the conversion time.
+class ScintillaSink : public StagedSink<ScintillaSink> {
+public:
+	explicit ScintillaSink(HWND hScintilla) : _hScintilla(hScintilla) {};
+	~ScintillaSink() { flush(); };
+
+	bool writeStaged(const char *data, size_t n)
+	{
+		uint64_t startNs = traceNowNs();
+		::SendMessage(_hScintilla, SCI_APPENDTEXT, n, (LPARAM)data);
+		_writeNs += traceNowNs() - startNs;
+		_written += n;
+		return true;
+	};
+
+	uint64_t writeNs() const { return _writeNs; };
+	uint64_t written() const { return _written; };
+
+private:
+	HWND _hScintilla;
+	uint64_t _writeNs = 0;
+	uint64_t _written = 0;
+};
@@ -0,0 +1,146 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// Size of the staging buffer of the sinks that copy the output somewhere else,
+// and the most a kernel asks for at once
+constexpr size_t SINK_STAGING_SIZE = 64 << 10;
+
+// Sinks receive the output of the kernels (see base64Sink.h) and of convertTo() (see codec.h).
+// A sink is a template parameter, not a base class: nothing is virtual, the calls are inlined.
+// Every sink has:
+//
+//	RESERVE_MAX                                the most reserve() takes
+//	char *reserve(size_t n)                    room for n bytes, n <= RESERVE_MAX
+//	void commit(size_t n)                      the first n bytes of that room were written
+//	void append(const char *data, size_t n)    copy data, of any length
+//	bool flush()                               pass on what is staged; false once writing failed
+//
+// A kernel writes straight into the room it reserves: into the string itself for StringSink,
+// in a single block, into the staging buffer for the others, which pass it on
+// SINK_STAGING_SIZE bytes at a time.
+
+// Appends to a growing string, which is the one-shot output
+class StringSink {
+public:
+	static constexpr size_t RESERVE_MAX = size_t(-1);
+
+	explicit StringSink(std::string& out) : _out(out) {};
+
+	char *reserve(size_t n)
+	{
+		_committed = _out.length();
+		_out.resize(_committed + n);
+		return &_out[_committed];
+	};
+
+	void commit(size_t n) { _out.resize(_committed + n); };
+	void append(const char *data, size_t n) { _out.append(data, n); };
+	bool flush() { return true; };
+
+	std::string& string() { return _out; };
+
+private:
+	std::string& _out;
+	size_t _committed = 0;
+};
+
+// Only counts the bytes, to size an output before producing it
+class CountingSink {
+public:
+	static constexpr size_t RESERVE_MAX = SINK_STAGING_SIZE;
+
+	char *reserve(size_t /*n*/) { return _scratch; };
+	void commit(size_t n) { _count += n; };
+	void append(const char * /*data*/, size_t n) { _count += n; };
+	bool flush() { return true; };
+
+	uint64_t count() const { return _count; };
+
+private:
+	char _scratch[SINK_STAGING_SIZE];
+	uint64_t _count = 0;
+};
+
+// Base of the sinks that pass the output on through Derived::writeStaged(data, n), which
+// returns false on error. Appending SINK_STAGING_SIZE bytes or more bypasses the staging buffer.
+// Derived must flush() before it is destroyed.
+template <typename Derived>
+class StagedSink {
+public:
+	static constexpr size_t RESERVE_MAX = SINK_STAGING_SIZE;
+
+	char *reserve(size_t n)
+	{
+		if (SINK_STAGING_SIZE - _used < n)
+			flush();
+		return _staging + _used;
+	};
+
+	void commit(size_t n) { _used += n; };
+
+	void append(const char *data, size_t n)
+	{
+		if (n >= SINK_STAGING_SIZE)
+		{
+			flush();
+			if (_ok)
+				_ok = static_cast<Derived *>(this)->writeStaged(data, n);
+			return;
+		}
+		memcpy(reserve(n), data, n);
+		commit(n);
+	};
+
+	bool flush()
+	{
+		if (_used > 0 && _ok)
+			_ok = static_cast<Derived *>(this)->writeStaged(_staging, _used);
+		_used = 0;
+		return _ok;
+	};
+
+	bool ok() const { return _ok; };
+
+protected:
+	StagedSink() {};
+	~StagedSink() {};
+
+private:
+	char _staging[SINK_STAGING_SIZE];
+	size_t _used = 0;
+	bool _ok = true;
+};
+
+// Writes to a file opened by the caller, who closes it
+class FileSink : public StagedSink<FileSink> {
+public:
+	explicit FileSink(FILE *file) : _file(file) {};
+	~FileSink() { flush(); };
+
+	bool writeStaged(const char *data, size_t n) { return fwrite(data, 1, n, _file) == n; };
+
+private:
+	FILE *_file;
+};
@@ -0,0 +1,541 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <string.h>
+#include <algorithm>
+
+#include "smartDecode.h"
+#include "b64.h"
+#include "bufferPool.h"
+#include "parallelInflate.h"
+#include "saml.h"
+#include "tinf.h"
+#include "trace.h"
+#include "xmlFormat.h"
+
+namespace {
+
+// Character classes
+enum CharClass : unsigned char {
+	hexDigitClass,      // 0-9 a-f A-F
+	letterClass,        // the other letters
+	plusSlashClass,     // '+' '/'
+	urlSafeClass,       // '-' '_'
+	equalsClass,
+	percentClass,
+	spaceClass,         // ' ' '\t'
+	eolClass,
+	otherClass,         // any other printable character
+	binaryClass,        // control characters and bytes >= 0x7f
+	charClassCount
+};
+
+struct CharClassTable
+{
+	unsigned char classOf[256];
+	signed char hexValue[256];
+
+	CharClassTable()
+	{
+		for (int c = 0; c < 256; ++c)
+		{
+			classOf[c] = c >= 0x20 && c < 0x7f ? otherClass : binaryClass;
+			hexValue[c] = -1;
+		}
+		for (int c = '0'; c <= '9'; ++c)
+		{
+			classOf[c] = hexDigitClass;
+			hexValue[c] = static_cast<signed char>(c - '0');
+		}
+		for (int c = 'a'; c <= 'z'; ++c)
+		{
+			classOf[c] = c <= 'f' ? hexDigitClass : letterClass;
+			classOf[c - 'a' + 'A'] = classOf[c];
+			if (c <= 'f')
+			{
+				hexValue[c] = static_cast<signed char>(c - 'a' + 10);
+				hexValue[c - 'a' + 'A'] = hexValue[c];
+			}
+		}
+		classOf[(unsigned char)'+'] = classOf[(unsigned char)'/'] = plusSlashClass;
+		classOf[(unsigned char)'-'] = classOf[(unsigned char)'_'] = urlSafeClass;
+		classOf[(unsigned char)'='] = equalsClass;
+		classOf[(unsigned char)'%'] = percentClass;
+		classOf[(unsigned char)' '] = classOf[(unsigned char)'\t'] = spaceClass;
+		classOf[(unsigned char)'\r'] = classOf[(unsigned char)'\n'] = eolClass;
+	};
+};
+
+const CharClassTable charClasses;
+
+// What one pass over the sample found
+struct ContentSignals
+{
+	unsigned present = 0;              // bit (1 << CharClass) of every class seen
+	size_t escapeWindow = 0;           // length the escapes were counted on
+	size_t percents = 0;               // '%' characters
+	size_t innerEquals = 0;            // '=' followed by something else than '=', whitespace or the end
+	size_t qpEscapes = 0;              // "=XX" with upper case hexadecimal digits
+	size_t softBreaks = 0;             // '=' at the end of a line
+	size_t percentEscapes = 0;         // "%XX"
+	size_t percentBase64Escapes = 0;   // "%2B", "%2F", "%3D": base64 made URL safe
+};
+
+bool isHexDigit(char c)
+{
+	return charClasses.hexValue[(unsigned char)c] >= 0;
+}
+
+bool isUpperHexDigit(char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F');
+}
+
+bool startsWith(const char *text, size_t length, const char *prefix)
+{
+	size_t prefixLength = strlen(prefix);
+	return length >= prefixLength && memcmp(text, prefix, prefixLength) == 0;
+}
+
+// The classes present, OR-ed in four independent accumulators so that the lookups
+// do not wait on each other, then the escapes starting with '=' and '%'.
+void gatherSignals(const char *text, size_t sampleLength, size_t escapeWindow, size_t length, ContentSignals& signals)
+{
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(text);
+	unsigned present[4] = {};
+	size_t i = 0;
+	for (; i + 8 <= sampleLength; i += 8)
+	{
+		present[0] |= 1u << charClasses.classOf[p[i]] | 1u << charClasses.classOf[p[i + 4]];
+		present[1] |= 1u << charClasses.classOf[p[i + 1]] | 1u << charClasses.classOf[p[i + 5]];
+		present[2] |= 1u << charClasses.classOf[p[i + 2]] | 1u << charClasses.classOf[p[i + 6]];
+		present[3] |= 1u << charClasses.classOf[p[i + 3]] | 1u << charClasses.classOf[p[i + 7]];
+	}
+	for (; i < sampleLength; ++i)
+		present[0] |= 1u << charClasses.classOf[p[i]];
+	signals.present = present[0] | present[1] | present[2] | present[3];
+
+	// the characters following an escape may be past the window, never past the text
+	size_t window = std::min(escapeWindow, sampleLength);
+	signals.escapeWindow = window;
+	const char *end = text + length;
+	for (const char *at = text; at < text + window; ++at)
+	{
+		if (*at == '=')
+		{
+			char next = at + 1 < end ? at[1] : '\0';
+			if (next == '\r' || next == '\n')
+				++signals.softBreaks;
+			if (next == '\0' || next == '=' || next == ' ' || next == '\t' || next == '\r' || next == '\n')
+				continue;
+			++signals.innerEquals;
+			if (at + 2 < end && isUpperHexDigit(at[1]) && isUpperHexDigit(at[2]))
+				++signals.qpEscapes;
+		}
+		else if (*at == '%')
+		{
+			++signals.percents;
+			if (at + 2 < end && isHexDigit(at[1]) && isHexDigit(at[2]))
+			{
+				++signals.percentEscapes;
+				char high = at[1];
+				char low = static_cast<char>(at[2] | 0x20);
+				if ((high == '2' && (low == 'b' || low == 'f')) || (high == '3' && low == 'd'))
+					++signals.percentBase64Escapes;
+				at += 2;
+			}
+		}
+	}
+}
+
+// Does base64 text start with a zlib header (deflate method, header checksum)
+bool hasZlibHeader(const char *text, size_t length)
+{
+	if (length < 4)
+		return false;
+	char header[3];
+	if (base64Decode(header, text, 4, true, false) != 3)
+		return false;
+	unsigned char cmf = static_cast<unsigned char>(header[0]);
+	unsigned char flg = static_cast<unsigned char>(header[1]);
+	return (cmf & 0x0f) == 8 && (cmf >> 4) <= 7 && (cmf * 256 + flg) % 31 == 0;
+}
+
+// A thirty-second of the text, within [CLASSIFY_SAMPLE_MIN, CLASSIFY_SAMPLE_MAX]
+size_t classifySampleLength(size_t length)
+{
+	size_t sample = std::max(length / 32, CLASSIFY_SAMPLE_MIN);
+	return std::min(std::min(sample, CLASSIFY_SAMPLE_MAX), length);
+}
+
+const char *skipSpaces(const char *text, const char *end)
+{
+	while (text < end && charClasses.classOf[(unsigned char)*text] >= spaceClass && charClasses.classOf[(unsigned char)*text] <= eolClass)
+		++text;
+	return text;
+}
+
+// Value of a SAMLRequest or SAMLResponse parameter starting text, without the name
+bool samlParameterValue(const char *text, size_t length, const char *&value, size_t& valueLength)
+{
+	const char *names[] = { "SAMLRequest=", "SAMLResponse=" };
+	for (const char *name : names)
+	{
+		if (startsWith(text, length, name))
+		{
+			value = text + strlen(name);
+			const char *ampersand = static_cast<const char *>(memchr(value, '&', text + length - value));
+			valueLength = (ampersand ? ampersand : text + length) - value;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Nothing but base64 characters and padding
+bool isBase64Only(const std::string& text)
+{
+	const unsigned base64Classes = 1u << hexDigitClass | 1u << letterClass | 1u << plusSlashClass | 1u << equalsClass;
+	for (char c : text)
+	{
+		if ((base64Classes & 1u << charClasses.classOf[(unsigned char)c]) == 0)
+			return false;
+	}
+	return !text.empty();
+}
+
+bool looksLikeXml(const std::string& text)
+{
+	return !text.empty() && text[0] == '<';
+}
+
+// Decoded bytes that are clearly not text: control characters other than whitespace
+bool looksBinary(const std::string& data)
+{
+	size_t sample = std::min(data.length(), CLASSIFY_SAMPLE_MAX);
+	for (size_t i = 0; i < sample; ++i)
+	{
+		unsigned char c = static_cast<unsigned char>(data[i]);
+		if (c < 0x20 && c != '\t' && c != '\r' && c != '\n')
+			return true;
+	}
+	return false;
+}
+
+bool decodeBase64(const char *text, size_t length, std::string& out)
+{
+	out.resize(length);
+	int len = base64Decode(&out[0], text, length, true, false);
+	if (len < 0)
+	{
+		out.clear();
+		return false;
+	}
+	out.resize(len);
+	return true;
+}
+
+bool decodeBase64Url(const char *text, size_t length, std::string& out)
+{
+	PooledString standard(length);
+	standard->assign(text, length);
+	std::replace(standard->begin(), standard->end(), '-', '+');
+	std::replace(standard->begin(), standard->end(), '_', '/');
+	return decodeBase64(standard->data(), standard->length(), out);
+}
+
+// Inflate a zlib stream (zlib = true) or raw deflate, growing the output until it fits.
+// With a maxOutput, out only receives the first maxOutput bytes of the output.
+bool inflate(const char *compressed, size_t length, std::string& out, bool zlib, size_t maxOutput)
+{
+	// tinf_init() fills global tables: do it once so that decoding can run on several threads
+	static const bool tinfInitialized = (tinf_init(), true);
+	(void)tinfInitialized;
+
+	TRACE_SPAN_BYTES("inflate", length);
+	size_t capacity = maxOutput ? maxOutput : length * 8 + 4096;
+	int result;
+	unsigned int outLength;
+	do
+	{
+		out.resize(capacity);
+		outLength = (unsigned int)capacity;
+		result = zlib ? tinf_zlib_uncompress(&out[0], &outLength, compressed, (unsigned int)length)
+		              : tinf_uncompress(&out[0], &outLength, compressed, (unsigned int)length);
+		capacity *= 2;
+	} while (result == TINF_BUF_ERROR && !maxOutput && capacity <= SAML_INFLATED_SIZE_MAX);
+
+	if (result == TINF_BUF_ERROR && maxOutput && outLength > 0)
+		result = TINF_OK;
+	if (result != TINF_OK)
+	{
+		out.clear();
+		return false;
+	}
+	out.resize(outLength);
+	return true;
+}
+
+// Gunzip a gzip member. With a maxOutput, only the start of its deflate stream is inflated:
+// the CRC32 and size of the trailer, which need the whole output, are not checked.
+bool gunzip(const std::string& compressed, std::string& out, size_t maxOutput)
+{
+	if (!maxOutput)
+		return parallelGunzip(out, compressed.data(), compressed.length(), SAML_INFLATED_SIZE_MAX) == TINF_OK;
+
+	size_t start = gzipHeaderLength(compressed.data(), compressed.length());
+	return start > 0 && inflate(compressed.data() + start, compressed.length() - 8 - start, out, false, maxOutput);
+}
+
+bool decodeHex(const char *text, size_t length, std::string& out)
+{
+	out.clear();
+	out.reserve(length / 2);
+	int high = -1;
+	for (size_t i = 0; i < length; ++i)
+	{
+		unsigned char c = static_cast<unsigned char>(text[i]);
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+			continue;
+		int value = charClasses.hexValue[c];
+		if (value < 0)
+			return false;
+		if (high < 0)
+			high = value;
+		else
+		{
+			out += static_cast<char>(high << 4 | value);
+			high = -1;
+		}
+	}
+	return high < 0;
+}
+
+// Run the decoder chain of kind; kind may change to what the data turned out to be.
+// maxOutput, when not 0, bounds what is inflated.
+bool decodeAs(ContentKind& kind, const char *text, size_t length, std::string& out, size_t maxOutput)
+{
+	switch (kind)
+	{
+		case ContentKind::base64:
+		{
+			if (!decodeBase64(text, length, out))
+				return false;
+			// base64 of compressed data, told apart by what it inflates to
+			PooledString inflated;
+			if (out.length() >= 2 && (unsigned char)out[0] == 0x1f && (unsigned char)out[1] == 0x8b)
+			{
+				if (gunzip(out, *inflated, maxOutput))
+				{
+					kind = ContentKind::gzipBase64;
+					out.swap(*inflated);
+				}
+			}
+			else if (looksBinary(out) && inflate(out.data(), out.length(), *inflated, false, maxOutput) && looksLikeXml(*inflated))
+			{
+				kind = ContentKind::samlRedirect;
+				out.swap(*inflated);
+			}
+			return true;
+		}
+
+		case ContentKind::base64Url:
+			return decodeBase64Url(text, length, out);
+
+		case ContentKind::gzipBase64:
+		{
+			PooledString compressed(length);
+			return decodeBase64(text, length, *compressed) && gunzip(*compressed, out, maxOutput);
+		}
+
+		case ContentKind::zlibBase64:
+		{
+			PooledString compressed(length);
+			return decodeBase64(text, length, *compressed) && inflate(compressed->data(), compressed->length(), out, true, maxOutput);
+		}
+
+		case ContentKind::samlRedirect:
+		{
+			const char *value = text;
+			size_t valueLength = length;
+			samlParameterValue(text, length, value, valueLength);
+			return samlDecode(out, value, valueLength, maxOutput) > 0;
+		}
+
+		case ContentKind::quotedPrintable:
+			return convertText(CodecId::qpDecode, text, length, out);
+
+		case ContentKind::percentEncoded:
+			return convertText(CodecId::urlDecode, text, length, out);
+
+		case ContentKind::hex:
+			return decodeHex(text, length, out);
+
+		default:
+			return false;
+	}
+}
+
+// Classify text from the classes of its first sampleLength bytes and the escapes of its
+// first escapeWindow bytes
+ContentKind classifySample(const char *text, size_t length, size_t sampleLength, size_t escapeWindow)
+{
+	TRACE_SPAN_BYTES("classify", sampleLength);
+
+	ContentSignals signals;
+	gatherSignals(text, sampleLength, escapeWindow, length, signals);
+	auto has = [&](CharClass c) { return (signals.present & 1u << c) != 0; };
+
+	if (sampleLength == 0 || has(binaryClass))
+		return ContentKind::unknown;
+
+	// base64 whose '+', '/' and '=' are the only escaped characters
+	bool base64Only = signals.percents == signals.percentBase64Escapes && !has(otherClass) && !has(urlSafeClass) && !has(equalsClass);
+
+	// at least one character in 20 is part of a %XX escape
+	if (signals.percentEscapes * 3 * 20 >= signals.escapeWindow)
+		return base64Only ? ContentKind::samlRedirect : ContentKind::percentEncoded;
+
+	// every '=' inside the text starts an escape or a soft line break
+	if (signals.innerEquals > 0 && signals.qpEscapes + signals.softBreaks >= signals.innerEquals)
+		return ContentKind::quotedPrintable;
+
+	const unsigned whitespace = 1u << spaceClass | 1u << eolClass;
+	if ((signals.present & ~whitespace) == 1u << hexDigitClass)
+		return ContentKind::hex;
+
+	if (!has(otherClass) && !has(percentClass) && signals.innerEquals == 0)
+	{
+		if (has(urlSafeClass) && !has(plusSlashClass))
+			return ContentKind::base64Url;
+		if (!has(urlSafeClass))
+		{
+			if (startsWith(text, length, "H4sI"))
+				return ContentKind::gzipBase64;
+			if (text[0] == 'e' && hasZlibHeader(text, length))
+				return ContentKind::zlibBase64;
+			return ContentKind::base64;
+		}
+	}
+
+	if (signals.percentEscapes > 0)
+		return base64Only ? ContentKind::samlRedirect : ContentKind::percentEncoded;
+	return ContentKind::unknown;
+}
+
+} // namespace
+
+const char *contentKindName(ContentKind kind)
+{
+	switch (kind)
+	{
+		case ContentKind::base64:          return "base64";
+		case ContentKind::base64Url:       return "base64url";
+		case ContentKind::gzipBase64:      return "gzip in base64";
+		case ContentKind::zlibBase64:      return "zlib in base64";
+		case ContentKind::samlRedirect:    return "SAML (deflate, base64, URL encoding)";
+		case ContentKind::quotedPrintable: return "quoted-printable";
+		case ContentKind::percentEncoded:  return "percent encoding";
+		case ContentKind::hex:             return "hexadecimal";
+		default:                           return "unknown";
+	}
+}
+
+ContentKind classifyContent(const char *text, size_t length)
+{
+	const char *end = text + length;
+	text = skipSpaces(text, end);
+	length = end - text;
+
+	const char *value;
+	size_t valueLength;
+	if (samlParameterValue(text, length, value, valueLength))
+		return ContentKind::samlRedirect;
+
+	// a density needs few escapes: they are counted on a quarter of the sample
+	size_t sampleLength = classifySampleLength(length);
+	size_t escapeWindow = std::min(std::max(sampleLength / 4, CLASSIFY_SAMPLE_MIN), CLASSIFY_ESCAPE_WINDOW);
+	ContentKind kind = classifySample(text, length, sampleLength, escapeWindow);
+
+	// what a short sample could not tell may show further
+	size_t largest = std::min(length, CLASSIFY_SAMPLE_MAX);
+	if (kind == ContentKind::unknown && (sampleLength < largest || escapeWindow < largest))
+		kind = classifySample(text, length, largest, largest);
+	return kind;
+}
+
+bool smartDecode(const char *text, size_t length, std::string& out, const CodecOptions& options, ContentKind *kind, const char **errorMessage)
+{
+	ContentKind guess = classifyContent(text, length);
+
+	// the guess first, then what the same text could also be
+	ContentKind candidates[3] = { guess, ContentKind::unknown, ContentKind::unknown };
+	switch (guess)
+	{
+		case ContentKind::samlRedirect:    candidates[1] = ContentKind::percentEncoded; break;
+		case ContentKind::gzipBase64:
+		case ContentKind::zlibBase64:
+		case ContentKind::hex:             candidates[1] = ContentKind::base64; break;
+		case ContentKind::base64:
+			// the '-' and '_' of base64url, or the escapes of a SAML Redirect value, may all
+			// come after the sample
+			candidates[1] = ContentKind::base64Url;
+			candidates[2] = ContentKind::samlRedirect;
+			break;
+		default:                           break;
+	}
+
+	const char *end = text + length;
+	const char *start = skipSpaces(text, end);
+
+	PooledString decoded(length);
+	for (ContentKind candidate : candidates)
+	{
+		if (candidate == ContentKind::unknown)
+			continue;
+		if (decodeAs(candidate, start, end - start, *decoded, options.maxOutput))
+		{
+			// a SAML Redirect value whose escapes were too few in the sample to tell
+			if (candidate == ContentKind::percentEncoded && isBase64Only(*decoded))
+			{
+				PooledString inflated(length);
+				ContentKind saml = ContentKind::samlRedirect;
+				if (decodeAs(saml, start, end - start, *inflated, options.maxOutput))
+				{
+					candidate = saml;
+					decoded->swap(*inflated);
+				}
+			}
+			if (kind)
+				*kind = candidate;
+			if (options.maxOutput && decoded->length() > options.maxOutput)
+				decoded->resize(options.maxOutput);
+			if (options.formatXml && looksLikeXml(*decoded))
+				out += XmlFormatter::formatString(decoded->c_str(), decoded->length(), options.eol);
+			else
+				out += *decoded;
+			return true;
+		}
+		decoded->clear();
+	}
+
+	if (kind)
+		*kind = guess;
+	if (errorMessage)
+		*errorMessage = guess == ContentKind::unknown ? "The encoding of the text was not recognized." : "The text could not be decoded.";
+	return false;
+}
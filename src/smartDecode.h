@@ -0,0 +1,58 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+#include "codec.h"
+
+// Only the start of a text is classified, a thirty-second of it within these bounds, and the
+// escapes are counted on a quarter of that, at most CLASSIFY_ESCAPE_WINDOW bytes: the
+// decoders check the rest. This keeps the classification a few percent of the fastest decode.
+constexpr size_t CLASSIFY_SAMPLE_MIN = 64;
+constexpr size_t CLASSIFY_SAMPLE_MAX = 16 << 10;
+constexpr size_t CLASSIFY_ESCAPE_WINDOW = 1 << 10;
+
+// What an unknown text is encoded with
+enum class ContentKind {
+	unknown,
+	base64,
+	base64Url,          // '-' and '_' instead of '+' and '/'
+	gzipBase64,         // base64 of a gzip member ("H4sI...")
+	zlibBase64,         // base64 of a zlib stream ("eJ...")
+	samlRedirect,       // URL encoded base64 of raw deflate, optionally "SAMLRequest=..."
+	quotedPrintable,
+	percentEncoded,
+	hex
+};
+
+const char *contentKindName(ContentKind kind);
+
+// Guess the encoding from one pass over the start of text: the character classes
+// present, and the structural signals that tell the encodings apart (where '=' appears,
+// density of =XX and %XX escapes, gzip and zlib magic in base64).
+ContentKind classifyContent(const char *text, size_t length);
+
+// Classify, then decode with the matching chain (base64Decode, QuotedPrintable::decode,
+// UrlToAscii, samlDecode, gunzip or zlib inflate, hex). When the decoder of the guessed
+// encoding fails on the rest of the text, the next plausible one is tried.
+// kind receives the encoding that decoded; on failure errorMessage (if given) says why.
+// With options.maxOutput, compressed data is inflated only up to that size and the output
+// is cut there, so that a small highly compressed text costs no more than its prefix.
+bool smartDecode(const char *text, size_t length, std::string& out, const CodecOptions& options = CodecOptions(), ContentKind *kind = nullptr, const char **errorMessage = nullptr);
@@ -0,0 +1,46 @@
+/*
+ * tdef  -  tiny deflate library (raw deflate compressor)
+ *
+ * Companion of tinf: produces raw deflate streams (RFC 1951)
+ * that tinf_uncompress() can inflate.
+ */
+
+#ifndef TDEF_H_INCLUDED
+#define TDEF_H_INCLUDED
+
+/* calling convention */
+#ifndef TDEFCC
+ #ifdef __WATCOMC__
+  #define TDEFCC __cdecl
+ #else
+  #define TDEFCC
+ #endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TDEF_OK             0
+#define TDEF_MEM_ERROR     (-4)
+#define TDEF_BUF_ERROR     (-5)
+
+/* compression levels: 0 stores only, 1 is fastest, 9 compresses best */
+#define TDEF_LEVEL_STORE    0
+#define TDEF_LEVEL_FASTEST  1
+#define TDEF_LEVEL_DEFAULT  6
+#define TDEF_LEVEL_BEST     9
+
+/* function prototypes */
+
+unsigned int TDEFCC tdef_bound(unsigned int sourceLen);
+
+int TDEFCC tdef_compress(void *dest, unsigned int *destLen,
+                         const void *source, unsigned int sourceLen,
+                         int level);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TDEF_H_INCLUDED */
@@ -0,0 +1,792 @@
+/*
+ * tdeflate  -  tiny deflate
+ *
+ * Raw deflate (RFC 1951) compressor written to pair with tinflate.
+ *
+ * Matches are found with hash chains over a 32k sliding window, using
+ * greedy parsing for the fast levels and lazy evaluation for the others
+ * (same level tuning as zlib). Every block is emitted with whichever of
+ * dynamic huffman, fixed huffman or stored encoding is the smallest.
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ */
+
+#include <stdlib.h>
+
+#include "tdef.h"
+
+#define TDEF_WSIZE        32768
+#define TDEF_WMASK        (TDEF_WSIZE - 1)
+#define TDEF_MAX_DIST     (TDEF_WSIZE - 1)
+#define TDEF_HASH_BITS    15
+#define TDEF_HASH_SIZE    (1 << TDEF_HASH_BITS)
+#define TDEF_MIN_MATCH    3
+#define TDEF_MAX_MATCH    258
+#define TDEF_TOO_FAR      4096   /* length 3 matches further than this are not worth it */
+#define TDEF_BLOCK_SYMS   16384  /* symbols collected before a block is flushed */
+#define TDEF_MAX_STORED   65535
+
+#define TDEF_NUM_LSYMS    288
+#define TDEF_NUM_DSYMS    32
+#define TDEF_NUM_CLSYMS   19
+
+/* ------------------------------ *
+ * -- internal data structures -- *
+ * ------------------------------ */
+
+typedef struct {
+   unsigned short good;   /* reduce chain search when previous match is this long */
+   unsigned short lazy;   /* lazy levels: no better match is looked for beyond this length,
+                             greedy levels: longest match whose positions get hashed */
+   unsigned short nice;   /* stop searching when a match is this long */
+   unsigned short chain;  /* maximum hash chain length to follow */
+} TDEF_CONFIG;
+
+typedef struct {
+   unsigned char *dest;
+   unsigned char *destEnd;
+   unsigned int tag;
+   unsigned int bitcount;
+   int overflow;
+} TDEF_OUT;
+
+typedef struct {
+   const unsigned char *source;
+   unsigned int sourceLen;
+
+   int head[TDEF_HASH_SIZE];           /* most recent position per hash */
+   int prev[TDEF_WSIZE];               /* previous position with same hash */
+
+   unsigned short litlen[TDEF_BLOCK_SYMS]; /* literal byte or match length */
+   unsigned short dist[TDEF_BLOCK_SYMS];   /* match distance, 0 for literals */
+   unsigned int numSyms;
+   unsigned int blockStart;            /* source offset of the pending block */
+
+   unsigned int lfreq[TDEF_NUM_LSYMS];
+   unsigned int dfreq[TDEF_NUM_DSYMS];
+
+   unsigned char lengthCode[TDEF_MAX_MATCH + 1]; /* match length -> code - 257 */
+   unsigned char distCode[512];        /* see tdef_dist_code() */
+
+   TDEF_OUT out;
+} TDEF_DATA;
+
+static const TDEF_CONFIG tdef_config[10] = {
+   {  0,   0,   0,    0 }, /* 0: store only */
+   {  4,   4,   8,    4 }, /* 1-3: greedy */
+   {  4,   5,  16,    8 },
+   {  4,   6,  32,   32 },
+   {  4,   4,  16,   16 }, /* 4-9: lazy */
+   {  8,  16,  32,   32 },
+   {  8,  16, 128,  128 },
+   {  8,  32, 128,  256 },
+   { 32, 128, 258, 1024 },
+   { 32, 258, 258, 4096 }
+};
+
+#define TDEF_LAST_GREEDY_LEVEL 3
+
+/* extra bits and base tables for length codes */
+static const unsigned char tdef_length_bits[29] = {
+   0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+   3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short tdef_length_base[29] = {
+   3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+   35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+/* extra bits and base tables for distance codes */
+static const unsigned char tdef_dist_bits[30] = {
+   0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+   7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const unsigned short tdef_dist_base[30] = {
+   1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+   257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+   8193, 12289, 16385, 24577
+};
+
+/* special ordering of code length codes */
+static const unsigned char tdef_clcidx[TDEF_NUM_CLSYMS] = {
+   16, 17, 18, 0, 8, 7, 9, 6,
+   10, 5, 11, 4, 12, 3, 13, 2,
+   14, 1, 15
+};
+
+/* ----------------------- *
+ * -- utility functions -- *
+ * ----------------------- */
+
+static void tdef_build_code_tables(TDEF_DATA *d)
+{
+   int code, i;
+
+   for (code = 0; code < 28; ++code)
+   {
+      for (i = 0; i < (1 << tdef_length_bits[code]); ++i)
+         d->lengthCode[tdef_length_base[code] + i] = (unsigned char)code;
+   }
+   d->lengthCode[258] = 28;
+
+   /* distances up to 256 are indexed directly, larger ones by (dist - 1) >> 7 */
+   for (code = 0; code < 16; ++code)
+   {
+      for (i = 0; i < (1 << tdef_dist_bits[code]); ++i)
+         d->distCode[tdef_dist_base[code] - 1 + i] = (unsigned char)code;
+   }
+   for (code = 16; code < 30; ++code)
+   {
+      for (i = 0; i < (1 << (tdef_dist_bits[code] - 7)); ++i)
+         d->distCode[256 + ((tdef_dist_base[code] - 1) >> 7) + i] = (unsigned char)code;
+   }
+}
+
+static int tdef_dist_code(const TDEF_DATA *d, unsigned int dist)
+{
+   return dist <= 256 ? d->distCode[dist - 1] : d->distCode[256 + ((dist - 1) >> 7)];
+}
+
+static unsigned int tdef_hash(const unsigned char *p)
+{
+   unsigned int v = (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16);
+   return (v * 2654435761u) >> (32 - TDEF_HASH_BITS);
+}
+
+/* ---------------------- *
+ * -- output functions -- *
+ * ---------------------- */
+
+/* append num bits (lsb first) to the output stream */
+static void tdef_put_bits(TDEF_OUT *o, unsigned int bits, unsigned int num)
+{
+   o->tag |= bits << o->bitcount;
+   o->bitcount += num;
+
+   while (o->bitcount >= 8)
+   {
+      if (o->dest < o->destEnd)
+         *o->dest++ = (unsigned char)o->tag;
+      else
+         o->overflow = 1;
+      o->tag >>= 8;
+      o->bitcount -= 8;
+   }
+}
+
+/* pad the output to a byte boundary */
+static void tdef_align(TDEF_OUT *o)
+{
+   if (o->bitcount) tdef_put_bits(o, 0, 8 - o->bitcount);
+}
+
+/* ------------------------ *
+ * -- huffman code build -- *
+ * ------------------------ */
+
+static int tdef_compare_freq(const void *a, const void *b)
+{
+   const unsigned int *x = (const unsigned int *)a;
+   const unsigned int *y = (const unsigned int *)b;
+
+   /* entries are (freq << 16 | symbol), so this sorts by freq then symbol */
+   return (*x > *y) - (*x < *y);
+}
+
+/* compute length limited huffman code lengths for the given frequencies */
+static void tdef_build_lengths(const unsigned int *freq, unsigned int num,
+                               unsigned int maxlen, unsigned char *lengths)
+{
+   unsigned int sorted[TDEF_NUM_LSYMS];
+   unsigned int weight[2 * TDEF_NUM_LSYMS];
+   unsigned short parent[2 * TDEF_NUM_LSYMS];
+   unsigned short depth[2 * TDEF_NUM_LSYMS];
+   unsigned int count[33];
+   unsigned int i, m, len, total;
+
+   for (i = 0; i < num; ++i) lengths[i] = 0;
+
+   for (m = 0, i = 0; i < num; ++i)
+   {
+      if (freq[i])
+      {
+         unsigned int f = freq[i] < 0xffff ? freq[i] : 0xffff;
+         sorted[m++] = (f << 16) | i;
+      }
+   }
+
+   if (m == 0) return;
+   if (m == 1)
+   {
+      lengths[sorted[0] & 0xffff] = 1;
+      return;
+   }
+
+   qsort(sorted, m, sizeof(sorted[0]), tdef_compare_freq);
+
+   /* two-queue huffman construction: leaves are 0..m-1, internal nodes follow */
+   {
+      unsigned int leaf = 0, node = m, next;
+
+      for (i = 0; i < m; ++i) weight[i] = sorted[i] >> 16;
+
+      for (next = m; next < 2 * m - 1; ++next)
+      {
+         unsigned int pick, k;
+
+         weight[next] = 0;
+         for (k = 0; k < 2; ++k)
+         {
+            if (leaf < m && (node >= next || weight[leaf] <= weight[node]))
+               pick = leaf++;
+            else
+               pick = node++;
+            weight[next] += weight[pick];
+            parent[pick] = (unsigned short)next;
+         }
+      }
+   }
+
+   depth[2 * m - 2] = 0;
+   for (i = 2 * m - 2; i-- > 0; )
+      depth[i] = (unsigned short)(depth[parent[i]] + 1);
+
+   /* count code lengths, folding everything too long into maxlen */
+   for (i = 0; i <= 32; ++i) count[i] = 0;
+   for (i = 0; i < m; ++i)
+      count[depth[i] < maxlen ? depth[i] : maxlen]++;
+
+   /* repair the kraft sum if lengths were clamped */
+   for (total = 0, len = maxlen; len > 0; --len)
+      total += count[len] << (maxlen - len);
+
+   while (total != (1u << maxlen))
+   {
+      count[maxlen]--;
+      for (len = maxlen - 1; len > 0; --len)
+      {
+         if (count[len])
+         {
+            count[len]--;
+            count[len + 1] += 2;
+            break;
+         }
+      }
+      total--;
+   }
+
+   /* hand out the longest codes to the least frequent symbols */
+   for (i = 0, len = maxlen; len > 0; --len)
+   {
+      unsigned int c;
+      for (c = count[len]; c; --c)
+         lengths[sorted[i++] & 0xffff] = (unsigned char)len;
+   }
+}
+
+/* compute canonical codes, bit reversed for lsb first output */
+static void tdef_build_codes(const unsigned char *lengths, unsigned int num, unsigned short *codes)
+{
+   unsigned int count[16], next[16];
+   unsigned int i, code;
+
+   for (i = 0; i < 16; ++i) count[i] = 0;
+   for (i = 0; i < num; ++i) count[lengths[i]]++;
+   count[0] = 0;
+
+   for (code = 0, i = 1; i < 16; ++i)
+   {
+      code = (code + count[i - 1]) << 1;
+      next[i] = code;
+   }
+
+   for (i = 0; i < num; ++i)
+   {
+      unsigned int len = lengths[i], c, rev = 0, k;
+
+      if (!len)
+      {
+         codes[i] = 0;
+         continue;
+      }
+
+      c = next[len]++;
+      for (k = 0; k < len; ++k)
+      {
+         rev = (rev << 1) | (c & 1);
+         c >>= 1;
+      }
+      codes[i] = (unsigned short)rev;
+   }
+}
+
+/* ---------------------- *
+ * -- block functions  -- *
+ * ---------------------- */
+
+static void tdef_fixed_lengths(unsigned char *llen, unsigned char *dlen)
+{
+   int i;
+
+   for (i = 0; i < 144; ++i) llen[i] = 8;
+   for (; i < 256; ++i) llen[i] = 9;
+   for (; i < 280; ++i) llen[i] = 7;
+   for (; i < 288; ++i) llen[i] = 8;
+   for (i = 0; i < 32; ++i) dlen[i] = 5;
+}
+
+/* size in bits of the block symbols coded with the given lengths */
+static unsigned long tdef_data_cost(const TDEF_DATA *d, const unsigned char *llen, const unsigned char *dlen)
+{
+   unsigned long bits = 0;
+   int i;
+
+   for (i = 0; i < 256; ++i) bits += (unsigned long)d->lfreq[i] * llen[i];
+   bits += llen[256];
+   for (i = 0; i < 29; ++i) bits += (unsigned long)d->lfreq[257 + i] * (llen[257 + i] + tdef_length_bits[i]);
+   for (i = 0; i < 30; ++i) bits += (unsigned long)d->dfreq[i] * (dlen[i] + tdef_dist_bits[i]);
+
+   return bits;
+}
+
+/* run length encode the code lengths of both trees (symbols 0-18, extra bits value in the high byte) */
+static unsigned int tdef_rle_lengths(const unsigned char *lengths, unsigned int num,
+                                     unsigned short *rle, unsigned int *clfreq)
+{
+   unsigned int i = 0, n = 0;
+
+   while (i < num)
+   {
+      unsigned int len = lengths[i], run = 1;
+
+      while (i + run < num && lengths[i + run] == len) ++run;
+      i += run;
+
+      if (len == 0)
+      {
+         while (run >= 11)
+         {
+            unsigned int r = run < 138 ? run : 138;
+            rle[n++] = (unsigned short)(18 | ((r - 11) << 8));
+            clfreq[18]++;
+            run -= r;
+         }
+         if (run >= 3)
+         {
+            rle[n++] = (unsigned short)(17 | ((run - 3) << 8));
+            clfreq[17]++;
+            run = 0;
+         }
+      }
+      else
+      {
+         rle[n++] = (unsigned short)len;
+         clfreq[len]++;
+         --run;
+         while (run >= 3)
+         {
+            unsigned int r = run < 6 ? run : 6;
+            rle[n++] = (unsigned short)(16 | ((r - 3) << 8));
+            clfreq[16]++;
+            run -= r;
+         }
+      }
+
+      for (; run; --run)
+      {
+         rle[n++] = (unsigned short)len;
+         clfreq[len]++;
+      }
+   }
+
+   return n;
+}
+
+/* emit the collected symbols with the given huffman codes */
+static void tdef_write_symbols(TDEF_DATA *d, const unsigned char *llen, const unsigned short *lcode,
+                               const unsigned char *dlen, const unsigned short *dcode)
+{
+   TDEF_OUT *o = &d->out;
+   unsigned int i;
+
+   for (i = 0; i < d->numSyms; ++i)
+   {
+      unsigned int dist = d->dist[i];
+
+      if (!dist)
+      {
+         unsigned int sym = d->litlen[i];
+         tdef_put_bits(o, lcode[sym], llen[sym]);
+      }
+      else
+      {
+         unsigned int length = d->litlen[i];
+         int lc = d->lengthCode[length];
+         int dc = tdef_dist_code(d, dist);
+
+         tdef_put_bits(o, lcode[257 + lc], llen[257 + lc]);
+         if (tdef_length_bits[lc]) tdef_put_bits(o, length - tdef_length_base[lc], tdef_length_bits[lc]);
+         tdef_put_bits(o, dcode[dc], dlen[dc]);
+         if (tdef_dist_bits[dc]) tdef_put_bits(o, dist - tdef_dist_base[dc], tdef_dist_bits[dc]);
+      }
+   }
+
+   tdef_put_bits(o, lcode[256], llen[256]);
+}
+
+/* emit source bytes [start, end) as stored blocks */
+static void tdef_write_stored(TDEF_DATA *d, unsigned int start, unsigned int end, int final)
+{
+   TDEF_OUT *o = &d->out;
+
+   do {
+      unsigned int len = end - start < TDEF_MAX_STORED ? end - start : TDEF_MAX_STORED;
+      unsigned int i;
+
+      tdef_put_bits(o, (final && start + len == end) ? 1 : 0, 1);
+      tdef_put_bits(o, 0, 2);
+      tdef_align(o);
+
+      tdef_put_bits(o, len & 0xffff, 16);
+      tdef_put_bits(o, ~len & 0xffff, 16);
+
+      if ((unsigned int)(o->destEnd - o->dest) < len)
+      {
+         o->overflow = 1;
+         return;
+      }
+      for (i = 0; i < len; ++i) *o->dest++ = d->source[start + i];
+
+      start += len;
+   } while (start < end);
+}
+
+/* encode the pending symbols as one block, picking the cheapest block type */
+static void tdef_flush_block(TDEF_DATA *d, unsigned int blockEnd, int final)
+{
+   unsigned char llen[TDEF_NUM_LSYMS], dlen[TDEF_NUM_DSYMS];
+   unsigned char flen[TDEF_NUM_LSYMS], fdlen[TDEF_NUM_DSYMS];
+   unsigned char cllen[TDEF_NUM_CLSYMS];
+   unsigned char lengths[TDEF_NUM_LSYMS + TDEF_NUM_DSYMS];
+   unsigned short lcode[TDEF_NUM_LSYMS], dcode[TDEF_NUM_DSYMS], clcode[TDEF_NUM_CLSYMS];
+   unsigned short rle[TDEF_NUM_LSYMS + TDEF_NUM_DSYMS];
+   unsigned int clfreq[TDEF_NUM_CLSYMS];
+   unsigned int hlit, hdist, hclen, numRle, used, i;
+   unsigned long dynCost, fixedCost, storedCost;
+   TDEF_OUT *o = &d->out;
+
+   d->lfreq[256] = 1;
+
+   /* keep both trees complete, some inflaters reject single code trees */
+   for (used = 0, i = 0; i < 286; ++i) used += d->lfreq[i] != 0;
+   if (used < 2) d->lfreq[0] = 1;
+   for (used = 0, i = 0; i < 30; ++i) used += d->dfreq[i] != 0;
+   if (used == 0) d->dfreq[0] = d->dfreq[1] = 1;
+   else if (used == 1) d->dfreq[d->dfreq[0] ? 1 : 0] = 1;
+
+   tdef_build_lengths(d->lfreq, 286, 15, llen);
+   tdef_build_lengths(d->dfreq, 30, 15, dlen);
+   llen[286] = llen[287] = 0;
+   dlen[30] = dlen[31] = 0;
+
+   for (hlit = 286; hlit > 257 && !llen[hlit - 1]; --hlit) ;
+   for (hdist = 30; hdist > 1 && !dlen[hdist - 1]; --hdist) ;
+
+   for (i = 0; i < hlit; ++i) lengths[i] = llen[i];
+   for (i = 0; i < hdist; ++i) lengths[hlit + i] = dlen[i];
+
+   for (i = 0; i < TDEF_NUM_CLSYMS; ++i) clfreq[i] = 0;
+   numRle = tdef_rle_lengths(lengths, hlit + hdist, rle, clfreq);
+   tdef_build_lengths(clfreq, TDEF_NUM_CLSYMS, 7, cllen);
+
+   for (hclen = TDEF_NUM_CLSYMS; hclen > 4 && !cllen[tdef_clcidx[hclen - 1]]; --hclen) ;
+
+   /* cost of each block type in bits */
+   dynCost = 3 + 5 + 5 + 4 + 3 * hclen + tdef_data_cost(d, llen, dlen);
+   for (i = 0; i < TDEF_NUM_CLSYMS; ++i)
+      dynCost += (unsigned long)clfreq[i] * cllen[i];
+   dynCost += (unsigned long)clfreq[16] * 2 + (unsigned long)clfreq[17] * 3 + (unsigned long)clfreq[18] * 7;
+
+   tdef_fixed_lengths(flen, fdlen);
+   fixedCost = 3 + tdef_data_cost(d, flen, fdlen);
+
+   storedCost = 3 + 7 + 8 * (unsigned long)(blockEnd - d->blockStart)
+              + 32 * (unsigned long)((blockEnd - d->blockStart) / TDEF_MAX_STORED + 1);
+
+   if (storedCost <= fixedCost && storedCost <= dynCost)
+   {
+      tdef_write_stored(d, d->blockStart, blockEnd, final);
+   }
+   else if (fixedCost <= dynCost)
+   {
+      tdef_put_bits(o, final ? 1 : 0, 1);
+      tdef_put_bits(o, 1, 2);
+      tdef_build_codes(flen, TDEF_NUM_LSYMS, lcode);
+      tdef_build_codes(fdlen, TDEF_NUM_DSYMS, dcode);
+      tdef_write_symbols(d, flen, lcode, fdlen, dcode);
+   }
+   else
+   {
+      tdef_put_bits(o, final ? 1 : 0, 1);
+      tdef_put_bits(o, 2, 2);
+      tdef_put_bits(o, hlit - 257, 5);
+      tdef_put_bits(o, hdist - 1, 5);
+      tdef_put_bits(o, hclen - 4, 4);
+      for (i = 0; i < hclen; ++i)
+         tdef_put_bits(o, cllen[tdef_clcidx[i]], 3);
+
+      tdef_build_codes(cllen, TDEF_NUM_CLSYMS, clcode);
+      for (i = 0; i < numRle; ++i)
+      {
+         unsigned int sym = rle[i] & 0xff, extra = rle[i] >> 8;
+
+         tdef_put_bits(o, clcode[sym], cllen[sym]);
+         if (sym == 16) tdef_put_bits(o, extra, 2);
+         else if (sym == 17) tdef_put_bits(o, extra, 3);
+         else if (sym == 18) tdef_put_bits(o, extra, 7);
+      }
+
+      tdef_build_codes(llen, TDEF_NUM_LSYMS, lcode);
+      tdef_build_codes(dlen, TDEF_NUM_DSYMS, dcode);
+      tdef_write_symbols(d, llen, lcode, dlen, dcode);
+   }
+
+   /* reset block state */
+   d->numSyms = 0;
+   d->blockStart = blockEnd;
+   for (i = 0; i < TDEF_NUM_LSYMS; ++i) d->lfreq[i] = 0;
+   for (i = 0; i < TDEF_NUM_DSYMS; ++i) d->dfreq[i] = 0;
+}
+
+static void tdef_emit_literal(TDEF_DATA *d, unsigned int pos)
+{
+   unsigned int c = d->source[pos];
+
+   d->litlen[d->numSyms] = (unsigned short)c;
+   d->dist[d->numSyms++] = 0;
+   d->lfreq[c]++;
+
+   if (d->numSyms == TDEF_BLOCK_SYMS) tdef_flush_block(d, pos + 1, 0);
+}
+
+static void tdef_emit_match(TDEF_DATA *d, unsigned int pos, unsigned int length, unsigned int dist)
+{
+   d->litlen[d->numSyms] = (unsigned short)length;
+   d->dist[d->numSyms++] = (unsigned short)dist;
+   d->lfreq[257 + d->lengthCode[length]]++;
+   d->dfreq[tdef_dist_code(d, dist)]++;
+
+   if (d->numSyms == TDEF_BLOCK_SYMS) tdef_flush_block(d, pos + length, 0);
+}
+
+/* ------------------------- *
+ * -- match finder (lz77) -- *
+ * ------------------------- */
+
+/* insert pos into its hash chain, returning the previous head of the chain */
+static int tdef_insert(TDEF_DATA *d, unsigned int pos)
+{
+   unsigned int h = tdef_hash(d->source + pos);
+   int cand = d->head[h];
+
+   d->prev[pos & TDEF_WMASK] = cand;
+   d->head[h] = (int)pos;
+
+   return cand;
+}
+
+/* follow the hash chain from cand, returning the longest match length at pos */
+static unsigned int tdef_longest_match(const TDEF_DATA *d, unsigned int pos, int cand,
+                                       unsigned int chain, unsigned int nice,
+                                       unsigned int prevLength, unsigned int *matchDist)
+{
+   const unsigned char *src = d->source;
+   const unsigned char *scan = src + pos;
+   unsigned int maxLen = d->sourceLen - pos < TDEF_MAX_MATCH ? d->sourceLen - pos : TDEF_MAX_MATCH;
+   unsigned int best = prevLength;
+
+   if (best >= maxLen) return 0;
+   if (nice > maxLen) nice = maxLen;
+
+   while (cand >= 0 && pos - (unsigned int)cand <= TDEF_MAX_DIST && chain--)
+   {
+      const unsigned char *match = src + cand;
+
+      if (match[best] == scan[best] && match[0] == scan[0] && match[1] == scan[1])
+      {
+         unsigned int len = 2;
+
+         while (len < maxLen && match[len] == scan[len]) ++len;
+
+         if (len > best)
+         {
+            best = len;
+            *matchDist = pos - (unsigned int)cand;
+            if (len >= nice) break;
+         }
+      }
+
+      {
+         int next = d->prev[cand & TDEF_WMASK];
+         if (next >= cand) break;
+         cand = next;
+      }
+   }
+
+   return best > prevLength ? best : 0;
+}
+
+static void tdef_compress_greedy(TDEF_DATA *d, const TDEF_CONFIG *cfg)
+{
+   unsigned int pos = 0, n = d->sourceLen;
+
+   while (pos < n)
+   {
+      unsigned int length = 0, dist = 0;
+
+      if (pos + TDEF_MIN_MATCH <= n)
+      {
+         int cand = tdef_insert(d, pos);
+         length = tdef_longest_match(d, pos, cand, cfg->chain, cfg->nice, TDEF_MIN_MATCH - 1, &dist);
+         if (length == TDEF_MIN_MATCH && dist > TDEF_TOO_FAR) length = 0;
+      }
+
+      if (length)
+      {
+         unsigned int end = pos + length, q;
+
+         tdef_emit_match(d, pos, length, dist);
+
+         /* only the positions of short matches are hashed */
+         if (length <= cfg->lazy)
+         {
+            for (q = pos + 1; q < end && q + TDEF_MIN_MATCH <= n; ++q) tdef_insert(d, q);
+         }
+         pos = end;
+      }
+      else
+      {
+         tdef_emit_literal(d, pos);
+         ++pos;
+      }
+   }
+}
+
+static void tdef_compress_lazy(TDEF_DATA *d, const TDEF_CONFIG *cfg)
+{
+   unsigned int pos = 0, n = d->sourceLen;
+   unsigned int prevLength = 0, prevDist = 0;
+   int matchAvailable = 0;
+
+   while (pos < n)
+   {
+      unsigned int length = 0, dist = 0;
+
+      if (pos + TDEF_MIN_MATCH <= n)
+      {
+         int cand = tdef_insert(d, pos);
+
+         if (prevLength < cfg->lazy)
+         {
+            unsigned int chain = prevLength >= cfg->good ? cfg->chain >> 2 : cfg->chain;
+            unsigned int minLength = prevLength > TDEF_MIN_MATCH - 1 ? prevLength : TDEF_MIN_MATCH - 1;
+
+            length = tdef_longest_match(d, pos, cand, chain, cfg->nice, minLength, &dist);
+            if (length == TDEF_MIN_MATCH && dist > TDEF_TOO_FAR) length = 0;
+         }
+      }
+
+      if (prevLength >= TDEF_MIN_MATCH && length <= prevLength)
+      {
+         /* the match found at the previous position wins */
+         unsigned int end = pos - 1 + prevLength, q;
+
+         tdef_emit_match(d, pos - 1, prevLength, prevDist);
+
+         for (q = pos + 1; q < end && q + TDEF_MIN_MATCH <= n; ++q) tdef_insert(d, q);
+
+         pos = end;
+         prevLength = 0;
+         matchAvailable = 0;
+      }
+      else
+      {
+         if (matchAvailable) tdef_emit_literal(d, pos - 1);
+
+         matchAvailable = 1;
+         prevLength = length;
+         prevDist = dist;
+         ++pos;
+      }
+   }
+
+   if (matchAvailable) tdef_emit_literal(d, n - 1);
+}
+
+/* ---------------------- *
+ * -- public functions -- *
+ * ---------------------- */
+
+/* worst case compressed size (blocks fall back to stored encoding) */
+unsigned int tdef_bound(unsigned int sourceLen)
+{
+   return sourceLen + (sourceLen >> 11) + 64;
+}
+
+/* deflate source into dest, destLen holds the capacity of dest on entry */
+int tdef_compress(void *dest, unsigned int *destLen,
+                  const void *source, unsigned int sourceLen,
+                  int level)
+{
+   TDEF_DATA *d;
+   int res;
+   unsigned int i;
+
+   if (level < TDEF_LEVEL_STORE) level = TDEF_LEVEL_DEFAULT;
+   if (level > TDEF_LEVEL_BEST) level = TDEF_LEVEL_BEST;
+
+   d = (TDEF_DATA *)malloc(sizeof(TDEF_DATA));
+   if (!d) return TDEF_MEM_ERROR;
+
+   d->source = (const unsigned char *)source;
+   d->sourceLen = sourceLen;
+   d->numSyms = 0;
+   d->blockStart = 0;
+
+   d->out.dest = (unsigned char *)dest;
+   d->out.destEnd = d->out.dest + *destLen;
+   d->out.tag = 0;
+   d->out.bitcount = 0;
+   d->out.overflow = 0;
+
+   if (level == TDEF_LEVEL_STORE)
+   {
+      tdef_write_stored(d, 0, sourceLen, 1);
+   }
+   else
+   {
+      for (i = 0; i < TDEF_HASH_SIZE; ++i) d->head[i] = -1;
+      for (i = 0; i < TDEF_NUM_LSYMS; ++i) d->lfreq[i] = 0;
+      for (i = 0; i < TDEF_NUM_DSYMS; ++i) d->dfreq[i] = 0;
+      tdef_build_code_tables(d);
+
+      if (level <= TDEF_LAST_GREEDY_LEVEL)
+         tdef_compress_greedy(d, &tdef_config[level]);
+      else
+         tdef_compress_lazy(d, &tdef_config[level]);
+
+      tdef_flush_block(d, sourceLen, 1);
+   }
+
+   tdef_align(&d->out);
+
+   *destLen = (unsigned int)(d->out.dest - (unsigned char *)dest);
+   res = d->out.overflow ? TDEF_BUF_ERROR : TDEF_OK;
+
+   free(d);
+
+   return res;
+}
@@ -27,12 +27,15 @@ extern "C" {
 
 #define TINF_OK             0
 #define TINF_DATA_ERROR    (-3)
+#define TINF_BUF_ERROR     (-5)
 
 /* function prototypes */
 
 void TINFCC tinf_init();
 
-int TINFCC tinf_uncompress(void *dest, unsigned int *destLen, const void *source);
+/* on TINF_BUF_ERROR, dest is full: it holds the first destLen bytes of the output */
+int TINFCC tinf_uncompress(void *dest, unsigned int *destLen,
+                           const void *source, unsigned int sourceLen);
 
 int TINFCC tinf_gzip_uncompress(void *dest, unsigned int *destLen,
                                 const void *source, unsigned int sourceLen);
@@ -0,0 +1,163 @@
+/*
+ * tinfgzip  -  tiny gzip decompressor
+ *
+ * Copyright (c) 2003 by Joergen Ibsen / Jibz
+ * All Rights Reserved
+ *
+ * http://www.ibsensoftware.com/
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely, subject to
+ * the following restrictions:
+ *
+ * 1. The origin of this software must not be
+ *    misrepresented; you must not claim that you
+ *    wrote the original software. If you use this
+ *    software in a product, an acknowledgment in
+ *    the product documentation would be appreciated
+ *    but is not required.
+ *
+ * 2. Altered source versions must be plainly marked
+ *    as such, and must not be misrepresented as
+ *    being the original software.
+ *
+ * 3. This notice may not be removed or altered from
+ *    any source distribution.
+ */
+
+#include "tinf.h"
+
+#define FTEXT    1
+#define FHCRC    2
+#define FEXTRA   4
+#define FNAME    8
+#define FCOMMENT 16
+
+/* ------------------------------ *
+ * -- crc32 (IEEE 802.3, zlib) -- *
+ * ------------------------------ */
+
+static const unsigned int tinf_crc32tab[16] = {
+   0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190,
+   0x6b6b51f4, 0x4db26158, 0x5005713c, 0xedb88320, 0xf00f9344,
+   0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278,
+   0xbdbdf21c
+};
+
+unsigned int tinf_crc32(const void *data, unsigned int length)
+{
+   const unsigned char *buf = (const unsigned char *)data;
+   unsigned int crc = 0xffffffff;
+   unsigned int i;
+
+   if (length == 0) return 0;
+
+   for (i = 0; i < length; ++i)
+   {
+      crc ^= buf[i];
+      crc = tinf_crc32tab[crc & 0x0f] ^ (crc >> 4);
+      crc = tinf_crc32tab[crc & 0x0f] ^ (crc >> 4);
+   }
+
+   return crc ^ 0xffffffff;
+}
+
+/* ---------------------- *
+ * -- public functions -- *
+ * ---------------------- */
+
+/* the member header is followed by raw deflate data, then by the crc32 and size of the content */
+int tinf_gzip_uncompress(void *dest, unsigned int *destLen,
+                         const void *source, unsigned int sourceLen)
+{
+   const unsigned char *src = (const unsigned char *)source;
+   const unsigned char *start;
+   unsigned int dlen, crc32;
+   int res;
+   unsigned char flg;
+
+   /* -- check format -- */
+
+   if (sourceLen < 18) return TINF_DATA_ERROR;
+
+   /* check id bytes */
+   if (src[0] != 0x1f || src[1] != 0x8b) return TINF_DATA_ERROR;
+
+   /* check method is deflate */
+   if (src[2] != 8) return TINF_DATA_ERROR;
+
+   /* get flag byte */
+   flg = src[3];
+
+   /* check that reserved bits are zero */
+   if (flg & 0xe0) return TINF_DATA_ERROR;
+
+   /* -- find start of compressed data -- */
+
+   /* skip base header of 10 bytes */
+   start = src + 10;
+
+   /* skip extra data if present */
+   if (flg & FEXTRA)
+   {
+      unsigned int xlen = start[1];
+      xlen = 256*xlen + start[0];
+      if (xlen > sourceLen - 12) return TINF_DATA_ERROR;
+      start += xlen + 2;
+   }
+
+   /* skip file name if present */
+   if (flg & FNAME)
+   {
+      do {
+         if (start - src >= (int)sourceLen) return TINF_DATA_ERROR;
+      } while (*start++);
+   }
+
+   /* skip file comment if present */
+   if (flg & FCOMMENT)
+   {
+      do {
+         if (start - src >= (int)sourceLen) return TINF_DATA_ERROR;
+      } while (*start++);
+   }
+
+   /* skip header crc if present (not checked) */
+   if (flg & FHCRC) start += 2;
+
+   if (start - src > (int)sourceLen - 8) return TINF_DATA_ERROR;
+
+   /* -- get decompressed length and crc32 from the trailer -- */
+
+   dlen =            src[sourceLen - 1];
+   dlen = 256*dlen + src[sourceLen - 2];
+   dlen = 256*dlen + src[sourceLen - 3];
+   dlen = 256*dlen + src[sourceLen - 4];
+
+   crc32 =             src[sourceLen - 5];
+   crc32 = 256*crc32 + src[sourceLen - 6];
+   crc32 = 256*crc32 + src[sourceLen - 7];
+   crc32 = 256*crc32 + src[sourceLen - 8];
+
+   /* -- decompress data -- */
+
+   if (dlen > *destLen) return TINF_BUF_ERROR;
+
+   res = tinf_uncompress(dest, destLen, start, (unsigned int)(src + sourceLen - 8 - start));
+
+   if (res != TINF_OK) return res;
+
+   if (*destLen != dlen) return TINF_DATA_ERROR;
+
+   /* -- check CRC32 checksum -- */
+
+   if (crc32 != tinf_crc32(dest, dlen)) return TINF_DATA_ERROR;
+
+   return TINF_OK;
+}
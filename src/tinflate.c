@@ -44,10 +44,14 @@ typedef struct {
 
 typedef struct {
    const unsigned char *source;
+   const unsigned char *sourceEnd;
    unsigned int tag;
    unsigned int bitcount;
+   int overflow;
 
+   unsigned char *destStart;
    unsigned char *dest;
+   unsigned char *destEnd;
    unsigned int *destLen;
 
    TINF_TREE ltree; /* dynamic length/symbol tree */
@@ -94,7 +98,7 @@ static void tinf_build_bits_base(unsigned char *bits, unsigned short *base, int
    /* build base table */
    for (sum = first, i = 0; i < 30; ++i)
    {
-      base[i] = (char)sum;
+      base[i] = (unsigned short)sum;
       sum += 1 << bits[i];
    }
 }
@@ -173,8 +177,14 @@ static int tinf_getbit(TINF_DATA *d)
    /* check if tag is empty */
    if (!d->bitcount--)
    {
-      /* load next tag */
-      d->tag = *d->source++;
+      /* load next tag, reading past the end of source yields zeros */
+      if (d->source < d->sourceEnd)
+         d->tag = *d->source++;
+      else
+      {
+         d->tag = 0;
+         d->overflow = 1;
+      }
       d->bitcount = 7;
    }
 
@@ -213,7 +223,12 @@ static int tinf_decode_symbol(TINF_DATA *d, TINF_TREE *t)
 
       cur = 2*cur + tinf_getbit(d);
 
-      ++len;
+      /* no code is longer than 15 bits, the tree is invalid */
+      if (++len > 15)
+      {
+         d->overflow = 1;
+         return 0;
+      }
 
       sum += t->table[len];
       cur -= t->table[len];
@@ -259,14 +274,18 @@ static void tinf_decode_trees(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
    {
       int sym = tinf_decode_symbol(d, &code_tree);
 
+      if (d->overflow) return;
+
       switch (sym)
       {
       case 16:
          /* copy previous code length 3-6 times (read 2 bits) */
          {
-            if (num == 0) return;
+            if (num == 0) { d->overflow = 1; return; }
             unsigned char prev = lengths[num - 1];
-            for (length = tinf_read_bits(d, 2, 3); length; --length)
+            length = tinf_read_bits(d, 2, 3);
+            if (num + length > hlit + hdist) { d->overflow = 1; return; }
+            for (; length; --length)
             {
                lengths[num++] = prev;
             }
@@ -274,14 +293,18 @@ static void tinf_decode_trees(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
          break;
       case 17:
          /* repeat code length 0 for 3-10 times (read 3 bits) */
-         for (length = tinf_read_bits(d, 3, 3); length; --length)
+         length = tinf_read_bits(d, 3, 3);
+         if (num + length > hlit + hdist) { d->overflow = 1; return; }
+         for (; length; --length)
          {
             lengths[num++] = 0;
          }
          break;
       case 18:
          /* repeat code length 0 for 11-138 times (read 7 bits) */
-         for (length = tinf_read_bits(d, 7, 11); length; --length)
+         length = tinf_read_bits(d, 7, 11);
+         if (num + length > hlit + hdist) { d->overflow = 1; return; }
+         for (; length; --length)
          {
             lengths[num++] = 0;
          }
@@ -312,6 +335,9 @@ static int tinf_inflate_block_data(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
    {
       int sym = tinf_decode_symbol(d, lt);
 
+      /* truncated input */
+      if (d->overflow) return TINF_DATA_ERROR;
+
       /* check for end of block */
       if (sym == 256)
       {
@@ -321,31 +347,40 @@ static int tinf_inflate_block_data(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
 
       if (sym < 256)
       {
+         if (d->dest == d->destEnd) return TINF_BUF_ERROR;
          *d->dest++ = (char)sym;
 
       }
 	  else
 	  {
          int length, dist, offs;
-         int i;
+         int i, full;
 
          sym -= 257;
+         if (sym > 28) return TINF_DATA_ERROR;
 
          /* possibly get more bits from length code */
          length = tinf_read_bits(d, length_bits[sym], length_base[sym]);
 
          dist = tinf_decode_symbol(d, dt);
+         if (dist > 29) return TINF_DATA_ERROR;
 
          /* possibly get more bits from distance code */
          offs = tinf_read_bits(d, dist_bits[dist], dist_base[dist]);
 
-         /* copy match */
+         /* the match must lie within what was inflated so far */
+         if (offs > d->dest - d->destStart) return TINF_DATA_ERROR;
+
+         /* copy match, or what fits of it when dest is full */
+         full = length > d->destEnd - d->dest;
+         if (full) length = (int)(d->destEnd - d->dest);
          for (i = 0; i < length; ++i)
          {
             d->dest[i] = d->dest[i - offs];
          }
 
          d->dest += length;
+         if (full) return TINF_BUF_ERROR;
       }
    }
 }
@@ -356,6 +391,8 @@ static int tinf_inflate_uncompressed_block(TINF_DATA *d)
    unsigned int length, invlength;
    unsigned int i;
 
+   if (d->sourceEnd - d->source < 4) return TINF_DATA_ERROR;
+
    /* get length */
    length = d->source[1];
    length = 256*length + d->source[0];
@@ -369,6 +406,15 @@ static int tinf_inflate_uncompressed_block(TINF_DATA *d)
 
    d->source += 4;
 
+   if (length > (unsigned int)(d->sourceEnd - d->source)) return TINF_DATA_ERROR;
+
+   /* dest full: copy what fits */
+   if (length > (unsigned int)(d->destEnd - d->dest))
+   {
+      for (i = (unsigned int)(d->destEnd - d->dest); i; --i) *d->dest++ = *d->source++;
+      return TINF_BUF_ERROR;
+   }
+
    /* copy block */
    for (i = length; i; --i) *d->dest++ = *d->source++;
 
@@ -416,17 +462,22 @@ void tinf_init()
    length_base[28] = 258;
 }
 
-/* inflate stream from source to dest */
-int tinf_uncompress(void* dest, unsigned int* destLen, const void* source)
+/* inflate stream from source to dest, destLen holds the capacity of dest on entry */
+int tinf_uncompress(void *dest, unsigned int *destLen,
+                    const void *source, unsigned int sourceLen)
 {
    TINF_DATA d;
    int bfinal;
 
    /* initialise data */
    d.source = (const unsigned char *)source;
+   d.sourceEnd = d.source + sourceLen;
    d.bitcount = 0;
+   d.overflow = 0;
 
+   d.destStart = (unsigned char *)dest;
    d.dest = (unsigned char *)dest;
+   d.destEnd = d.dest + *destLen;
    d.destLen = destLen;
 
    *destLen = 0;
@@ -461,7 +512,10 @@ int tinf_uncompress(void* dest, unsigned int* destLen, const void* source)
          return TINF_DATA_ERROR;
       }
 
-      if (res != TINF_OK) return TINF_DATA_ERROR;
+      /* dest full: destLen gives what was written, a prefix of the output */
+      if (res == TINF_BUF_ERROR) *destLen = (unsigned int)(d.dest - d.destStart);
+      if (res != TINF_OK) return res;
+      if (d.overflow) return TINF_DATA_ERROR;
 
    } while (!bfinal);
 
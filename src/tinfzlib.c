@@ -0,0 +1,123 @@
+/*
+ * tinfzlib  -  tiny zlib decompressor
+ *
+ * Copyright (c) 2003 by Joergen Ibsen / Jibz
+ * All Rights Reserved
+ *
+ * http://www.ibsensoftware.com/
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely, subject to
+ * the following restrictions:
+ *
+ * 1. The origin of this software must not be
+ *    misrepresented; you must not claim that you
+ *    wrote the original software. If you use this
+ *    software in a product, an acknowledgment in
+ *    the product documentation would be appreciated
+ *    but is not required.
+ *
+ * 2. Altered source versions must be plainly marked
+ *    as such, and must not be misrepresented as
+ *    being the original software.
+ *
+ * 3. This notice may not be removed or altered from
+ *    any source distribution.
+ */
+
+#include "tinf.h"
+
+/* ----------------------- *
+ * -- adler32 (RFC 1950) -- *
+ * ----------------------- */
+
+#define A32_BASE 65521
+#define A32_NMAX 5552
+
+unsigned int tinf_adler32(const void *data, unsigned int length)
+{
+   const unsigned char *buf = (const unsigned char *)data;
+
+   unsigned int s1 = 1;
+   unsigned int s2 = 0;
+
+   while (length > 0)
+   {
+      int k = length < A32_NMAX ? length : A32_NMAX;
+      int i;
+
+      for (i = k; i; --i)
+      {
+         s1 += *buf++;
+         s2 += s1;
+      }
+
+      s1 %= A32_BASE;
+      s2 %= A32_BASE;
+
+      length -= k;
+   }
+
+   return (s2 << 16) | s1;
+}
+
+/* ---------------------- *
+ * -- public functions -- *
+ * ---------------------- */
+
+/* a 2 bytes header, raw deflate data, then the adler32 of the content */
+int tinf_zlib_uncompress(void *dest, unsigned int *destLen,
+                         const void *source, unsigned int sourceLen)
+{
+   const unsigned char *src = (const unsigned char *)source;
+   unsigned char *dst = (unsigned char *)dest;
+   unsigned int a32;
+   int res;
+   unsigned char cmf, flg;
+
+   /* -- get header bytes -- */
+
+   if (sourceLen < 6) return TINF_DATA_ERROR;
+
+   cmf = src[0];
+   flg = src[1];
+
+   /* -- check format -- */
+
+   /* check checksum */
+   if ((256*cmf + flg) % 31) return TINF_DATA_ERROR;
+
+   /* check method is deflate */
+   if ((cmf & 0x0f) != 8) return TINF_DATA_ERROR;
+
+   /* check window size is valid */
+   if ((cmf >> 4) > 7) return TINF_DATA_ERROR;
+
+   /* check there is no preset dictionary */
+   if (flg & 0x20) return TINF_DATA_ERROR;
+
+   /* -- get adler32 checksum -- */
+
+   a32 =           src[sourceLen - 4];
+   a32 = 256*a32 + src[sourceLen - 3];
+   a32 = 256*a32 + src[sourceLen - 2];
+   a32 = 256*a32 + src[sourceLen - 1];
+
+   /* -- inflate -- */
+
+   res = tinf_uncompress(dst, destLen, src + 2, sourceLen - 6);
+
+   if (res != TINF_OK) return res;
+
+   /* -- check adler32 checksum -- */
+
+   if (a32 != tinf_adler32(dst, *destLen)) return TINF_DATA_ERROR;
+
+   return TINF_OK;
+}
@@ -0,0 +1,146 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <string.h>
+#include <algorithm>
+
+#include "tokenPreview.h"
+#include "smartDecode.h"
+#include "trace.h"
+
+namespace {
+
+bool isTokenChar(char c, bool withDots)
+{
+	return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+		|| c == '+' || c == '/' || c == '-' || c == '_' || c == '%' || (withDots && c == '.');
+}
+
+TokenSpan scanToken(const char *text, size_t length, size_t at, bool withDots)
+{
+	TokenSpan span;
+	size_t lowest = at > TOKEN_SCAN_MAX ? at - TOKEN_SCAN_MAX : 0;
+	size_t highest = std::min(length, at + TOKEN_SCAN_MAX);
+
+	span.start = at;
+	while (span.start > lowest && isTokenChar(text[span.start - 1], withDots))
+		--span.start;
+	span.end = at;
+	while (span.end < highest && isTokenChar(text[span.end], withDots))
+		++span.end;
+	for (int pad = 0; pad < 2 && span.end < highest && text[span.end] == '='; ++pad)
+		++span.end;
+	return span;
+}
+
+// "eyJ...": base64 of '{"'
+bool isJwt(const char *token, size_t length)
+{
+	return length > 3 && memcmp(token, "eyJ", 3) == 0 && std::count(token, token + length, '.') == 2;
+}
+
+bool isText(const std::string& data)
+{
+	for (char c : data)
+	{
+		unsigned char u = static_cast<unsigned char>(c);
+		if ((u < 0x20 && c != '\t' && c != '\r' && c != '\n') || u == 0x7f)
+			return false;
+	}
+	return true;
+}
+
+// Decode one part of a token, false unless it gives text
+bool decodePart(const char *part, size_t length, std::string& out)
+{
+	if (length > TOKEN_DECODE_MAX)
+		length = TOKEN_DECODE_MAX;    // a multiple of 4 and of 3: whole quads and whole escapes
+	out.clear();
+	CodecOptions options;
+	options.maxOutput = TOKEN_DECODE_OUTPUT_MAX;
+	return smartDecode(part, length, out, options) && !out.empty() && isText(out);
+}
+
+// Calltips are lines of text: CR are dropped and the length is capped
+void appendPreview(const std::string& text, std::string& preview)
+{
+	size_t length = std::min(text.length(), TOKEN_PREVIEW_MAX);
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (text[i] != '\r')
+			preview += text[i];
+	}
+	if (text.length() > length)
+		preview += "...";
+}
+
+}
+
+bool findTokenAround(const char *text, size_t length, size_t at, TokenSpan& span)
+{
+	if (at > length)
+		return false;
+
+	// on the padding, or just past it: the token is before it
+	for (int pad = 0; pad < 2 && at > 0 && (at == length || !isTokenChar(text[at], true)) && text[at - 1] == '='; ++pad)
+		--at;
+
+	// the dots only join the parts of a JWT, or the words of a percent encoded URL
+	span = scanToken(text, length, at, true);
+	const char *token = text + span.start;
+	size_t tokenLength = span.end - span.start;
+	if (!isJwt(token, tokenLength) && !memchr(token, '%', tokenLength))
+		span = scanToken(text, length, at, false);
+	return span.end - span.start >= TOKEN_LENGTH_MIN;
+}
+
+std::string previewToken(const char *token, size_t length)
+{
+	TRACE_SPAN_BYTES("preview token", length);
+
+	std::string preview;
+	std::string decoded;
+	if (isJwt(token, length))
+	{
+		const char *dot = static_cast<const char *>(memchr(token, '.', length));
+		const char *payload = dot + 1;
+		const char *secondDot = static_cast<const char *>(memchr(payload, '.', token + length - payload));
+		if (!decodePart(token, dot - token, decoded))
+			return preview;
+		preview = "JWT header: ";
+		appendPreview(decoded, preview);
+		if (decodePart(payload, secondDot - payload, decoded))
+		{
+			preview += "\npayload: ";
+			appendPreview(decoded, preview);
+		}
+		return preview;
+	}
+
+	if (decodePart(token, length, decoded))
+		appendPreview(decoded, preview);
+	return preview;
+}
+
+const std::string& TokenPreviewCache::preview(const char *token, size_t length)
+{
+	uint64_t key = contentHash(token, length);
+	const std::string *cached = _cache.find(key);
+	if (cached)
+		return *cached;
+	return _cache.insert(key, previewToken(token, length));
+}
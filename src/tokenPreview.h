@@ -0,0 +1,70 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "lruCache.h"
+
+// The token around the caret is looked for at most this far on each side
+constexpr size_t TOKEN_SCAN_MAX = 64 << 10;
+
+// Shorter tokens are words, not encoded data
+constexpr size_t TOKEN_LENGTH_MIN = 12;
+
+// Only the start of a longer token is decoded, and the preview is cut to TOKEN_PREVIEW_MAX.
+// Decoding stops at TOKEN_DECODE_OUTPUT_MAX: a compressed token inflates no further on the UI thread.
+constexpr size_t TOKEN_DECODE_MAX = 48 << 10;
+constexpr size_t TOKEN_PREVIEW_MAX = 1024;
+constexpr size_t TOKEN_DECODE_OUTPUT_MAX = 4 * TOKEN_PREVIEW_MAX;
+
+// Tokens whose preview is kept
+constexpr size_t TOKEN_PREVIEW_CACHE_SIZE = 256;
+
+// [start, end) of a token in a text
+struct TokenSpan
+{
+	size_t start = 0;
+	size_t end = 0;
+};
+
+// The token holding text[at] (or ending just before it): the characters of base64,
+// base64url and percent encoding around it, up to two '=' of padding at its end, and the
+// dots of a JWT or of a percent encoded token. Scans both ways from at, each at most TOKEN_SCAN_MAX.
+// False when at is not in a token of TOKEN_LENGTH_MIN characters or more.
+bool findTokenAround(const char *text, size_t length, size_t at, TokenSpan& span);
+
+// What token decodes to, as text to show: the header and payload of a JWT, or the
+// smartDecode() of the token. Empty when it does not decode to text.
+std::string previewToken(const char *token, size_t length);
+
+// previewToken() through an LRU cache keyed by the hash of the token, so that moving the
+// caret back and forth over the same tokens decodes nothing
+class TokenPreviewCache {
+public:
+	explicit TokenPreviewCache(size_t capacity = TOKEN_PREVIEW_CACHE_SIZE) : _cache(capacity) {};
+
+	const std::string& preview(const char *token, size_t length);
+
+	void clear() { _cache.clear(); };
+
+private:
+	LruCache<uint64_t, std::string> _cache;
+};
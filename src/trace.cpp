@@ -0,0 +1,168 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "trace.h"
+
+// A thread stops recording past this many events, so that a forgotten trace cannot eat the memory
+constexpr size_t TRACE_EVENTS_PER_THREAD_MAX = 1 << 20;
+
+std::atomic<bool> g_traceEnabled{false};
+
+namespace {
+
+struct TraceEvent
+{
+	const char *name;
+	uint64_t startNs;
+	uint64_t endNs;
+	uint64_t bytes;
+};
+
+// The events of one thread; the lock is only ever contended while the trace is written out
+struct ThreadEvents
+{
+	unsigned tid;
+	std::mutex lock;
+	std::vector<TraceEvent> events;
+	size_t dropped = 0;
+};
+
+std::mutex g_threadsLock;
+std::vector<std::shared_ptr<ThreadEvents>> g_threads;   // kept after their thread exits
+uint64_t g_startNs = 0;
+
+ThreadEvents& threadEvents()
+{
+	thread_local std::shared_ptr<ThreadEvents> events = []()
+	{
+		std::shared_ptr<ThreadEvents> created = std::make_shared<ThreadEvents>();
+		std::lock_guard<std::mutex> guard(g_threadsLock);
+		created->tid = unsigned(g_threads.size() + 1);
+		g_threads.push_back(created);
+		return created;
+	}();
+	return *events;
+}
+
+void appendQuoted(std::string& json, const char *text)
+{
+	json += '"';
+	for (const char *p = text; *p; ++p)
+	{
+		if (*p == '"' || *p == '\\')
+			json += '\\';
+		if (static_cast<unsigned char>(*p) >= 0x20)
+			json += *p;
+	}
+	json += '"';
+}
+
+} // namespace
+
+uint64_t traceNowNs()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void traceComplete(const char *name, uint64_t startNs, uint64_t endNs, uint64_t bytes)
+{
+	ThreadEvents& thread = threadEvents();
+	std::lock_guard<std::mutex> guard(thread.lock);
+	if (thread.events.size() >= TRACE_EVENTS_PER_THREAD_MAX)
+	{
+		++thread.dropped;
+		return;
+	}
+	thread.events.push_back({name, startNs, endNs, bytes});
+}
+
+void startTrace()
+{
+	std::lock_guard<std::mutex> guard(g_threadsLock);
+	for (const std::shared_ptr<ThreadEvents>& thread : g_threads)
+	{
+		std::lock_guard<std::mutex> threadGuard(thread->lock);
+		thread->events.clear();
+		thread->dropped = 0;
+	}
+	g_startNs = traceNowNs();
+	g_traceEnabled = true;
+}
+
+void stopTrace()
+{
+	g_traceEnabled = false;
+}
+
+size_t traceEventCount()
+{
+	size_t count = 0;
+	std::lock_guard<std::mutex> guard(g_threadsLock);
+	for (const std::shared_ptr<ThreadEvents>& thread : g_threads)
+	{
+		std::lock_guard<std::mutex> threadGuard(thread->lock);
+		count += thread->events.size();
+	}
+	return count;
+}
+
+std::string traceJson()
+{
+	std::string json = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	char number[160];
+	bool first = true;
+
+	std::lock_guard<std::mutex> guard(g_threadsLock);
+	for (const std::shared_ptr<ThreadEvents>& thread : g_threads)
+	{
+		std::lock_guard<std::mutex> threadGuard(thread->lock);
+		if (thread->events.empty())
+			continue;
+
+		snprintf(number, sizeof(number), "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"thread %u\"}}",
+			first ? "" : ",\n", thread->tid, thread->tid);
+		json += number;
+		first = false;
+
+		for (const TraceEvent& event : thread->events)
+		{
+			// a span open when the trace started is cut at the start
+			uint64_t start = event.startNs > g_startNs ? event.startNs - g_startNs : 0;
+			uint64_t end = event.endNs > g_startNs ? event.endNs - g_startNs : 0;
+
+			json += ",\n{\"name\": ";
+			appendQuoted(json, event.name);
+			snprintf(number, sizeof(number), ", \"cat\": \"mimetools\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"bytes\": %llu}}",
+				thread->tid, double(start) / 1e3, double(end - start) / 1e3, (unsigned long long)event.bytes);
+			json += number;
+		}
+		if (thread->dropped)
+		{
+			snprintf(number, sizeof(number), ",\n{\"name\": \"events dropped\", \"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": %u, \"ts\": 0, \"args\": {\"count\": %zu}}",
+				thread->tid, thread->dropped);
+			json += number;
+		}
+	}
+	json += "\n]}\n";
+	return json;
+}
@@ -0,0 +1,94 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+// Compile-time switch: build with MIMETOOLS_TRACE=0 to leave no trace code at all
+#ifndef MIMETOOLS_TRACE
+#define MIMETOOLS_TRACE 1
+#endif
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+// Scoped spans of the conversion stages, exported as Chrome trace events (a "complete"
+// event per span, with its thread) to be loaded in chrome://tracing or Perfetto.
+//
+//	{
+//		TRACE_SPAN_BYTES("base64 decode", length);
+//		...
+//	}
+//
+// Span names must be string literals (or other strings that live as long as the program).
+// While tracing is off, a span costs one relaxed atomic load.
+// Each thread appends to its own buffer, so spans on worker threads do not contend.
+
+extern std::atomic<bool> g_traceEnabled;
+
+inline bool traceEnabled()
+{
+	return g_traceEnabled.load(std::memory_order_relaxed);
+}
+
+// Forget the events recorded so far and start recording
+void startTrace();
+void stopTrace();
+
+size_t traceEventCount();
+
+// {"traceEvents": [...]} with timestamps in microseconds since startTrace()
+std::string traceJson();
+
+uint64_t traceNowNs();
+void traceComplete(const char *name, uint64_t startNs, uint64_t endNs, uint64_t bytes);
+
+class TraceSpan {
+public:
+	explicit TraceSpan(const char *name, uint64_t bytes = 0) : _name(traceEnabled() ? name : nullptr), _bytes(bytes)
+	{
+		if (_name)
+			_startNs = traceNowNs();
+	};
+
+	~TraceSpan()
+	{
+		if (_name)
+			traceComplete(_name, _startNs, traceNowNs(), _bytes);
+	};
+
+	// Bytes known only at the end of the stage
+	void setBytes(uint64_t bytes) { _bytes = bytes; };
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+	const char *_name;
+	uint64_t _bytes;
+	uint64_t _startNs = 0;
+};
+
+#if MIMETOOLS_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_SPAN_BYTES(name, bytes) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, bytes)
+#else
+#define TRACE_SPAN(name) ((void)0)
+#define TRACE_SPAN_BYTES(name, bytes) ((void)sizeof(bytes))
+#endif
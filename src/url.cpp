@@ -16,8 +16,6 @@
 
 
 #include <string.h>
-#include <string>
-#include <ctype.h>
 
 #include "url.h"
 
@@ -81,20 +79,65 @@ static const char gExtendedChar[] = "!*'()+$,";
 
 static const char gHexChar[] = "0123456789ABCDEF";
 
+// What each byte needs, looked up instead of searched for in the strings above
+enum UrlCharFlag {
+  urlEncodedRFC1738 = 1,    // reserved, or not printable
+  urlEncodedExtended = 2,   // the same, or one of gExtendedChar
+  urlEol = 4
+};
+
+struct UrlCharTables
+{
+  unsigned char flags[256];
+  signed char hexValue[256];   // -1 if not an hex digit
+
+  UrlCharTables()
+  {
+    for (int c = 0; c < 256; ++c)
+    {
+      // isprint() in the "C" locale, without its undefined behaviour for negative chars
+      bool printable = c >= 0x20 && c < 0x7F;
+      bool reserved = c != 0 && strchr(gReservedAscii, c) != nullptr;
+      bool extended = c != 0 && strchr(gExtendedChar, c) != nullptr;
+
+      flags[c] = 0;
+      if (!printable || reserved)
+        flags[c] |= urlEncodedRFC1738 | urlEncodedExtended;
+      if (extended)
+        flags[c] |= urlEncodedExtended;
+      if (c == '\r' || c == '\n')
+        flags[c] |= urlEol;
+
+      if (c >= '0' && c <= '9')
+        hexValue[c] = static_cast<signed char>(c - '0');
+      else if (c >= 'A' && c <= 'F')
+        hexValue[c] = static_cast<signed char>(c - 'A' + 10);
+      else if (c >= 'a' && c <= 'f')
+        hexValue[c] = static_cast<signed char>(c - 'a' + 10);
+      else
+        hexValue[c] = -1;
+    }
+  }
+};
+
+static const UrlCharTables& urlCharTables()
+{
+  static const UrlCharTables tables;
+  return tables;
+}
+
 int AsciiToUrl(char* dest, const char* src, int destSize, UrlEncodeMethod method, bool isByLine)
 {
   int i;
-  memset (dest, 0, destSize);
-  std::string reservedAscii = gReservedAscii;
-  
-  if (method == UrlEncodeMethod::extended)
-      reservedAscii += gExtendedChar;
+
+  const unsigned char *flags = urlCharTables().flags;
+  unsigned char encodedFlag = method == UrlEncodeMethod::extended ? urlEncodedExtended : urlEncodedRFC1738;
 
   for (i = 0; (i < (destSize - 2)) && *src; ++i, ++src)
   {
-    if ((isByLine ? (strchr("\r\n", *src) != nullptr ? false : true) : true) &&       // if "by line" is demanded and current char is EOL, the false is returned to stop remain tests and EOL is not treated. Otherwise (true) we keep testing... 
-        (method == UrlEncodeMethod::full ||                                           // if encode method is full, true is return to stop remain tests, then we convert the char whatever it is. Otherwise (true) we keep testing...
-            ((strchr(reservedAscii.c_str(), *src) != nullptr) || !isprint(*src))))    // Here we convert only reserved characters or non-printable characters.
+    unsigned char charFlags = flags[static_cast<unsigned char>(*src)];
+    if ((!isByLine || !(charFlags & urlEol)) &&                                       // if "by line" is demanded, EOL is not treated
+        (method == UrlEncodeMethod::full || (charFlags & encodedFlag)))               // full encoding converts every char, the others only reserved or non-printable characters
     {
       *dest++ = '%';
       *dest++ = gHexChar [((*src >> 4) & 0x0f)];
@@ -107,16 +150,18 @@ int AsciiToUrl(char* dest, const char* src, int destSize, UrlEncodeMethod method
     }
   }
 
+  // only the terminator is written past the output: clearing all of dest cost as much as encoding
+  if (i < destSize)
+    *dest = '\0';
   return i;  // return characters stored to destination
 }
 
 
 int UrlToAscii (char* dest, const char* src, int destSize)
 {
-  char	val;
-  int i, j;
+  int i;
 
-  memset (dest, 0, destSize);
+  const signed char *hexValue = urlCharTables().hexValue;
 
   for (i = 0; (i < destSize) && *src; ++i)
   {
@@ -127,32 +172,15 @@ int UrlToAscii (char* dest, const char* src, int destSize)
       // Found an encoded triplet.
       // The next two characters must be hex.
       //
-      if (isxdigit(src[0]) && isxdigit(src[1]))
-      {
-        for (val = 0, j = 0; j < 2; ++j, ++src)
-        {
-          val <<= 4;
-
-          if (isdigit(*src))
-          {
-            val += *src - '0';
-          }
-          else if (isupper(*src))
-          {
-            val += *src - 'A' + 10;
-          }
-          else
-          {
-            val += *src - 'a' + 10;
-          }
-        }
-
-        *dest++ = val;
-      }
-      else  // invalid encoding
+      int hi = hexValue[static_cast<unsigned char>(src[0])];
+      int lo = hi < 0 ? -1 : hexValue[static_cast<unsigned char>(src[1])];
+      if (lo < 0)  // invalid encoding
       {
         return -1;
       }
+
+      *dest++ = static_cast<char>(hi << 4 | lo);
+      src += 2;
     }
     else  // non-encoded character, so just copy it
     {
@@ -161,5 +189,7 @@ int UrlToAscii (char* dest, const char* src, int destSize)
     }
   }
 
+  if (i < destSize)
+    *dest = '\0';
   return i;
-}
\ No newline at end of file
+}
@@ -0,0 +1,86 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <map>
+#include <string>
+
+#include "viewportDecode.h"
+#include "lineDecode.h"
+#include "Scintilla.h"
+#include "trace.h"
+
+// Shared by both views: the same log is often open in both
+static LineDecodeCache g_lineDecodeCache;
+
+// The document each view was last annotated in. A document newly shown in a view has all
+// its annotations cleared first, those of "Base64 Decode every run" included: the two
+// would otherwise replace each other line by line.
+static std::map<HWND, sptr_t> g_annotatedDocuments;
+
+// Does line already show annotation? Setting an annotation lays the view out again.
+static bool hasAnnotation(HWND hScintilla, size_t line, const std::string& annotation, std::string& current)
+{
+	size_t length = ::SendMessage(hScintilla, SCI_ANNOTATIONGETTEXT, line, 0);
+	if (length != annotation.length())
+		return false;
+	if (length == 0)
+		return true;
+	current.resize(length + 1);
+	::SendMessage(hScintilla, SCI_ANNOTATIONGETTEXT, line, (LPARAM)&current[0]);
+	return annotation.compare(0, length, current.c_str(), length) == 0;
+}
+
+void annotateVisibleLines(HWND hScintilla)
+{
+	TRACE_SPAN("annotate visible lines");
+
+	size_t lineCount = ::SendMessage(hScintilla, SCI_GETLINECOUNT, 0, 0);
+	size_t firstVisible = ::SendMessage(hScintilla, SCI_GETFIRSTVISIBLELINE, 0, 0);
+	size_t linesOnScreen = ::SendMessage(hScintilla, SCI_LINESONSCREEN, 0, 0);
+	size_t first = ::SendMessage(hScintilla, SCI_DOCLINEFROMVISIBLE, firstVisible, 0);
+	size_t last = ::SendMessage(hScintilla, SCI_DOCLINEFROMVISIBLE, firstVisible + linesOnScreen, 0);
+	if (last >= lineCount)
+		last = lineCount - 1;
+
+	sptr_t document = ::SendMessage(hScintilla, SCI_GETDOCPOINTER, 0, 0);
+	auto annotated = g_annotatedDocuments.find(hScintilla);
+	if (annotated == g_annotatedDocuments.end() || annotated->second != document)
+	{
+		::SendMessage(hScintilla, SCI_ANNOTATIONCLEARALL, 0, 0);
+		g_annotatedDocuments[hScintilla] = document;
+	}
+
+	std::string current;
+	for (size_t line = first; line <= last; ++line)
+	{
+		size_t start = ::SendMessage(hScintilla, SCI_POSITIONFROMLINE, line, 0);
+		size_t end = ::SendMessage(hScintilla, SCI_GETLINEENDPOSITION, line, 0);
+		const char *text = (const char *)::SendMessage(hScintilla, SCI_GETRANGEPOINTER, start, end - start);
+
+		const std::string& annotation = g_lineDecodeCache.decode(text, end - start);
+		if (!hasAnnotation(hScintilla, line, annotation, current))
+			::SendMessage(hScintilla, SCI_ANNOTATIONSETTEXT, line, annotation.empty() ? 0 : (LPARAM)annotation.c_str());
+	}
+	::SendMessage(hScintilla, SCI_ANNOTATIONSETVISIBLE, ANNOTATION_BOXED, 0);
+}
+
+void clearVisibleLineAnnotations(HWND hScintilla)
+{
+	::SendMessage(hScintilla, SCI_ANNOTATIONCLEARALL, 0, 0);
+	g_annotatedDocuments.erase(hScintilla);
+	g_lineDecodeCache.clear();
+}
@@ -0,0 +1,29 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <windows.h>
+
+// Show what the lines visible in hScintilla carry once decoded, as annotations below them
+// (see lineDecode.h). Called whenever the view scrolls or changes: the lines out of the
+// viewport are never decoded, and the ones already seen come from a cache.
+// The annotations a document holds when it is first annotated are removed.
+void annotateVisibleLines(HWND hScintilla);
+
+// Remove the annotations of hScintilla and forget the decoded lines
+void clearVisibleLineAnnotations(HWND hScintilla);
@@ -0,0 +1,301 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include <string.h>
+
+#include "xmlFormat.h"
+
+static const char cdataPrefix[] = "<![CDATA[";
+static const char commentPrefix[] = "<!--";
+
+static bool isXmlSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void XmlFormatter::newLine(std::string& out, int depth)
+{
+	if (!_atStart)
+		out += _eol;
+	_atStart = false;
+
+	if (depth > XML_FORMAT_INDENT_DEPTH_MAX)
+		depth = XML_FORMAT_INDENT_DEPTH_MAX;
+	for (int i = 0; i < depth; ++i)
+		out += _indent;
+}
+
+void XmlFormatter::beginMarkup(std::string& out, int depth)
+{
+	newLine(out, depth);
+	_inlineContent = false;
+}
+
+void XmlFormatter::format(const char *xml, size_t length, std::string& out)
+{
+	out.reserve(out.size() + length + length / 8);
+
+	for (size_t i = 0; i < length; ++i)
+	{
+		char c = xml[i];
+
+		switch (_state)
+		{
+			case text:
+			{
+				if (c == '<')
+				{
+					_pendingSpace.clear();
+					_textStarted = false;
+					_state = markupStart;
+				}
+				else if (isXmlSpace(c))
+				{
+					if (_textStarted)
+						_pendingSpace += c;
+				}
+				else
+				{
+					if (!_textStarted)
+					{
+						// text right after a start tag stays on its line
+						if (!_inlineContent)
+							newLine(out, _depth);
+						_textStarted = true;
+					}
+					else if (!_pendingSpace.empty())
+					{
+						out += _pendingSpace;
+						_pendingSpace.clear();
+					}
+
+					// copy the rest of the run at once
+					size_t end = i + 1;
+					while (end < length && xml[end] != '<' && !isXmlSpace(xml[end]))
+						++end;
+					out.append(xml + i, end - i);
+					i = end - 1;
+				}
+				break;
+			}
+
+			case markupStart:
+			{
+				if (c == '/')
+				{
+					if (_depth > 0)
+						--_depth;
+					if (!_inlineContent)
+						newLine(out, _depth);
+					out += "</";
+					_state = endTag;
+				}
+				else if (c == '?')
+				{
+					beginMarkup(out, _depth);
+					out += "<?";
+					_prevChar = 0;
+					_state = procInstr;
+				}
+				else if (c == '!')
+				{
+					_bangPrefix = "<!";
+					_state = bang;
+				}
+				else
+				{
+					beginMarkup(out, _depth);
+					out += '<';
+					out += c;
+					_quote = 0;
+					_prevChar = c;
+					_state = startTag;
+				}
+				break;
+			}
+
+			case bang:
+			{
+				_bangPrefix += c;
+				size_t len = _bangPrefix.length();
+
+				if (len == sizeof(commentPrefix) - 1 && _bangPrefix == commentPrefix)
+				{
+					beginMarkup(out, _depth);
+					out += _bangPrefix;
+					_closingRun = 0;
+					_state = comment;
+				}
+				else if (len == sizeof(cdataPrefix) - 1 && _bangPrefix == cdataPrefix)
+				{
+					// CDATA is content: like text, it stays on the line of its start tag
+					if (!_inlineContent)
+						newLine(out, _depth);
+					out += _bangPrefix;
+					_closingRun = 0;
+					_state = cdata;
+				}
+				else if (!(len < sizeof(commentPrefix) - 1 && _bangPrefix.compare(0, len, commentPrefix, len) == 0)
+					&& !(len < sizeof(cdataPrefix) - 1 && _bangPrefix.compare(0, len, cdataPrefix, len) == 0))
+				{
+					// <!DOCTYPE and friends: the lookahead chars belong to the declaration
+					beginMarkup(out, _depth);
+					out += "<!";
+					_bracketDepth = 0;
+					_state = declaration;
+
+					std::string rest = _bangPrefix.substr(2);
+					_bangPrefix.clear();
+					format(rest.c_str(), rest.length(), out);
+				}
+				break;
+			}
+
+			case startTag:
+			{
+				if (_quote)
+				{
+					if (c == _quote)
+						_quote = 0;
+					out += c;
+				}
+				else if (c == '"' || c == '\'')
+				{
+					_quote = c;
+					out += c;
+				}
+				else if (c == '>')
+				{
+					out += c;
+					if (_prevChar == '/')
+					{
+						_inlineContent = false;
+					}
+					else
+					{
+						++_depth;
+						_inlineContent = true;
+					}
+					_state = text;
+				}
+				else if (isXmlSpace(c))
+				{
+					// attributes spread over several lines are joined
+					if (_prevChar != ' ')
+						out += ' ';
+					c = ' ';
+				}
+				else
+				{
+					out += c;
+				}
+				_prevChar = c;
+				break;
+			}
+
+			case endTag:
+			{
+				if (!isXmlSpace(c))
+					out += c;
+				if (c == '>')
+				{
+					_inlineContent = false;
+					_state = text;
+				}
+				break;
+			}
+
+			case procInstr:
+			{
+				out += c;
+				if (c == '>' && _prevChar == '?')
+					_state = text;
+				_prevChar = c;
+				break;
+			}
+
+			case comment:
+			case cdata:
+			{
+				const char closing = _state == comment ? '-' : ']';
+
+				// copy up to the next possible terminator at once
+				const char *stop = static_cast<const char *>(memchr(xml + i, '>', length - i));
+				size_t end = stop ? size_t(stop - xml) : length;
+				for (; i < end; ++i)
+				{
+					out += xml[i];
+					_closingRun = (xml[i] == closing) ? _closingRun + 1 : 0;
+				}
+				if (stop)
+				{
+					out += '>';
+					if (_closingRun >= 2)
+					{
+						if (_state == comment)
+							_inlineContent = false;
+						_state = text;
+					}
+					_closingRun = 0;
+				}
+				else
+				{
+					--i;
+				}
+				break;
+			}
+
+			case declaration:
+			{
+				out += c;
+				if (c == '[')
+					++_bracketDepth;
+				else if (c == ']')
+					--_bracketDepth;
+				else if (c == '>' && _bracketDepth <= 0)
+					_state = text;
+				break;
+			}
+		}
+	}
+}
+
+void XmlFormatter::finish(std::string& out)
+{
+	// an unterminated "<!" lookahead is written back as it is
+	if (_state == bang)
+		out += _bangPrefix;
+	else if (_state == markupStart)
+		out += '<';
+
+	_state = text;
+	_depth = 0;
+	_atStart = true;
+	_inlineContent = false;
+	_textStarted = false;
+	_pendingSpace.clear();
+	_bangPrefix.clear();
+}
+
+std::string XmlFormatter::formatString(const char *xml, size_t length, const char *eol)
+{
+	XmlFormatter formatter(eol);
+	std::string out;
+	formatter.format(xml, length, out);
+	formatter.finish(out);
+	return out;
+}
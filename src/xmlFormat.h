@@ -0,0 +1,87 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <string>
+
+// Deeper elements are indented as if they were at this depth, so that the output
+// size (and the formatting time) stays linear whatever the nesting.
+constexpr int XML_FORMAT_INDENT_DEPTH_MAX = 64;
+
+// Streaming XML pretty-printer.
+//
+// The input is read in one forward pass, chunk after chunk, without building any tree:
+// each start tag, end tag, comment or processing instruction starts a new line indented
+// by the current depth, while an element holding only text (or CDATA) stays on one line:
+//
+//	<samlp:Response ID="_8e8dc5f69a98cc4c1ff3427e5ce34606fd672f91e6">
+//	  <saml:Issuer>http://idp.example.com/metadata.php</saml:Issuer>
+//	  <samlp:Status>
+//	    <samlp:StatusCode Value="urn:oasis:names:tc:SAML:2.0:status:Success"/>
+//	  </samlp:Status>
+//	</samlp:Response>
+//
+// Tags are copied as they are (prefixes and attributes included, a '>' inside a quoted
+// attribute value does not end the tag), CDATA sections and comments are copied verbatim.
+// Whitespace between markup is dropped and leading/trailing whitespace of text is trimmed.
+// Formatted output is appended to the string given to each call, so the caller can hand
+// it over and clear it after every chunk.
+
+class XmlFormatter {
+
+public:
+	XmlFormatter(const char *eol = "\n", const char *indent = "  ") : _eol(eol), _indent(indent) {};
+
+	void format(const char *xml, size_t length, std::string& out);
+	void finish(std::string& out);
+
+	// one shot helper
+	static std::string formatString(const char *xml, size_t length, const char *eol = "\n");
+
+private:
+	enum State {
+		text,          // character data
+		markupStart,   // after '<', kind of markup not known yet
+		bang,          // after "<!", waiting for enough chars to tell comment, CDATA or declaration
+		startTag,
+		endTag,
+		procInstr,     // <? ... ?>
+		comment,       // <!-- ... -->
+		cdata,         // <![CDATA[ ... ]]>
+		declaration    // <!DOCTYPE ... > (with optional [ internal subset ])
+	};
+
+	std::string _eol;
+	std::string _indent;
+
+	State _state = text;
+	int _depth = 0;
+	bool _atStart = true;         // nothing written yet
+	bool _inlineContent = false;  // only text seen since the last start tag: its end tag stays on the same line
+	bool _textStarted = false;    // non blank text already written for the current text run
+	std::string _pendingSpace;    // whitespace inside text, written only if more text follows
+	std::string _bangPrefix;      // "<!" lookahead, at most "<![CDATA["
+
+	char _quote = 0;              // quote opened inside a tag
+	char _prevChar = 0;           // previous char inside the current markup
+	int _closingRun = 0;          // count of trailing '-' or ']' seen (comment / CDATA end detection)
+	int _bracketDepth = 0;        // declaration internal subset
+
+	void newLine(std::string& out, int depth);
+	void beginMarkup(std::string& out, int depth);
+};
@@ -0,0 +1,391 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ConversionJob against a Scintilla view simulated in memory: the worker, cancellation,
+// the check that the converted text is still where it was before replacing it, and the
+// document kept read-only meanwhile
+
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "test.h"
+#include "codec.h"
+#include "conversionJob.h"
+
+namespace {
+
+// The few messages ConversionJob sends, on documents held as strings
+class MockScintilla {
+public:
+	MockScintilla()
+	{
+		_current = newDocument("");
+	};
+
+	sptr_t newDocument(const std::string& text)
+	{
+		sptr_t document = sptr_t(_documents.size() + 1);
+		_documents[document] = text;
+		return document;
+	};
+
+	void show(sptr_t document) { _current = document; };
+	std::string& text() { return _documents[_current]; };
+	int references(sptr_t document) { return _references[document]; };
+	bool isReadOnly(sptr_t document) { return _readOnly[document]; };
+	size_t selectionStart() const { return _selectionStart; };
+	size_t selectionEnd() const { return _selectionEnd; };
+
+	ScintillaCall call()
+	{
+		return [this](unsigned int message, uptr_t wParam, sptr_t lParam) { return send(message, wParam, lParam); };
+	};
+
+private:
+	sptr_t send(unsigned int message, uptr_t wParam, sptr_t lParam)
+	{
+		std::string& current = text();
+		switch (message)
+		{
+			case SCI_GETDOCPOINTER:
+				return _current;
+			case SCI_ADDREFDOCUMENT:
+				++_references[lParam];
+				return 0;
+			case SCI_RELEASEDOCUMENT:
+				--_references[lParam];
+				return 0;
+			case SCI_GETLENGTH:
+				return sptr_t(current.length());
+			case SCI_GETRANGEPOINTER:
+				return wParam + lParam <= current.length() ? reinterpret_cast<sptr_t>(current.data() + wParam) : 0;
+			case SCI_SETTARGETRANGE:
+				_targetStart = wParam;
+				_targetEnd = size_t(lParam);
+				return 0;
+			case SCI_GETREADONLY:
+				return _readOnly[_current];
+			case SCI_SETREADONLY:
+				_readOnly[_current] = wParam != 0;
+				return 0;
+			case SCI_REPLACETARGET:
+				if (_readOnly[_current])
+					return 0;
+				current.replace(_targetStart, _targetEnd - _targetStart, reinterpret_cast<const char *>(lParam), wParam);
+				return sptr_t(wParam);
+			case SCI_SETSEL:
+				_selectionStart = wParam;
+				_selectionEnd = size_t(lParam);
+				return 0;
+			default:
+				CHECK(!"unexpected Scintilla message");
+				return 0;
+		}
+	};
+
+	std::map<sptr_t, std::string> _documents;
+	std::map<sptr_t, int> _references;
+	std::map<sptr_t, bool> _readOnly;
+	sptr_t _current = 0;
+	size_t _targetStart = 0;
+	size_t _targetEnd = 0;
+	size_t _selectionStart = 0;
+	size_t _selectionEnd = 0;
+};
+
+// Copies its input, but its first process() waits until the test opens the gate.
+// Each call also runs a parallelFor(), which a cancelled job must stop.
+class GatedCodec : public Codec {
+public:
+	bool process(const char *text, size_t length, std::string& out) override
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			++_processCalls;
+			_entered.notify_all();
+			_opened.wait(lock, [this]() { return _open; });
+		}
+		std::atomic<size_t> items(0);
+		_lastParallelForDone = parallelFor(64, [&](size_t) { ++items; });
+		out.append(text, length);
+		return true;
+	};
+
+	bool finish(std::string& /*out*/) override
+	{
+		++_finishCalls;
+		return true;
+	};
+
+	void waitEntered()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_entered.wait(lock, [this]() { return _processCalls > 0; });
+	};
+
+	void open()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_open = true;
+		_opened.notify_all();
+	};
+
+	int processCalls() const { return _processCalls; };
+	int finishCalls() const { return _finishCalls; };
+	bool lastParallelForDone() const { return _lastParallelForDone; };
+
+private:
+	std::mutex _mutex;
+	std::condition_variable _entered;
+	std::condition_variable _opened;
+	bool _open = false;
+	std::atomic<int> _processCalls{0};
+	std::atomic<int> _finishCalls{0};
+	std::atomic<bool> _lastParallelForDone{false};
+};
+
+std::string generatedText(size_t length)
+{
+	std::string text(length, '\0');
+	for (size_t i = 0; i < length; ++i)
+		text[i] = char(' ' + (i * 7 + i / 97) % 95);
+	return text;
+}
+
+}
+
+TEST(conversionJobApplies)
+{
+	MockScintilla scintilla;
+	std::string payload = generatedText(3 * CONVERSION_PIECE_SIZE + 1000);
+	scintilla.text() = "before " + payload + " after";
+	sptr_t document = scintilla.call()(SCI_GETDOCPOINTER, 0, 0);
+
+	std::string expected;
+	CHECK(convertText(CodecId::base64EncodeWrap, payload.data(), payload.length(), expected));
+
+	std::atomic<bool> finished(false);
+	{
+		ConversionJob job(scintilla.call(), 7, 7 + payload.length(), createCodec(CodecId::base64EncodeWrap));
+		CHECK(scintilla.references(document) == 1);
+
+		job.start([&finished]() { finished = true; });
+		job.join();
+		CHECK(finished);
+		CHECK(job.ok());
+		CHECK(!job.isCancelled());
+		CHECK(job.progress() == 1);
+		CHECK(job.output() == expected);
+
+		CHECK(job.isTargetUnchanged());
+		CHECK(job.apply());
+		CHECK(scintilla.text() == "before " + expected + " after");
+		CHECK(scintilla.selectionStart() == 7);
+		CHECK(scintilla.selectionEnd() == 7 + expected.length());
+	}
+	CHECK(scintilla.references(document) == 0);
+}
+
+TEST(conversionJobReportsCodecError)
+{
+	MockScintilla scintilla;
+	scintilla.text() = "QUJD!RA==";
+
+	ConversionJob job(scintilla.call(), 0, scintilla.text().length(), createCodec(CodecId::base64DecodeStrict));
+	job.start(nullptr);
+	job.join();
+	CHECK(!job.ok());
+	CHECK(*job.errorMessage() != '\0');
+	CHECK(scintilla.text() == "QUJD!RA==");
+}
+
+TEST(conversionJobCancel)
+{
+	MockScintilla scintilla;
+	scintilla.text() = generatedText(4 * CONVERSION_PIECE_SIZE);
+	std::string original = scintilla.text();
+
+	GatedCodec *codec = new GatedCodec;
+	std::atomic<bool> finished(false);
+	ConversionJob job(scintilla.call(), 0, original.length(), std::unique_ptr<Codec>(codec));
+	job.start([&finished]() { finished = true; });
+
+	// cancelled while converting the first piece: no other piece is started, finish() is
+	// not called, and the parallel loops of the codec stop
+	codec->waitEntered();
+	job.cancel();
+	codec->open();
+	job.join();
+
+	CHECK(finished);
+	CHECK(job.isCancelled());
+	CHECK(codec->processCalls() == 1);
+	CHECK(codec->finishCalls() == 0);
+	CHECK(!codec->lastParallelForDone());
+	CHECK(job.progress() < 1);
+	CHECK(scintilla.text() == original);
+}
+
+TEST(conversionJobCancelledOnDestruction)
+{
+	MockScintilla scintilla;
+	scintilla.text() = generatedText(2 * CONVERSION_PIECE_SIZE);
+	sptr_t document = scintilla.call()(SCI_GETDOCPOINTER, 0, 0);
+
+	// the destructor cancels and waits for the worker, held in the codec for a while
+	GatedCodec *codec = new GatedCodec;
+	std::thread opener;
+	{
+		ConversionJob job(scintilla.call(), 0, scintilla.text().length(), std::unique_ptr<Codec>(codec));
+		job.start(nullptr);
+		codec->waitEntered();
+		opener = std::thread([codec]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			codec->open();
+		});
+	}
+	opener.join();
+	CHECK(scintilla.references(document) == 0);
+}
+
+TEST(conversionJobTargetChanged)
+{
+	const std::string text = "0123456789abcdef";
+
+	// the converted text was edited
+	{
+		MockScintilla scintilla;
+		scintilla.text() = text;
+		ConversionJob job(scintilla.call(), 4, 12, createCodec(CodecId::base64Encode));
+		job.start(nullptr);
+		job.join();
+		scintilla.text()[5] = 'X';
+		CHECK(!job.isTargetUnchanged());
+		CHECK(!job.apply());
+		CHECK(scintilla.text() == "01234X6789abcdef");
+	}
+
+	// text was removed before it
+	{
+		MockScintilla scintilla;
+		scintilla.text() = text;
+		ConversionJob job(scintilla.call(), 4, 12, createCodec(CodecId::base64Encode));
+		job.start(nullptr);
+		job.join();
+		scintilla.text().erase(0, 1);
+		CHECK(!job.apply());
+	}
+
+	// the document got shorter than the end of the target
+	{
+		MockScintilla scintilla;
+		scintilla.text() = text;
+		ConversionJob job(scintilla.call(), 4, 12, createCodec(CodecId::base64Encode));
+		job.start(nullptr);
+		job.join();
+		scintilla.text().resize(10);
+		CHECK(!job.apply());
+	}
+
+	// the view shows another document holding the same text
+	{
+		MockScintilla scintilla;
+		scintilla.text() = text;
+		sptr_t first = scintilla.call()(SCI_GETDOCPOINTER, 0, 0);
+		ConversionJob job(scintilla.call(), 4, 12, createCodec(CodecId::base64Encode));
+		job.start(nullptr);
+		job.join();
+		scintilla.show(scintilla.newDocument(text));
+		CHECK(!job.apply());
+		CHECK(scintilla.text() == text);
+		scintilla.show(first);
+		CHECK(job.apply());
+		CHECK(scintilla.text() == "0123NDU2Nzg5YWIcdef");
+	}
+}
+
+TEST(conversionJobReadOnly)
+{
+	const std::string text = "0123456789abcdef";
+
+	// read-only while it runs, writable again to be replaced
+	{
+		MockScintilla scintilla;
+		scintilla.text() = text;
+		sptr_t document = scintilla.call()(SCI_GETDOCPOINTER, 0, 0);
+		ConversionJob job(scintilla.call(), 0, text.length(), createCodec(CodecId::base64Encode), true);
+		CHECK(scintilla.isReadOnly(document));
+		job.start(nullptr);
+		job.join();
+		CHECK(job.apply());
+		CHECK(!scintilla.isReadOnly(document));
+		CHECK(scintilla.text() == "MDEyMzQ1Njc4OWFiY2RlZg");
+	}
+
+	// cancelled: writable again once destroyed
+	{
+		MockScintilla scintilla;
+		scintilla.text() = generatedText(2 * CONVERSION_PIECE_SIZE);
+		sptr_t document = scintilla.call()(SCI_GETDOCPOINTER, 0, 0);
+		GatedCodec *codec = new GatedCodec;
+		{
+			ConversionJob job(scintilla.call(), 0, scintilla.text().length(), std::unique_ptr<Codec>(codec), true);
+			job.start(nullptr);
+			codec->waitEntered();
+			job.cancel();
+			codec->open();
+			job.join();
+			CHECK(scintilla.isReadOnly(document));
+		}
+		CHECK(!scintilla.isReadOnly(document));
+	}
+
+	// a document read-only beforehand stays so, and is not replaced
+	{
+		MockScintilla scintilla;
+		scintilla.text() = text;
+		sptr_t document = scintilla.call()(SCI_GETDOCPOINTER, 0, 0);
+		scintilla.call()(SCI_SETREADONLY, 1, 0);
+		ConversionJob job(scintilla.call(), 0, text.length(), createCodec(CodecId::base64Encode), true);
+		job.start(nullptr);
+		job.join();
+		job.apply();
+		CHECK(scintilla.isReadOnly(document));
+		CHECK(scintilla.text() == text);
+	}
+
+	// the view shows another document at the end: that one is left alone
+	{
+		MockScintilla scintilla;
+		scintilla.text() = text;
+		sptr_t other = scintilla.newDocument(text);
+		{
+			ConversionJob job(scintilla.call(), 0, text.length(), createCodec(CodecId::base64Encode), true);
+			job.start(nullptr);
+			job.join();
+			scintilla.show(other);
+			scintilla.call()(SCI_SETREADONLY, 1, 0);
+		}
+		CHECK(scintilla.isReadOnly(other));
+	}
+}
@@ -0,0 +1,184 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// tdeflate against tinflate at every level, and SAML Encode against SAML Decode, on the
+// inputs a compressor gets wrong: nothing, a single byte, bytes it cannot compress and
+// long repetitions
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "codec.h"
+#include "saml.h"
+#include "smartDecode.h"
+#include "tdef.h"
+#include "tinf.h"
+#include "tokenPreview.h"
+
+namespace {
+
+std::string randomBytes(size_t length)
+{
+	std::string bytes(length, '\0');
+	uint32_t state = 2463534242u;
+	for (size_t i = 0; i < length; ++i)
+	{
+		state = state * 1103515245 + 12345;
+		bytes[i] = char(state >> 24);
+	}
+	return bytes;
+}
+
+std::string repeated(const std::string& pattern, size_t length)
+{
+	std::string text;
+	while (text.length() < length)
+		text += pattern;
+	text.resize(length);
+	return text;
+}
+
+bool deflateRoundTrip(const std::string& input, int level)
+{
+	unsigned int deflatedLength = tdef_bound(unsigned(input.length()));
+	std::vector<char> deflated(deflatedLength);
+	if (tdef_compress(deflated.data(), &deflatedLength, input.data(), unsigned(input.length()), level) != TDEF_OK)
+		return false;
+
+	// one byte more than needed: the inflater must stop at the end of the stream
+	std::vector<char> inflated(input.length() + 1);
+	unsigned int inflatedLength = unsigned(inflated.size());
+	if (tinf_uncompress(inflated.data(), &inflatedLength, deflated.data(), deflatedLength) != TINF_OK)
+		return false;
+	return std::string(inflated.data(), inflatedLength) == input;
+}
+
+bool samlRoundTrip(const std::string& xml, int level)
+{
+	std::vector<char> encoded(samlEncodeBufferLength(xml.length()));
+	int encodedLength = samlEncode(encoded.data(), xml.data(), xml.length(), level);
+	if (encodedLength <= 0)
+		return false;
+
+	std::string decoded;
+	return samlDecode(decoded, encoded.data(), size_t(encodedLength)) == int(xml.length()) && decoded == xml;
+}
+
+// A gzip member of input: header without flags, raw deflate, CRC32 and size
+std::string gzip(const std::string& input)
+{
+	unsigned int deflatedLength = tdef_bound(unsigned(input.length()));
+	std::string member("\x1f\x8b\x08\0\0\0\0\0\0\xff", 10);
+	member.resize(10 + deflatedLength);
+	if (tdef_compress(&member[10], &deflatedLength, input.data(), unsigned(input.length()), TDEF_LEVEL_DEFAULT) != TDEF_OK)
+		return std::string();
+	member.resize(10 + deflatedLength);
+	unsigned int trailer[2] = { tinf_crc32(input.data(), unsigned(input.length())), unsigned(input.length()) };
+	for (unsigned int value : trailer)
+	{
+		for (int shift = 0; shift < 32; shift += 8)
+			member += char(value >> shift);
+	}
+	return member;
+}
+
+}
+
+TEST(deflateRoundTrip)
+{
+	static const bool tinfInitialized = (tinf_init(), true);
+	(void)tinfInitialized;
+
+	const std::string inputs[] = {
+		std::string(),
+		std::string("x"),
+		randomBytes(300 << 10),
+		repeated("<saml:Attribute Name=\"role\"><saml:AttributeValue>admin</saml:AttributeValue></saml:Attribute>", 1 << 20),
+		std::string(100 << 10, '\0')
+	};
+	for (const std::string& input : inputs)
+	{
+		for (int level = TDEF_LEVEL_STORE; level <= TDEF_LEVEL_BEST; ++level)
+			CHECK(deflateRoundTrip(input, level));
+	}
+}
+
+TEST(samlEncodeRoundTrip)
+{
+	const std::string header = "<samlp:AuthnRequest xmlns:samlp=\"urn:oasis:names:tc:SAML:2.0:protocol\" ID=\"_1\">";
+	const std::string footer = "</samlp:AuthnRequest>";
+	const std::string messages[] = {
+		header + footer,
+		header + "<saml:Issuer>" + randomBytes(64 << 10) + "</saml:Issuer>" + footer,
+		header + repeated("<saml:Audience>https://sp.example.com</saml:Audience>", 1 << 20) + footer
+	};
+	for (const std::string& xml : messages)
+	{
+		CHECK(samlRoundTrip(xml, TDEF_LEVEL_FASTEST));
+		CHECK(samlRoundTrip(xml, TDEF_LEVEL_DEFAULT));
+		CHECK(samlRoundTrip(xml, TDEF_LEVEL_BEST));
+	}
+
+	// too short to be a SAML message: encoded, but refused by the decoder
+	const std::string tooShort[] = { std::string(), std::string("<") };
+	for (const std::string& xml : tooShort)
+	{
+		std::vector<char> encoded(samlEncodeBufferLength(xml.length()));
+		int encodedLength = samlEncode(encoded.data(), xml.data(), xml.length());
+		CHECK(encodedLength > 0);
+		std::string decoded;
+		CHECK(samlDecode(decoded, encoded.data(), size_t(encodedLength)) == SAML_DECODE_ERROR_BASE64DECODE);
+		CHECK(decoded.empty());
+	}
+}
+
+TEST(smartDecodeOutputCap)
+{
+	const std::string xml = "<samlp:Response>" + repeated("<saml:Audience>https://sp.example.com</saml:Audience>", 1 << 20) + "</samlp:Response>";
+	const size_t cap = TOKEN_DECODE_OUTPUT_MAX;
+
+	std::vector<char> encoded(samlEncodeBufferLength(xml.length()));
+	int encodedLength = samlEncode(encoded.data(), xml.data(), xml.length());
+	CHECK(encodedLength > 0);
+	std::string saml(encoded.data(), size_t(encodedLength));
+
+	std::string gzipBase64;
+	std::string member = gzip(xml);
+	CHECK(convertText(CodecId::base64EncodePad, member.data(), member.length(), gzipBase64));
+
+	// the whole message, then only its first bytes once capped, the gzip trailer unchecked
+	for (const std::string& token : { saml, gzipBase64 })
+	{
+		std::string decoded;
+		CHECK(smartDecode(token.data(), token.length(), decoded));
+		CHECK(decoded == xml);
+
+		CodecOptions options;
+		options.maxOutput = cap;
+		decoded.clear();
+		CHECK(smartDecode(token.data(), token.length(), decoded, options));
+		CHECK(decoded == xml.substr(0, cap));
+	}
+
+	std::string decoded;
+	CHECK(samlDecode(decoded, saml.data(), saml.length(), cap) == int(cap));
+	CHECK(decoded == xml.substr(0, cap));
+
+	// the caret preview decodes no more than the cap, and shows the start of it
+	CHECK(previewToken(saml.data(), saml.length()) == xml.substr(0, TOKEN_PREVIEW_MAX) + "...");
+}
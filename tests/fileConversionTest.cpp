@@ -0,0 +1,175 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// convertFile() over files larger than a MappedFile view, so that the output has to
+// carry on from view to view
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+#include "test.h"
+#include "codec.h"
+#include "fileConversion.h"
+#include "saml.h"
+
+namespace {
+
+// Bytes of every value, in an order that does not repeat within a view
+std::string generatedBytes(size_t length)
+{
+	std::string bytes(length, '\0');
+	uint32_t state = 12345;
+	for (size_t i = 0; i < length; ++i)
+	{
+		state = state * 1103515245 + 12345;
+		bytes[i] = char(state >> 24);
+	}
+	return bytes;
+}
+
+bool writeFile(const char *path, const std::string& content)
+{
+	FILE *file = fopen(path, "wb");
+	if (!file)
+		return false;
+	bool ok = fwrite(content.data(), 1, content.length(), file) == content.length();
+	return fclose(file) == 0 && ok;
+}
+
+bool readFile(const char *path, std::string& content)
+{
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return false;
+	content.clear();
+	char buffer[64 << 10];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		content.append(buffer, n);
+	fclose(file);
+	return true;
+}
+
+std::string samlParameter(const char *name, const std::string& xml)
+{
+	std::string encoded(samlEncodeBufferLength(xml.length()), '\0');
+	int length = samlEncode(&encoded[0], xml.data(), xml.length());
+	encoded.resize(length > 0 ? size_t(length) : 0);
+	return std::string(name) + "=" + encoded;
+}
+
+bool fileExists(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	if (file)
+		fclose(file);
+	return file != nullptr;
+}
+
+}
+
+TEST(fileConversionRoundTrip)
+{
+	std::string source = generatedBytes(MAPPED_VIEW_SIZE + 12345);
+	CHECK(writeFile("roundTrip.bin", source));
+
+	const char *errorMessage = "";
+	CHECK(convertFile(CodecId::base64EncodeWrap, "roundTrip.bin", "roundTrip.b64", CodecOptions(), &errorMessage));
+	std::string encoded;
+	std::string expected;
+	CHECK(readFile("roundTrip.b64", encoded));
+	CHECK(convertText(CodecId::base64EncodeWrap, source.data(), source.length(), expected));
+	CHECK(encoded == expected);
+
+	CHECK(convertFile(CodecId::base64DecodeStrict, "roundTrip.b64", "roundTrip.out", CodecOptions(), &errorMessage));
+	std::string decoded;
+	CHECK(readFile("roundTrip.out", decoded));
+	CHECK(decoded == source);
+
+	remove("roundTrip.bin");
+	remove("roundTrip.b64");
+	remove("roundTrip.out");
+}
+
+TEST(fileConversionRemovesDestinationOnError)
+{
+	// valid base64 over the whole first view, then a character strict decoding rejects:
+	// the error comes once output was already written
+	std::string source(MAPPED_VIEW_SIZE + 4096, 'A');
+	source[MAPPED_VIEW_SIZE + 1024] = '!';
+	CHECK(writeFile("error.b64", source));
+
+	const char *errorMessage = "";
+	CHECK(!convertFile(CodecId::base64DecodeStrict, "error.b64", "error.out", CodecOptions(), &errorMessage));
+	CHECK(*errorMessage != '\0');
+	CHECK(!fileExists("error.out"));
+
+	errorMessage = "";
+	CHECK(!convertFile(CodecId::base64Decode, "missing.b64", "missing.out", CodecOptions(), &errorMessage));
+	CHECK(*errorMessage != '\0');
+	CHECK(!fileExists("missing.out"));
+
+	CHECK(!convertFile(CodecId::base64Decode, "error.b64", "error.b64", CodecOptions(), &errorMessage));
+	CHECK(fileExists("error.b64"));
+
+	remove("error.b64");
+}
+
+TEST(samlDecodeAllFileAcrossViews)
+{
+	const std::string request = samlParameter("SAMLRequest", "<samlp:AuthnRequest ID=\"_1\"><saml:Issuer>https://sp.example.com</saml:Issuer></samlp:AuthnRequest>");
+	const std::string response = samlParameter("SAMLResponse", "<samlp:Response ID=\"_2\"><saml:Issuer>https://idp.example.com</saml:Issuer></samlp:Response>");
+	const std::string filler = "GET /static/app.js HTTP/1.1 200\n";
+
+	// a request on the third line, a response cut by the end of the first view, the same
+	// request again in the second view, and a response on a last line without end of line
+	std::string log = filler + filler + "GET /sso?" + request + "&RelayState=x HTTP/1.1 302\n";
+	while (log.length() < MAPPED_VIEW_SIZE - 40)
+		log += filler;
+	log += "POST /acs " + response + " 200\n";
+	log += filler + "GET /sso?" + request + " 302\n" + filler;
+	log += "POST /acs " + response;
+	CHECK(log.length() > MAPPED_VIEW_SIZE);
+	CHECK(writeFile("saml.log", log));
+
+	std::vector<SamlDecoded> expected = samlDecodeAll(log.data(), log.length());
+	CHECK(expected.size() == 2);
+
+	std::vector<SamlDecoded> decoded;
+	const char *errorMessage = "";
+	CHECK(samlDecodeAllFile("saml.log", decoded, &errorMessage));
+	CHECK(decoded.size() == expected.size());
+	for (size_t i = 0; i < decoded.size() && i < expected.size(); ++i)
+	{
+		CHECK(decoded[i].lines == expected[i].lines);
+		CHECK(decoded[i].isResponse == expected[i].isResponse);
+		CHECK(decoded[i].result > 0);
+		CHECK(decoded[i].result == expected[i].result);
+		CHECK(decoded[i].xml == expected[i].xml);
+	}
+	if (decoded.size() == 2)
+	{
+		CHECK(decoded[0].lines.size() == 2);
+		CHECK(decoded[0].lines[0] == 2);
+		CHECK(decoded[1].lines.size() == 2);
+	}
+
+	CHECK(!samlDecodeAllFile("missing.log", decoded, &errorMessage));
+	CHECK(*errorMessage != '\0');
+
+	remove("saml.log");
+}
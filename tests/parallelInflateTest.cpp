@@ -0,0 +1,157 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// parallelInflate() against tinf_uncompress() on the three block types, cut in more chunks
+// than the stream would get by default: the chunks search stored ends and dynamic starts,
+// and give up on fixed Huffman blocks.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "parallelInflate.h"
+#include "tdef.h"
+#include "tinf.h"
+
+namespace {
+
+std::string randomBytes(size_t length)
+{
+	std::string bytes(length, '\0');
+	uint32_t state = 2463534242u;
+	for (size_t i = 0; i < length; ++i)
+	{
+		state = state * 1103515245 + 12345;
+		bytes[i] = char(state >> 24);
+	}
+	return bytes;
+}
+
+// Words picked at random: tdeflate writes dynamic Huffman blocks of it
+std::string words(size_t length)
+{
+	static const char *const vocabulary[] = { "assertion ", "issuer ", "audience ", "subject ", "<saml:Attribute> ", "urn:oasis ", "2023-11-04T10:00:00Z\n" };
+	std::string text;
+	uint32_t state = 12345u;
+	while (text.length() < length)
+	{
+		state = state * 1103515245 + 12345;
+		text += vocabulary[(state >> 16) % 7];
+	}
+	text.resize(length);
+	return text;
+}
+
+std::string deflate(const std::string& input)
+{
+	unsigned int deflatedLength = tdef_bound(unsigned(input.length()));
+	std::string deflated(deflatedLength, '\0');
+	if (tdef_compress(&deflated[0], &deflatedLength, input.data(), unsigned(input.length()), TDEF_LEVEL_DEFAULT) != TDEF_OK)
+		return std::string();
+	deflated.resize(deflatedLength);
+	return deflated;
+}
+
+// Fixed Huffman blocks of literals only, which tdeflate does not write on long inputs
+std::string deflateFixed(const std::string& input, size_t blockLength)
+{
+	std::string out;
+	uint64_t bitBuffer = 0;
+	int bitCount = 0;
+	auto putBits = [&](uint32_t value, int n)
+	{
+		bitBuffer |= uint64_t(value) << bitCount;
+		for (bitCount += n; bitCount >= 8; bitCount -= 8)
+		{
+			out += char(bitBuffer & 0xff);
+			bitBuffer >>= 8;
+		}
+	};
+	auto putCode = [&](uint32_t code, int n)
+	{
+		for (int i = n - 1; i >= 0; --i)
+			putBits((code >> i) & 1, 1);
+	};
+
+	for (size_t start = 0; start < input.length(); start += blockLength)
+	{
+		size_t end = input.length() - start < blockLength ? input.length() : start + blockLength;
+		putBits(end == input.length() ? 1 : 0, 1);
+		putBits(1, 2);
+		for (size_t i = start; i < end; ++i)
+		{
+			uint8_t c = uint8_t(input[i]);
+			if (c < 144)
+				putCode(0x30 + c, 8);
+			else
+				putCode(0x190 + c - 144, 9);
+		}
+		putCode(0, 7);
+	}
+	if (bitCount)
+		out += char(bitBuffer & 0xff);
+	return out;
+}
+
+// tinf_uncompress() of deflated, checked against the original input
+bool tinfInflate(const std::string& deflated, const std::string& input, std::string& inflated)
+{
+	inflated.assign(input.length() + 1, '\0');
+	unsigned int inflatedLength = unsigned(inflated.length());
+	if (tinf_uncompress(&inflated[0], &inflatedLength, deflated.data(), unsigned(deflated.length())) != TINF_OK)
+		return false;
+	inflated.resize(inflatedLength);
+	return inflated == input;
+}
+
+}
+
+TEST(parallelInflateMatchesTinf)
+{
+	static const bool tinfInitialized = (tinf_init(), true);
+	(void)tinfInitialized;
+
+	const std::string random = randomBytes(3 << 20);
+	const std::string text = words(3 << 20);
+	const std::string streams[] = {
+		deflate(random),                 // stored blocks
+		deflate(text),                   // dynamic blocks
+		deflateFixed(random, 16384),     // fixed blocks
+		deflateFixed(text, 1 << 20)
+	};
+	const std::string *inputs[] = { &random, &text, &random, &text };
+
+	for (size_t s = 0; s < sizeof(streams) / sizeof(streams[0]); ++s)
+	{
+		std::string expected;
+		CHECK(tinfInflate(streams[s], *inputs[s], expected));
+
+		for (unsigned int nbChunks : { 0u, 1u, 2u, 3u, 7u, 16u, 100u })
+		{
+			std::string inflated;
+			CHECK(parallelInflate(inflated, streams[s].data(), streams[s].length(), inputs[s]->length(), nbChunks) == TINF_OK);
+			CHECK(inflated == expected);
+		}
+
+		// cut short: an error, as for tinf, never a partial output
+		std::string inflated;
+		CHECK(parallelInflate(inflated, streams[s].data(), streams[s].length() * 2 / 3, inputs[s]->length(), 16) != TINF_OK);
+		CHECK(inflated.empty());
+		// one byte short of the output
+		CHECK(parallelInflate(inflated, streams[s].data(), streams[s].length(), inputs[s]->length() - 1, 16) == TINF_BUF_ERROR);
+	}
+}
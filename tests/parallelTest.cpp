@@ -0,0 +1,270 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Stress tests of the thread pool of parallel.h: ctest runs them with MIMETOOLS_THREADS=8,
+// so that work stealing happens even on a machine with few cores. Build with
+// -DMIMETOOLS_SANITIZE=thread to run them under ThreadSanitizer (see CMakeLists.txt).
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "b64.h"
+#include "base64Sink.h"
+#include "parallel.h"
+
+namespace {
+
+// Small deterministic generator: the tests must fail the same way every run
+struct Random
+{
+	uint32_t state;
+
+	explicit Random(uint32_t seed) : state(seed) {};
+
+	uint32_t next(uint32_t bound)
+	{
+		state = state * 1103515245 + 12345;
+		return (state >> 8) % bound;
+	};
+};
+
+// Some work whose cost varies a lot from item to item, so that threads run out of their
+// own range at different times and steal
+void spin(size_t iterations)
+{
+	volatile size_t sink = 0;
+	for (size_t i = 0; i < iterations; ++i)
+		sink = sink + i;
+}
+
+// Every index in [0, count) seen exactly once
+bool eachOnce(const std::vector<std::atomic<int>>& hits)
+{
+	for (const std::atomic<int>& hit : hits)
+	{
+		if (hit != 1)
+			return false;
+	}
+	return true;
+}
+
+}
+
+TEST(parallelForEveryIndexOnce)
+{
+	CHECK(parallelThreadCount() >= 1);
+
+	Random random(1);
+	for (int round = 0; round < 200; ++round)
+	{
+		size_t count = random.next(5000);
+		std::vector<std::atomic<int>> hits(count);
+		for (std::atomic<int>& hit : hits)
+			hit = 0;
+		std::vector<uint32_t> costs(count);
+		for (uint32_t& cost : costs)
+			cost = random.next(16) == 0 ? random.next(20000) : 0;
+
+		bool done = parallelFor(count, [&](size_t i)
+		{
+			++hits[i];
+			spin(costs[i]);
+		});
+		CHECK(done);
+		CHECK(eachOnce(hits));
+	}
+}
+
+TEST(parallelForNested)
+{
+	// items starting loops of their own, three levels deep: the pool must not wait on itself
+	std::vector<std::atomic<int>> hits(20 * 30 * 10);
+	for (std::atomic<int>& hit : hits)
+		hit = 0;
+	bool done = parallelFor(20, [&](size_t i)
+	{
+		parallelFor(30, [&](size_t j)
+		{
+			parallelFor(10, [&](size_t k)
+			{
+				++hits[(i * 30 + j) * 10 + k];
+				spin(k * 100);
+			});
+		});
+	});
+	CHECK(done);
+	CHECK(eachOnce(hits));
+}
+
+TEST(parallelForConcurrentCallers)
+{
+	// several threads running loops at once, as a background conversion next to a UI command
+	std::atomic<int> wrong(0);
+	std::vector<std::thread> callers;
+	for (int t = 0; t < 6; ++t)
+	{
+		callers.emplace_back([&wrong, t]()
+		{
+			Random random(uint32_t(t + 10));
+			for (int round = 0; round < 100; ++round)
+			{
+				std::vector<size_t> values(random.next(2000));
+				parallelFor(values.size(), [&](size_t i) { values[i] = i * 3; });
+				for (size_t i = 0; i < values.size(); ++i)
+				{
+					if (values[i] != i * 3)
+						++wrong;
+				}
+			}
+		});
+	}
+	for (std::thread& caller : callers)
+		caller.join();
+	CHECK(wrong == 0);
+}
+
+TEST(parallelForCancel)
+{
+	for (int round = 0; round < 50; ++round)
+	{
+		// cancelled from an item: the loop stops early, no item runs twice
+		const size_t count = 100000;
+		CancellationToken token;
+		std::atomic<size_t> started(0);
+		std::vector<std::atomic<int>> hits(count);
+		for (std::atomic<int>& hit : hits)
+			hit = 0;
+		bool done = parallelFor(count, [&](size_t i)
+		{
+			++hits[i];
+			if (++started == 10)
+				token.cancel();
+			spin(200);
+		}, &token);
+		CHECK(!done);
+		size_t ran = 0;
+		for (const std::atomic<int>& hit : hits)
+		{
+			CHECK(hit <= 1);
+			ran += hit;
+		}
+		CHECK(ran < count);
+	}
+
+	// a token cancelled beforehand: nothing runs
+	CancellationToken cancelled;
+	cancelled.cancel();
+	std::atomic<int> ran(0);
+	CHECK(!parallelFor(1000, [&](size_t) { ++ran; }, &cancelled));
+	CHECK(ran == 0);
+
+	// the token of a scope reaches the loops started from the items, on any thread
+	{
+		CancellationToken token;
+		CancellationScope scope(token);
+		std::atomic<int> innerDone(0);
+		std::atomic<int> innerStopped(0);
+		parallelFor(64, [&](size_t i)
+		{
+			if (i == 0)
+				token.cancel();
+			if (parallelFor(100, [&](size_t) { spin(100); }))
+				++innerDone;
+			else
+				++innerStopped;
+		});
+		CHECK(innerStopped > 0);
+	}
+
+	// the scope is gone: loops run again
+	std::atomic<int> after(0);
+	CHECK(parallelFor(100, [&](size_t) { ++after; }));
+	CHECK(after == 100);
+}
+
+TEST(parallelForRangesPieces)
+{
+	Random random(7);
+	for (int round = 0; round < 100; ++round)
+	{
+		size_t length = random.next(1 << 20);
+		size_t pieceLength = 1 + random.next(70000);
+		std::vector<std::atomic<int>> covered(length);
+		for (std::atomic<int>& byte : covered)
+			byte = 0;
+		std::atomic<bool> wrongPiece(false);
+		parallelForRanges(length, pieceLength, [&](size_t piece, size_t begin, size_t end)
+		{
+			// the pieces only depend on the length and the piece length
+			if (begin != piece * pieceLength || end - begin > pieceLength || (end < length && end - begin != pieceLength))
+				wrongPiece = true;
+			for (size_t i = begin; i < end; ++i)
+				++covered[i];
+		});
+		CHECK(!wrongPiece);
+		CHECK(eachOnce(covered));
+	}
+}
+
+TEST(parallelBase64Encode)
+{
+	// the pieces encoded concurrently at their offsets give the serial output
+	Random random(3);
+	const size_t lengths[] = { BASE64_PARALLEL_MIN, BASE64_PARALLEL_MIN + 1, BASE64_PARALLEL_MIN + 2, 3000001, (5 << 20) - 7 };
+	for (size_t length : lengths)
+	{
+		std::string input(length, '\0');
+		for (char& c : input)
+			c = char(random.next(256));
+
+		const size_t wraps[] = { 0, 64, 76 };
+		for (size_t wrap : wraps)
+		{
+			for (int continued = 0; continued < 2; ++continued)
+			{
+				std::string expected = continued ? "xyz" : "";
+				if (continued && wrap)
+					expected += '\n';
+				size_t start = expected.length();
+				expected.resize(start + (length + 2) / 3 * 4 * 2);
+				expected.resize(start + base64Encode(&expected[start], input.data(), length, wrap, true, false));
+
+				std::string out = continued ? "xyz" : "";
+				StringSink sink(out);
+				base64EncodeTo(sink, input.data(), length, wrap, true, continued != 0);
+				CHECK(out == expected);
+			}
+		}
+	}
+}
+
+TEST(threadPoolShutdown)
+{
+	// joined at the end of the plugin: loops afterwards still run, on the calling thread
+	std::vector<std::atomic<int>> hits(1000);
+	for (std::atomic<int>& hit : hits)
+		hit = 0;
+	CHECK(parallelFor(hits.size(), [&](size_t i) { ++hits[i]; }));
+	shutdownThreadPool();
+	CHECK(parallelThreadCount() == 1);
+	CHECK(parallelFor(hits.size(), [&](size_t i) { ++hits[i]; }));
+	for (const std::atomic<int>& hit : hits)
+		CHECK(hit == 2);
+}
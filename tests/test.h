@@ -0,0 +1,43 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+// A test is a function registered under its name; ctest runs each one on its own as
+// "mimetools-tests <name>" (see CMakeLists.txt). CHECK reports a failed condition and
+// lets the test go on, so that one run shows every failure.
+//
+//	TEST(base64RoundTrip)
+//	{
+//		CHECK(decoded == input);
+//	}
+
+typedef void (*TestFunction)();
+
+struct TestRegistration
+{
+	TestRegistration(const char *name, TestFunction function);
+};
+
+void testFailed(const char *file, int line, const char *condition);
+
+#define TEST(name) \
+	static void name##Test(); \
+	static TestRegistration name##Registration(#name, name##Test); \
+	static void name##Test()
+
+#define CHECK(condition) \
+	do { if (!(condition)) testFailed(__FILE__, __LINE__, #condition); } while (0)
@@ -0,0 +1,100 @@
+// This file is part of Notepad++ plugin MIME Tools project
+// Copyright (C)2023 Don HO <don.h@free.fr>
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// mimetools-tests: tests of the core, built with the CMake build
+//
+//	mimetools-tests                  every test
+//	mimetools-tests name...          the tests given
+//	mimetools-tests --list
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+struct RegisteredTest
+{
+	const char *name;
+	TestFunction function;
+};
+
+std::vector<RegisteredTest>& registeredTests()
+{
+	static std::vector<RegisteredTest> tests;
+	return tests;
+}
+
+unsigned g_failures = 0;
+
+bool runTest(const RegisteredTest& test)
+{
+	unsigned failuresBefore = g_failures;
+	test.function();
+	bool passed = g_failures == failuresBefore;
+	printf("%s %s\n", passed ? "PASS" : "FAIL", test.name);
+	return passed;
+}
+
+}
+
+TestRegistration::TestRegistration(const char *name, TestFunction function)
+{
+	registeredTests().push_back({ name, function });
+}
+
+void testFailed(const char *file, int line, const char *condition)
+{
+	++g_failures;
+	fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, condition);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc == 2 && strcmp(argv[1], "--list") == 0)
+	{
+		for (const RegisteredTest& test : registeredTests())
+			printf("%s\n", test.name);
+		return 0;
+	}
+
+	bool passed = true;
+	if (argc == 1)
+	{
+		for (const RegisteredTest& test : registeredTests())
+			passed = runTest(test) && passed;
+		return passed ? 0 : 1;
+	}
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const RegisteredTest *found = nullptr;
+		for (const RegisteredTest& test : registeredTests())
+		{
+			if (strcmp(test.name, argv[i]) == 0)
+				found = &test;
+		}
+		if (!found)
+		{
+			fprintf(stderr, "mimetools-tests: unknown test %s\n", argv[i]);
+			return 2;
+		}
+		passed = runTest(*found) && passed;
+	}
+	return passed ? 0 : 1;
+}